@@ -4,19 +4,411 @@
 
 #include "json_class_generator.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <string_view>
 #include <unordered_set>
 
+#include "mapped_file_source.h"
+
+namespace {
+
+// Must match json2class::HashKey in the generated key hash support code.
+std::uint64_t HashKey(const std::string& key) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Must match json2class::KeySlot in the generated key hash support code.
+std::size_t KeySlot(std::uint64_t hash,
+                    std::uint32_t displacement,
+                    std::size_t mask) {
+  hash ^= displacement;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return static_cast<std::size_t>(hash & mask);
+}
+
+// Alignment of json2class::LazyBits<field_count>, see LazyBitsWord.
+int LazyBitsAlignment(std::size_t field_count) {
+  if (field_count <= 8) {
+    return 1;
+  } else if (field_count <= 16) {
+    return 2;
+  } else if (field_count <= 32) {
+    return 4;
+  }
+  return 8;
+}
+
+std::size_t NextPowerOfTwo(std::size_t n) {
+  std::size_t result = 1;
+  while (result < n) {
+    result <<= 1;
+  }
+  return result;
+}
+
+// A minimal perfect hash (hash and displace) over the keys of one object.
+// A key is first hashed into a bucket; every bucket then gets a displacement
+// that sends all of its keys to free slots.
+struct KeyTable {
+  std::vector<std::uint32_t> displacements;
+  std::vector<int> fields;  // Field index per slot, -1 for empty slots.
+};
+
+KeyTable BuildKeyTable(const std::vector<std::string>& keys) {
+  const std::size_t bucket_count = NextPowerOfTwo((keys.size() + 1) / 2);
+  for (std::size_t slot_count = NextPowerOfTwo(keys.size());;
+       slot_count *= 2) {
+    std::vector<std::vector<int>> buckets(bucket_count);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      buckets[(HashKey(keys[i]) >> 32) & (bucket_count - 1)].push_back(
+          static_cast<int>(i));
+    }
+    std::vector<std::size_t> order(bucket_count);
+    for (std::size_t i = 0; i < bucket_count; ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&buckets](std::size_t a, std::size_t b) {
+                       return buckets[a].size() > buckets[b].size();
+                     });
+
+    KeyTable table;
+    table.displacements.assign(bucket_count, 0);
+    table.fields.assign(slot_count, -1);
+    bool placed_all = true;
+    for (std::size_t bucket : order) {
+      if (buckets[bucket].empty()) {
+        break;
+      }
+      bool placed = false;
+      for (std::uint32_t d = 0; d < (1u << 16) && !placed; ++d) {
+        std::vector<std::size_t> slots;
+        placed = true;
+        for (int field : buckets[bucket]) {
+          std::size_t slot = KeySlot(HashKey(keys[field]), d, slot_count - 1);
+          if (table.fields[slot] != -1 ||
+              std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+            placed = false;
+            break;
+          }
+          slots.push_back(slot);
+        }
+        if (placed) {
+          for (std::size_t i = 0; i < slots.size(); ++i) {
+            table.fields[slots[i]] = buckets[bucket][i];
+          }
+          table.displacements[bucket] = d;
+        }
+      }
+      if (!placed) {
+        placed_all = false;
+        break;
+      }
+    }
+    if (placed_all) {
+      return table;
+    }
+  }
+}
+
+// Returns the narrowest of int, std::int64_t and std::uint64_t that holds the
+// integer |value|.
+std::string IntegerType(const json& value) {
+  if (value.is_number_unsigned()) {
+    const std::uint64_t number = value.get<std::uint64_t>();
+    if (number > static_cast<std::uint64_t>(
+                     std::numeric_limits<std::int64_t>::max())) {
+      return "std::uint64_t";
+    }
+  }
+  const std::int64_t number = value.get<std::int64_t>();
+  if (number < std::numeric_limits<int>::min() ||
+      number > std::numeric_limits<int>::max()) {
+    return "std::int64_t";
+  }
+  return "int";
+}
+
+// The name, C++ type, size and range of a NumberType. kInt32 is spelled int,
+// like the integers that keep the type of their sample value.
+struct NumberTypeInfo {
+  const char* name;
+  const char* type;
+  std::size_t size;
+  bool integer;
+  std::int64_t min;
+  std::uint64_t max;
+};
+
+template <typename T>
+constexpr NumberTypeInfo IntegerInfo(const char* name, const char* type) {
+  return {name, type, sizeof(T), true, std::numeric_limits<T>::min(),
+          std::numeric_limits<T>::max()};
+}
+
+constexpr NumberTypeInfo kNumberTypes[] = {
+    IntegerInfo<std::int8_t>("int8", "std::int8_t"),
+    IntegerInfo<std::uint8_t>("uint8", "std::uint8_t"),
+    IntegerInfo<std::int16_t>("int16", "std::int16_t"),
+    IntegerInfo<std::uint16_t>("uint16", "std::uint16_t"),
+    IntegerInfo<std::int32_t>("int32", "int"),
+    IntegerInfo<std::uint32_t>("uint32", "std::uint32_t"),
+    IntegerInfo<std::int64_t>("int64", "std::int64_t"),
+    IntegerInfo<std::uint64_t>("uint64", "std::uint64_t"),
+    {"float", "float", 4, false, 0, 0},
+    {"double", "double", 8, false, 0, 0},
+};
+
+const NumberTypeInfo& Info(NumberType type) {
+  return kNumberTypes[static_cast<int>(type)];
+}
+
+// Returns |value| with every number converted to |type|, for the default of
+// the field |path|. Throws std::invalid_argument if a number does not fit.
+json ConvertNumbers(const json& value,
+                    NumberType type,
+                    const std::string& path) {
+  if (value.is_array()) {
+    json array = json::array();
+    for (const json& element : value) {
+      array.push_back(ConvertNumbers(element, type, path));
+    }
+    return array;
+  }
+  const NumberTypeInfo& info = Info(type);
+  if (!value.is_number() || !info.integer) {
+    return value.is_number() ? json(value.get<double>()) : value;
+  }
+  json integer = value;
+  if (value.is_number_float()) {
+    const double number = value.get<double>();
+    integer = number == std::trunc(number) && number >= -0x1p63 &&
+                      number < 0x1p63
+                  ? json(static_cast<std::int64_t>(number))
+                  : json(nullptr);
+  }
+  bool fits = false;
+  if (integer.is_number_unsigned()) {
+    fits = integer.get<std::uint64_t>() <= info.max;
+  } else if (integer.is_number_integer()) {
+    const std::int64_t number = integer.get<std::int64_t>();
+    fits = number >= info.min &&
+           (number < 0 || static_cast<std::uint64_t>(number) <= info.max);
+  }
+  if (!fits) {
+    throw std::invalid_argument("the value " + value.dump() + " of " + path +
+                                " does not fit in " + info.name);
+  }
+  return integer;
+}
+
+// Merges |from| into |into|: objects get the union of their keys, arrays the
+// elements of both, and numbers the wider type.
+void MergeSample(json& into, const json& from) {
+  if (into.is_null()) {
+    into = from;
+  } else if (into.is_object() && from.is_object()) {
+    for (auto it = from.begin(); it != from.end(); ++it) {
+      MergeSample(into[it.key()], it.value());
+    }
+  } else if (into.is_array() && from.is_array()) {
+    into.insert(into.end(), from.begin(), from.end());
+  } else if (into.is_number_integer() && from.is_number()) {
+    if (from.is_number_float() ||
+        (IntegerType(into) == "int" && IntegerType(from) != "int")) {
+      into = from;
+    }
+  }
+}
+
+// Returns one value that stands for all elements of a non-empty |array|: the
+// first element, merged with the others if it is an object or an array.
+json ElementSample(const json& array) {
+  const json& first = array[0];
+  if (!first.is_object() && !first.is_array()) {
+    return first;
+  }
+  json sample;
+  for (const json& element : array) {
+    if (element.type() == first.type()) {
+      MergeSample(sample, element);
+    }
+  }
+  return sample;
+}
+
+// Returns the sample of the innermost elements of a value that may be a
+// nested array. It is an object when the arrays hold generated classes.
+json ObjectElementSample(const json& value) {
+  json sample = value;
+  while (sample.is_array() && !sample.empty()) {
+    sample = ElementSample(sample);
+  }
+  return sample;
+}
+
+// Returns whether a value becomes a string, or an array of strings at any
+// depth. Those members hold views in string_views mode.
+bool HoldsStrings(const json& value) {
+  const json sample = ObjectElementSample(value);
+  return sample.is_string() || sample.is_null() || sample.is_array();
+}
+
+// Returns the path suffix of the class generated for the field |key|, for
+// example "items[][]." for an array of arrays of objects.
+std::string NestedPath(const std::string& key, const json& value) {
+  std::string path = key;
+  for (json sample = value; sample.is_array() && !sample.empty();
+       sample = ElementSample(sample)) {
+    path += "[]";
+  }
+  return path + ".";
+}
+
+// Returns the enumerator names of enum values: "in-progress" becomes
+// kInProgress and "ACTIVE" kActive. Clashing names get a number, and kOther
+// is reserved if |open|.
+std::vector<std::string> EnumeratorNames(const std::vector<std::string>& values,
+                                         bool open) {
+  std::set<std::string> used;
+  if (open) {
+    used.insert("kOther");
+  }
+  std::vector<std::string> names;
+  for (const std::string& value : values) {
+    std::string name = "k";
+    std::size_t word = 0;
+    for (std::size_t i = 0; i <= value.size(); ++i) {
+      if (i < value.size() &&
+          std::isalnum(static_cast<unsigned char>(value[i]))) {
+        continue;
+      }
+      std::string part = value.substr(word, i - word);
+      if (std::none_of(part.begin(), part.end(), [](char c) {
+            return std::islower(static_cast<unsigned char>(c));
+          })) {
+        std::transform(part.begin(), part.end(), part.begin(), [](char c) {
+          return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        });
+      }
+      if (!part.empty()) {
+        part[0] = static_cast<char>(
+            std::toupper(static_cast<unsigned char>(part[0])));
+      }
+      name += part;
+      word = i + 1;
+    }
+    if (name == "k") {
+      name += value.empty() ? "Empty" : "Value";
+    }
+    std::string unique = name;
+    for (int suffix = 2; !used.insert(unique).second; ++suffix) {
+      unique = name + std::to_string(suffix);
+    }
+    names.push_back(unique);
+  }
+  return names;
+}
+
+// Returns the width in bytes of the narrowest unsigned type that numbers
+// |count| enumerators.
+int EnumWidth(std::size_t count) {
+  if (count <= 0x100) {
+    return 1;
+  } else if (count <= 0x10000) {
+    return 2;
+  }
+  return 4;
+}
+
+}  // namespace
+
+bool ParseNumberType(const std::string& name, NumberType& type) {
+  for (std::size_t i = 0; i < std::size(kNumberTypes); ++i) {
+    if (name == kNumberTypes[i].name) {
+      type = static_cast<NumberType>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
 JsonClassGenerator::JsonClassGenerator() {}
 
 JsonClassGenerator::~JsonClassGenerator() {}
 
+void JsonClassGenerator::ReportLayout(std::ostream& out) const {
+  out << "Layout on a 64-bit target with libstdc++:\n" << layout_report_;
+}
+
 std::string JsonClassGenerator::GenerateClass(const std::string& class_name,
                                               const json& j,
-                                              bool lazy_parsing) {
+                                              const GeneratorOptions& options) {
+  options_ = options;
+  // Lazy classes share their source buffer instead of owning their strings
+  if (options_.lazy_parsing) {
+    options_.pmr = false;
+    options_.backend = ParserBackend::kNlohmann;
+    options_.intern_strings = false;
+    options_.compact_layout = false;
+    options_.binary = false;
+  } else {
+    options_.string_views = false;
+  }
+  if (options_.pmr) {
+    options_.intern_strings = false;
+  }
+  if (!options_.compact_layout) {
+    options_.number_types.clear();
+    options_.hot_fields.clear();
+  }
+  field_path_.clear();
+  class_scope_ = class_name;
+  layout_report_.clear();
   std::stringstream ss;
 
+  // Standard headers of the support blocks and methods that are emitted
+  std::set<std::string> headers = {
+      "algorithm", "charconv", "cmath", "cstdint", "cstdlib", "cstring",
+      "initializer_list", "istream", "iterator", "limits", "stdexcept",
+      "string_view", "type_traits", "utility"};
+  if (options_.intern_strings) {
+    headers.insert({"atomic", "memory", "mutex", "new", "unordered_set"});
+  }
+  if (options_.ndjson) {
+    headers.insert({"atomic", "exception", "system_error", "thread"});
+  }
+  if (options_.mapped_files) {
+    headers.insert({"cerrno", "system_error"});
+  }
+  if (options_.binary) {
+    headers.insert("cstdio");
+  }
+  if (options_.lazy_parsing) {
+    headers.insert({"array", "memory"});
+  }
+  if (options_.lazy_parsing && options_.thread_safe) {
+    headers.insert({"atomic", "mutex"});
+  }
+  if (options_.pmr) {
+    headers.insert("memory_resource");
+  }
+
   // Add header includes
   ss << "#ifndef " << class_name << "_H_\n";
   ss << "#define " << class_name << "_H_\n\n";
@@ -24,236 +416,5794 @@ std::string JsonClassGenerator::GenerateClass(const std::string& class_name,
   ss << "#include <vector>\n";
   ss << "#include <map>\n";
   ss << "#include <nlohmann/json.hpp>\n";
-  if (lazy_parsing) {
-    ss << "#include <optional>\n";
+  if (options_.backend == ParserBackend::kSimdjson) {
+    ss << "#include <simdjson.h>\n";
+  }
+  for (const std::string& header : headers) {
+    ss << "#include <" << header << ">\n";
+  }
+  ss << "\n";
+  ss << "using json = nlohmann::json;\n\n";
+
+  // Only the support code that the class uses is emitted. The parts of a
+  // block that serve enum or interned members have guards of their own, so
+  // that an earlier header without those members does not hide them from a
+  // later one in the same translation unit.
+  ss << GenerateStatusSupport();
+  if (!options_.enums.empty()) {
+    ss << GenerateEnumSupport();
+  }
+  ss << GenerateKeyHashSupport();
+  if (options_.intern_strings) {
+    ss << GenerateInternSupport();
+  }
+  ss << GenerateJsonScanSupport();
+  ss << GenerateSaxSupport();
+  if (options_.backend == ParserBackend::kSimdjson) {
+    ss << GenerateSimdjsonSupport();
+  }
+  if (!options_.lazy_parsing && !options_.pmr) {
+    ss << GenerateReaderSupport();
+  }
+  ss << GenerateJsonWriterSupport();
+  if (options_.binary) {
+    ss << GenerateBinarySupport();
+  }
+  if (options_.pmr) {
+    ss << GeneratePmrSupport();
+  }
+  if (options_.ndjson) {
+    ss << GenerateNdjsonSupport();
+  }
+  if (options_.mapped_files) {
+    ss << GenerateMappedFileSupport();
+  }
+  if (options_.flat) {
+    ss << GenerateFlatSupport();
+  }
+  if (options_.columns) {
+    ss << GenerateColumnsSupport();
+  }
+  if (options_.lazy_parsing) {
+    ss << GenerateLazyIndexSupport();
+  }
+  if (options_.lazy_parsing && options_.thread_safe) {
+    ss << GenerateLazySyncSupport();
+  }
+
+  // Generate class definition
+  ss << "class " << class_name << " {\n";
+  ss << " public:\n";
+  ss << GenerateSpecialMembers(class_name, 1);
+
+  // JSON constructor
+  ss << "  " << class_name << "(const json& j) {\n";
+  ss << "    FromJson(j);\n";
+  ss << "  }\n\n";
+  if (!options_.lazy_parsing && !options_.pmr) {
+    ss << "  " << class_name << "(json&& j) {\n";
+    ss << "    FromJson(std::move(j));\n";
+    ss << "  }\n\n";
+  }
+
+  if (options_.pmr) {
+    ss << GeneratePmrMethods(class_name, j, 1);
+  }
+
+  // Add FromJson and ToJson method implementations (directly in the class)
+  ss << "  void FromJson(const json& j) {\n";
+  ss << GenerateFromJsonMethod(class_name, j, 2);
+  ss << "  }\n\n";
+
+  if (!options_.lazy_parsing && !options_.pmr) {
+    ss << "  void FromJson(json&& j) {\n";
+    ss << GenerateFromJsonMethod(class_name, j, 2, ReadMode::kMoved);
+    ss << "  }\n\n";
+  }
+
+  if (!options_.lazy_parsing) {
+    // Parses as if into a new object, reusing the memory of every member
+    ss << "  void Reparse(const json& j) {\n";
+    ss << GenerateFromJsonMethod(class_name, j, 2, ReadMode::kReparse);
+    ss << "  }\n\n";
+  }
+  ss << GenerateClearMethod(j, 1);
+
+  ss << "  json ToJson() const {\n";
+  ss << GenerateToJsonMethod(class_name, j, 2);
+  ss << "  }\n\n";
+
+  ss << GenerateToJsonStringMethods(j, 1);
+  ss << GenerateFieldIndexMethod(j, 1);
+  if (options_.lazy_parsing) {
+    ss << GenerateLazyIndexMethods(1);
+  } else {
+    ss << GenerateSaxMethods(class_name, j, 1);
+    ss << GenerateTryMethods(j, 1);
+    if (options_.backend == ParserBackend::kSimdjson) {
+      ss << GenerateSimdjsonMethods(j, 1);
+    }
+    ss << GenerateFieldMaskMethods(j, 1);
+    ss << GenerateStreamMethods(j, 1);
+    if (options_.binary) {
+      ss << GenerateBinaryMethods(j, 1);
+    }
+  }
+  if (options_.ndjson) {
+    ss << GenerateNdjsonMethod(class_name, 1);
+  }
+  if (options_.mapped_files) {
+    ss << GenerateFileMethods(class_name, 1);
+  }
+  if (options_.intern_strings) {
+    ss << GenerateInternMethods(class_name, 1);
+  }
+  if (options_.flat) {
+    ss << GenerateFlatMethods(j, true, 1);
+  }
+
+  // Add member variables
+  ss << " private:\n";
+  ss << GenerateClassContent(class_name, j, 1);
+
+  // Add getter and setter methods
+  ss << " public:\n";
+  ss << GenerateGettersSetters(class_name, j, 1);
+  if (options_.flat) {
+    ss << GenerateFlatView(j, true, 1);
+  }
+
+  ss << "};\n\n";
+  if (options_.columns) {
+    ss << GenerateColumnsClass(class_name, j);
+  }
+  ss << "#endif  // " << class_name << "_H_\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateClassContent(
+    const std::string& class_name,
+    const json& j,
+    int indent_level) {
+  (void)class_name;
+  std::stringstream ss;
+
+  // Lazy classes declare their members after all nested classes, ordered by
+  // alignment so that no padding is needed between them. Materialized fields
+  // are tracked in one packed bitmask instead of a std::optional per field.
+  std::vector<std::pair<int, std::string>> lazy_members;
+  if (options_.lazy_parsing) {
+    lazy_members.emplace_back(
+        8, "std::shared_ptr<const std::string> lazy_source_;");
+    lazy_members.emplace_back(4, "std::array<json2class::LazySpan, " +
+                                     std::to_string(j.size()) +
+                                     "> lazy_spans_{};");
+    lazy_members.emplace_back(
+        8, "std::vector<json2class::LazySpan> lazy_unknown_;");
+    lazy_members.emplace_back(
+        LazyBitsAlignment(j.size()),
+        std::string("mutable json2class::") +
+            (options_.thread_safe ? "AtomicLazyBits<" : "LazyBits<") +
+            std::to_string(j.size()) + "> lazy_ready_;");
+    lazy_members.emplace_back(LazyBitsAlignment(j.size()),
+                              "json2class::LazyBits<" +
+                                  std::to_string(j.size()) + "> lazy_dirty_;");
+    if (options_.string_views) {
+      lazy_members.emplace_back(
+          8, "mutable json2class::StringArena lazy_strings_;");
+    }
+  }
+
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    const std::string& key = it.key();
+    std::string sanitized_key = SanitizeIdentifier(key);
+    const json& value = it.value();
+
+    if (value.is_object()) {
+      // Nested object, create inner class
+      std::string nested_class_name = sanitized_key + "_type";
+      const std::string path = field_path_;
+      field_path_ += NestedPath(key, value);
+      ss << GenerateNestedClass(nested_class_name, value, false,
+                                indent_level);
+      field_path_ = path;
+
+      // Add instance of the inner class
+      if (options_.lazy_parsing) {
+        lazy_members.emplace_back(GetTypeAlignment(value),
+                                  "mutable " + nested_class_name + " " +
+                                      sanitized_key + "_;");
+      } else if (!options_.compact_layout) {
+        ss << Indent(indent_level) << nested_class_name << " " << sanitized_key
+           << "_;\n";
+      }
+    } else {
+      // Arrays of objects hold instances of a generated element class
+      const json element = ObjectElementSample(value);
+      if (element.is_object()) {
+        const std::string path = field_path_;
+        field_path_ += NestedPath(key, value);
+        ss << GenerateNestedClass(ElementClassName(key), element, true,
+                                  indent_level);
+        field_path_ = path;
+      }
+
+      // Enums are public so that callers can compare with their values
+      const std::vector<std::string> values = GetEnumValues(key, value);
+      if (!values.empty()) {
+        ss << Indent(indent_level - 1) << " public:\n";
+        ss << GenerateEnum(key, values, indent_level);
+        ss << Indent(indent_level - 1) << " private:\n";
+      }
+
+      // Regular member variable
+      std::string type = GetFieldType(key, value);
+      std::string default_value = GetFieldDefault(key, value);
+
+      if (options_.lazy_parsing) {
+        // Closed enums are as wide as their underlying type
+        const int alignment = values.empty() || options_.open_enums
+                                  ? GetTypeAlignment(value)
+                                  : EnumWidth(values.size());
+        lazy_members.emplace_back(alignment,
+                                  "mutable " + type + " " + sanitized_key +
+                                      "_{" + default_value + "};");
+      } else if (!options_.compact_layout) {
+        ss << Indent(indent_level) << type << " " << sanitized_key << "_{"
+           << default_value << "};\n";
+      }
+    }
+  }
+
+  std::stable_sort(lazy_members.begin(), lazy_members.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (const auto& member : lazy_members) {
+    ss << Indent(indent_level) << member.second << "\n";
+  }
+
+  // Compact classes also declare their members after all nested classes and
+  // enums
+  if (options_.compact_layout) {
+    for (const std::string& key : GetMemberOrder(j)) {
+      const json& value = j.at(key);
+      const std::string member = SanitizeIdentifier(key) + "_";
+      if (value.is_object()) {
+        ss << Indent(indent_level) << SanitizeIdentifier(key) << "_type "
+           << member << ";\n";
+      } else {
+        ss << Indent(indent_level) << GetFieldType(key, value) << " "
+           << member << "{" << GetFieldDefault(key, value) << "};\n";
+      }
+    }
+    AddLayoutReport(j);
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateNestedClass(
+    const std::string& nested_class_name,
+    const json& value,
+    bool element,
+    int indent_level) {
+  std::stringstream ss;
+
+  // Nested classes are public so that callers can name them, for example to
+  // build the elements of an array
+  ss << Indent(indent_level - 1) << " public:\n";
+  ss << Indent(indent_level) << "class " << nested_class_name << " {\n";
+  ss << Indent(indent_level) << " public:\n";
+  ss << GenerateSpecialMembers(nested_class_name, indent_level + 1);
+  if (options_.pmr) {
+    ss << GeneratePmrMethods(nested_class_name, value, indent_level + 1);
+  }
+
+  // Add member variables and method declarations
+  ss << Indent(indent_level + 1) << "void FromJson(const json& j) {\n";
+  ss << GenerateFromJsonMethod(nested_class_name, value, indent_level + 2);
+  ss << Indent(indent_level + 1) << "}\n\n";
+
+  if (!options_.lazy_parsing && !options_.pmr) {
+    ss << Indent(indent_level + 1) << "void FromJson(json&& j) {\n";
+    ss << GenerateFromJsonMethod(nested_class_name, value, indent_level + 2,
+                                 ReadMode::kMoved);
+    ss << Indent(indent_level + 1) << "}\n\n";
+  }
+
+  if (!options_.lazy_parsing) {
+    ss << Indent(indent_level + 1) << "void Reparse(const json& j) {\n";
+    ss << GenerateFromJsonMethod(nested_class_name, value, indent_level + 2,
+                                 ReadMode::kReparse);
+    ss << Indent(indent_level + 1) << "}\n\n";
+  }
+  ss << GenerateClearMethod(value, indent_level + 1);
+
+  ss << Indent(indent_level + 1) << "json ToJson() const {\n";
+  ss << GenerateToJsonMethod(nested_class_name, value, indent_level + 2);
+  ss << Indent(indent_level + 1) << "}\n\n";
+
+  if (element) {
+    // Lets json::get and json assignment convert whole arrays of elements
+    ss << Indent(indent_level + 1) << "friend void to_json(json& j, const "
+       << nested_class_name << "& value) {\n";
+    ss << Indent(indent_level + 2) << "j = value.ToJson();\n";
+    ss << Indent(indent_level + 1) << "}\n\n";
+    ss << Indent(indent_level + 1) << "friend void from_json(const json& j, "
+       << nested_class_name << "& value) {\n";
+    ss << Indent(indent_level + 2) << "value.FromJson(j);\n";
+    ss << Indent(indent_level + 1) << "}\n\n";
+  }
+
+  ss << GenerateToJsonStringMethods(value, indent_level + 1);
+  ss << GenerateFieldIndexMethod(value, indent_level + 1);
+  if (options_.lazy_parsing) {
+    ss << GenerateLazyIndexMethods(indent_level + 1);
+  } else {
+    ss << GenerateSaxMethods(nested_class_name, value, indent_level + 1);
+    ss << GenerateTryMethods(value, indent_level + 1);
+    if (options_.backend == ParserBackend::kSimdjson) {
+      ss << GenerateSimdjsonMethods(value, indent_level + 1);
+    }
+    if (options_.binary) {
+      ss << GenerateBinaryMethods(value, indent_level + 1);
+    }
+  }
+  if (options_.flat) {
+    ss << GenerateFlatMethods(value, false, indent_level + 1);
+  }
+
+  ss << Indent(indent_level) << " private:\n";
+  const std::string scope = class_scope_;
+  class_scope_ += "::" + nested_class_name;
+  ss << GenerateClassContent(nested_class_name, value, indent_level + 1);
+  class_scope_ = scope;
+
+  // Add getter and setter methods
+  ss << Indent(indent_level) << " public:\n";
+  ss << GenerateGettersSetters(nested_class_name, value, indent_level + 1);
+  if (options_.flat) {
+    ss << GenerateFlatView(value, false, indent_level + 1);
+  }
+
+  ss << Indent(indent_level) << "};\n\n";
+  ss << Indent(indent_level - 1) << " private:\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateSpecialMembers(
+    const std::string& class_name,
+    int indent_level) {
+  std::stringstream ss;
+
+  // The destructor is declared, so the moves have to be declared as well or
+  // every move would copy
+  ss << Indent(indent_level) << class_name << "() = default;\n";
+  ss << Indent(indent_level) << "~" << class_name << "() = default;\n";
+  ss << Indent(indent_level) << class_name << "(const " << class_name
+     << "&) = default;\n";
+  ss << Indent(indent_level) << class_name << "(" << class_name
+     << "&&) = default;\n";
+  ss << Indent(indent_level) << class_name << "& operator=(const "
+     << class_name << "&) = default;\n";
+  ss << Indent(indent_level) << class_name << "& operator=(" << class_name
+     << "&&) = default;\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateFromJsonMethod(
+    const std::string& class_name,
+    const json& j,
+    int indent_level,
+    ReadMode mode) {
+  (void)class_name;
+  std::stringstream ss;
+
+  if (!options_.lazy_parsing) {
+    const bool reparse = mode == ReadMode::kReparse;
+
+    // Walk the input object once and dispatch each key through FieldIndex
+    ss << Indent(indent_level) << "if (!j.is_object()) {\n";
+    if (reparse) {
+      ss << Indent(indent_level + 1) << "Clear();\n";
+    }
+    ss << Indent(indent_level + 1) << "return;\n";
+    ss << Indent(indent_level) << "}\n";
+    if (reparse && !j.empty()) {
+      ss << Indent(indent_level) << "bool seen[" << j.size() << "] = {};\n";
+    }
+    ss << Indent(indent_level)
+       << "for (auto it = j.begin(); it != j.end(); ++it) {\n";
+    if (mode == ReadMode::kMasked) {
+      ss << Indent(indent_level + 1)
+         << "const int field = FieldIndex(it.key());\n";
+      ss << Indent(indent_level + 1) << "if (!mask.test(field)) {\n";
+      ss << Indent(indent_level + 2) << "continue;\n";
+      ss << Indent(indent_level + 1) << "}\n";
+      ss << Indent(indent_level + 1) << "switch (field) {\n";
+    } else {
+      ss << Indent(indent_level + 1) << "switch (FieldIndex(it.key())) {\n";
+    }
+
+    // Strings and containers are read by the json2class readers, which
+    // assign into the existing member instead of replacing it
+    const std::string reader = mode == ReadMode::kMoved ? "json2class::MoveJson"
+                               : options_.pmr         ? "json2class::ReadJson"
+                                                      : "json2class::AssignJson";
+    int field_index = 0;
+    for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+      const std::string member = SanitizeIdentifier(it.key()) + "_";
+      const json& value = it.value();
+      const std::string seen =
+          "seen[" + std::to_string(field_index) + "] = true;\n";
+
+      ss << Indent(indent_level + 2) << "case " << field_index << ":\n";
+      if (value.is_object() || value.is_array()) {
+        // Values of the wrong container type are skipped
+        ss << Indent(indent_level + 3) << "if (it.value().is_"
+           << (value.is_object() ? "object" : "array") << "()) {\n";
+        if (value.is_array()) {
+          ss << Indent(indent_level + 4) << reader << "(it.value(), " << member
+             << ");\n";
+        } else if (mode == ReadMode::kMoved) {
+          ss << Indent(indent_level + 4) << member
+             << ".FromJson(std::move(it.value()));\n";
+        } else {
+          ss << Indent(indent_level + 4) << member
+             << (reparse ? ".Reparse(it.value());\n"
+                         : ".FromJson(it.value());\n");
+        }
+        if (reparse) {
+          ss << Indent(indent_level + 4) << seen;
+        }
+        ss << Indent(indent_level + 3) << "}\n";
+      } else {
+        if (!GetEnumValues(it.key(), value).empty()) {
+          ss << Indent(indent_level + 3) << "json2class::ReadEnum(it.value(), "
+             << member << ");\n";
+        } else if (value.is_string()) {
+          ss << Indent(indent_level + 3) << reader << "(it.value(), " << member
+             << ");\n";
+        } else if (value.is_number() || value.is_boolean()) {
+          ss << Indent(indent_level + 3) << "json2class::ReadNumber(it.value(), "
+             << member << ");\n";
+        } else {
+          // Basic type
+          ss << Indent(indent_level + 3) << member << " = it.value().get<"
+             << GetFieldType(it.key(), value) << ">();\n";
+        }
+        if (reparse) {
+          ss << Indent(indent_level + 3) << seen;
+        }
+      }
+      ss << Indent(indent_level + 3) << "break;\n";
+    }
+    ss << Indent(indent_level + 2) << "default:\n";
+    ss << Indent(indent_level + 3) << "break;\n";
+    ss << Indent(indent_level + 1) << "}\n";
+    ss << Indent(indent_level) << "}\n";
+
+    if (reparse) {
+      field_index = 0;
+      for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+        ss << Indent(indent_level) << "if (!seen[" << field_index << "]) {\n";
+        ss << Indent(indent_level + 1) << GenerateFieldReset(it.key(),
+                                                             it.value());
+        ss << Indent(indent_level) << "}\n";
+      }
+    }
+  } else {
+    // Lazy parsing version, re-index the serialized document
+    ss << Indent(indent_level)
+       << "FromJsonBuffer(std::make_shared<const std::string>(j.dump()));\n";
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateClearMethod(const json& j,
+                                                    int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "void Clear() {\n";
+  if (options_.lazy_parsing) {
+    // Fields are materialized again from their defaults on the next access
+    ss << Indent(indent_level + 1) << "lazy_source_.reset();\n";
+    ss << Indent(indent_level + 1) << "lazy_spans_.fill({});\n";
+    ss << Indent(indent_level + 1) << "lazy_unknown_.clear();\n";
+    ss << Indent(indent_level + 1) << "lazy_ready_.clear();\n";
+    ss << Indent(indent_level + 1) << "lazy_dirty_.clear();\n";
+    if (options_.string_views) {
+      ss << Indent(indent_level + 1) << "lazy_strings_.clear();\n";
+    }
+  } else {
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      ss << Indent(indent_level + 1) << GenerateFieldReset(it.key(),
+                                                           it.value());
+    }
+  }
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateFieldReset(const std::string& key,
+                                                   const json& value) {
+  const std::string member = SanitizeIdentifier(key) + "_";
+  if (value.is_object()) {
+    return member + ".Clear();\n";
+  }
+  const std::string default_value = GetFieldDefault(key, value);
+  if (!GetEnumValues(key, value).empty() ||
+      (value.is_string() && options_.intern_strings)) {
+    return member + " = " + default_value + ";\n";
+  } else if (value.is_string()) {
+    return member + ".assign(" + default_value + ");\n";
+  } else if (value.is_null() && options_.intern_strings) {
+    return member + " = {};\n";
+  } else if (value.is_array() || value.is_null()) {
+    // Assigning the default elements reuses the existing ones
+    return default_value.empty() ? member + ".clear();\n"
+                                 : member + ".assign({" + default_value +
+                                       "});\n";
+  }
+  return member + " = " + default_value + ";\n";
+}
+
+std::string JsonClassGenerator::GenerateToJsonMethod(
+    const std::string& class_name,
+    const json& j,
+    int indent_level) {
+  (void)class_name;
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "json j = json::object();\n";
+
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+    const std::string& key = it.key();
+    const json& value = it.value();
+
+    if (options_.lazy_parsing) {
+      // Values that were not modified are taken from the source as they are.
+      // Nested objects that were read convert themselves, keeping what they
+      // did not modify.
+      const std::string span =
+          "lazy_spans_[" + std::to_string(field_index) + "]";
+      ss << Indent(indent_level) << "if (!lazy_"
+         << (value.is_object() ? "ready" : "dirty") << "_.test("
+         << field_index << ") && " << span << ".size != 0) {\n";
+      ss << Indent(indent_level + 1) << "j[\"" << key
+         << "\"] = json2class::ParseRaw(*lazy_source_, " << span << ");\n";
+      ss << Indent(indent_level) << "} else {\n";
+      ss << Indent(indent_level + 1) << "j[\"" << key << "\"] = " << key
+         << (value.is_object() ? "().ToJson();\n" : "();\n");
+      ss << Indent(indent_level) << "}\n";
+    } else if (value.is_object()) {
+      // Nested object
+      ss << Indent(indent_level) << "j[\"" << key << "\"] = " << key
+         << "_.ToJson();\n";
+    } else {
+      // Basic type or array
+      ss << Indent(indent_level) << "j[\"" << key << "\"] = " << key
+         << "_;\n";
+    }
+  }
+
+  if (options_.lazy_parsing) {
+    ss << Indent(indent_level)
+       << "json2class::AddRawMembers(j, lazy_source_, lazy_unknown_);\n";
+  }
+  ss << Indent(indent_level) << "return j;\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateSaxMethods(
+    const std::string& class_name,
+    const json& j,
+    int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "void FromJsonString(std::string_view text) {\n";
+  ss << Indent(indent_level + 1)
+     << "json2class::SaxReader reader(json2class::MakeSaxSlot(*this));\n";
+  ss << Indent(indent_level + 1)
+     << "json::sax_parse(text.data(), text.data() + text.size(), &reader);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level) << "void FromJsonStream(std::istream& in) {\n";
+  ss << Indent(indent_level + 1)
+     << "json2class::SaxReader reader(json2class::MakeSaxSlot(*this));\n";
+  ss << Indent(indent_level + 1) << "json::sax_parse(in, &reader);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  // A class without fields has no member to bind, so |target| stays unnamed
+  ss << Indent(indent_level) << "static json2class::SaxSlot SaxMember(void*"
+     << (j.empty() ? "" : " target") << ", std::string_view key) {\n";
+  if (!j.empty()) {
+    ss << Indent(indent_level + 1) << "auto* self = static_cast<" << class_name
+       << "*>(target);\n";
+  }
+  ss << Indent(indent_level + 1) << "switch (FieldIndex(key)) {\n";
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+    ss << Indent(indent_level + 2) << "case " << field_index << ":\n";
+    ss << Indent(indent_level + 3) << "return json2class::MakeSaxSlot(self->"
+       << SanitizeIdentifier(it.key()) << "_);\n";
+  }
+  ss << Indent(indent_level + 2) << "default:\n";
+  ss << Indent(indent_level + 3) << "return {};\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateTryMethods(const json& j,
+                                                   int indent_level) {
+  std::stringstream ss;
+
+  // Same dispatch as FromJson, but every value is type-checked before it is
+  // converted and the first mismatch is returned instead of thrown
+  ss << Indent(indent_level)
+     << "json2class::ParseStatus TryFromJson(const json& j) {\n";
+  ss << Indent(indent_level + 1) << "json2class::ParseStatus status;\n";
+  ss << Indent(indent_level + 1) << "if (!j.is_object()) {\n";
+  ss << Indent(indent_level + 2)
+     << "return {json2class::StatusCode::kTypeError, {}};\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1)
+     << "for (auto it = j.begin(); it != j.end(); ++it) {\n";
+  ss << Indent(indent_level + 2) << "bool read = true;\n";
+  ss << Indent(indent_level + 2) << "switch (FieldIndex(it.key())) {\n";
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+    const std::string read = "json2class::TryRead(it.value(), " +
+                             SanitizeIdentifier(it.key()) + "_, status);\n";
+    ss << Indent(indent_level + 3) << "case " << field_index << ":\n";
+    if (it.value().is_object()) {
+      ss << Indent(indent_level + 4) << "read = !it.value().is_object() ||\n";
+      ss << Indent(indent_level + 4) << "       " << read;
+    } else if (it.value().is_array()) {
+      ss << Indent(indent_level + 4) << "read = !it.value().is_array() ||\n";
+      ss << Indent(indent_level + 4) << "       " << read;
+    } else {
+      ss << Indent(indent_level + 4) << "read = " << read;
+    }
+    ss << Indent(indent_level + 4) << "break;\n";
+  }
+  ss << Indent(indent_level + 3) << "default:\n";
+  ss << Indent(indent_level + 4) << "break;\n";
+  ss << Indent(indent_level + 2) << "}\n";
+  ss << Indent(indent_level + 2) << "if (!read) {\n";
+  ss << Indent(indent_level + 3)
+     << "json2class::PrependPath(status, it.key());\n";
+  ss << Indent(indent_level + 3) << "return status;\n";
+  ss << Indent(indent_level + 2) << "}\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "return status;\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level)
+     << "json2class::ParseStatus TryFromJsonString(std::string_view text) {\n";
+  ss << Indent(indent_level + 1)
+     << "const json j = json::parse(text.begin(), text.end(), nullptr, "
+        "false);\n";
+  ss << Indent(indent_level + 1) << "if (j.is_discarded()) {\n";
+  ss << Indent(indent_level + 2)
+     << "return {json2class::StatusCode::kSyntaxError, {}};\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "return TryFromJson(j);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateSimdjsonMethods(const json& j,
+                                                        int indent_level) {
+  std::stringstream ss;
+  const std::string syntax_error =
+      Indent(indent_level + 2) + "json2class::SyntaxError(status);\n" +
+      Indent(indent_level + 2) + "return status;\n";
+
+  // Same dispatch as TryFromJson over an On-Demand object. Fields are
+  // visited in document order and the values of unknown keys are skipped
+  // without being parsed
+  ss << Indent(indent_level)
+     << "json2class::ParseStatus FromJson(simdjson::ondemand::value value) "
+        "{\n";
+  ss << Indent(indent_level + 1) << "json2class::ParseStatus status;\n";
+  ss << Indent(indent_level + 1) << "simdjson::ondemand::json_type type;\n";
+  ss << Indent(indent_level + 1) << "if (value.type().get(type)) {\n";
+  ss << syntax_error;
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1)
+     << "if (type != simdjson::ondemand::json_type::object) {\n";
+  ss << Indent(indent_level + 2)
+     << "return {json2class::StatusCode::kTypeError, {}};\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "simdjson::ondemand::object object;\n";
+  ss << Indent(indent_level + 1) << "if (value.get_object().get(object)) {\n";
+  ss << syntax_error;
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "for (auto field : object) {\n";
+  ss << Indent(indent_level + 2) << "std::string_view key;\n";
+  ss << Indent(indent_level + 2) << "simdjson::ondemand::value member;\n";
+  ss << Indent(indent_level + 2)
+     << "if (field.unescaped_key().get(key) || field.value().get(member)) {\n";
+  ss << Indent(indent_level + 3) << "json2class::SyntaxError(status);\n";
+  ss << Indent(indent_level + 3) << "return status;\n";
+  ss << Indent(indent_level + 2) << "}\n";
+  ss << Indent(indent_level + 2) << "bool read = true;\n";
+  ss << Indent(indent_level + 2) << "switch (FieldIndex(key)) {\n";
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+    const std::string member = SanitizeIdentifier(it.key()) + "_";
+    ss << Indent(indent_level + 3) << "case " << field_index << ":\n";
+    if (it.value().is_object() || it.value().is_array()) {
+      ss << Indent(indent_level + 4) << "read = json2class::ReadSimdjsonIf(\n";
+      ss << Indent(indent_level + 6) << "member, simdjson::ondemand::json_type::"
+         << (it.value().is_object() ? "object" : "array") << ", " << member
+         << ", status);\n";
+    } else {
+      ss << Indent(indent_level + 4) << "read = json2class::ReadSimdjson(member, "
+         << member << ", status);\n";
+    }
+    ss << Indent(indent_level + 4) << "break;\n";
+  }
+  ss << Indent(indent_level + 3) << "default:\n";
+  ss << Indent(indent_level + 4) << "break;\n";
+  ss << Indent(indent_level + 2) << "}\n";
+  ss << Indent(indent_level + 2) << "if (!read) {\n";
+  ss << Indent(indent_level + 3) << "json2class::Rejected(status, key);\n";
+  ss << Indent(indent_level + 3) << "return status;\n";
+  ss << Indent(indent_level + 2) << "}\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "return status;\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level) << "json2class::ParseStatus ParseFrom(\n";
+  ss << Indent(indent_level + 2) << "simdjson::padded_string_view text) {\n";
+  ss << Indent(indent_level + 1)
+     << "return ParseFrom(text, json2class::ThreadParser());\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  // Documents that are not objects are rejected like TryFromJson does; an
+  // object must be followed by nothing but whitespace
+  ss << Indent(indent_level) << "json2class::ParseStatus ParseFrom(\n";
+  ss << Indent(indent_level + 2) << "simdjson::padded_string_view text,\n";
+  ss << Indent(indent_level + 2) << "simdjson::ondemand::parser& parser) {\n";
+  ss << Indent(indent_level + 1) << "json2class::ParseStatus status;\n";
+  ss << Indent(indent_level + 1) << "simdjson::ondemand::document document;\n";
+  ss << Indent(indent_level + 1) << "simdjson::ondemand::json_type type;\n";
+  ss << Indent(indent_level + 1)
+     << "if (parser.iterate(text).get(document) || "
+        "document.type().get(type)) {\n";
+  ss << syntax_error;
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1)
+     << "if (type != simdjson::ondemand::json_type::object) {\n";
+  ss << Indent(indent_level + 2)
+     << "return {json2class::StatusCode::kTypeError, {}};\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "simdjson::ondemand::value value;\n";
+  ss << Indent(indent_level + 1) << "if (document.get_value().get(value)) {\n";
+  ss << syntax_error;
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "status = FromJson(value);\n";
+  ss << Indent(indent_level + 1) << "if (status.ok() && !document.at_end()) {\n";
+  ss << syntax_error;
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "return status;\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateStreamMethods(const json& j,
+                                                      int indent_level) {
+  std::stringstream ss;
+
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    if (!it.value().is_array()) {
+      continue;
+    }
+    std::string name = SanitizeIdentifier(it.key());
+    if (!name.empty()) {
+      name[0] = static_cast<char>(
+          std::toupper(static_cast<unsigned char>(name[0])));
+    }
+    const std::string member = SanitizeIdentifier(it.key()) + "_";
+    const std::string stream_type =
+        "json2class::SaxStream<decltype(" + member + ")::value_type, Callback>";
+    const std::string reader =
+        "json2class::SaxReader reader(json2class::MakeSaxSlot(*this), " +
+        CppStringLiteral(it.key()) + ", stream.slot());\n";
+
+    // The other fields are filled like FromJsonString does, and the array
+    // member itself is left unchanged
+    ss << Indent(indent_level) << "template <typename Callback>\n";
+    ss << Indent(indent_level) << "bool Stream" << name
+       << "(std::string_view text, Callback&& callback) {\n";
+    ss << Indent(indent_level + 1) << stream_type << " stream(callback);\n";
+    ss << Indent(indent_level + 1) << reader;
+    ss << Indent(indent_level + 1)
+       << "return json::sax_parse(text.data(), text.data() + text.size(), "
+          "&reader);\n";
+    ss << Indent(indent_level) << "}\n\n";
+
+    ss << Indent(indent_level) << "template <typename Callback>\n";
+    ss << Indent(indent_level) << "bool Stream" << name
+       << "(std::istream& in, Callback&& callback) {\n";
+    ss << Indent(indent_level + 1) << stream_type << " stream(callback);\n";
+    ss << Indent(indent_level + 1) << reader;
+    ss << Indent(indent_level + 1) << "return json::sax_parse(in, &reader);\n";
+    ss << Indent(indent_level) << "}\n\n";
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateToJsonStringMethods(const json& j,
+                                                            int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "template <typename Sink>\n";
+  ss << Indent(indent_level) << "void WriteJson(Sink& sink) const {\n";
+  if (j.empty() && options_.lazy_parsing) {
+    ss << Indent(indent_level + 1) << "sink.Append('{');\n";
+  } else if (j.empty()) {
+    ss << Indent(indent_level + 1) << "sink.Append(\"{}\");\n";
+  }
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+    // Keys are escaped once here and written as a single constant together
+    // with the surrounding punctuation.
+    std::string prefix = it == j.begin() ? "{" : ",";
+    prefix += json(it.key()).dump() + ":";
+    ss << Indent(indent_level + 1) << "sink.Append(" << CppStringLiteral(prefix)
+       << ");\n";
+    if (options_.lazy_parsing) {
+      // Unmodified values, and nested objects that were never read, are
+      // copied from the source bytes. Nested objects that were read write
+      // themselves the same way.
+      const std::string span =
+          "lazy_spans_[" + std::to_string(field_index) + "]";
+      ss << Indent(indent_level + 1) << "if (!lazy_"
+         << (it.value().is_object() ? "ready" : "dirty") << "_.test("
+         << field_index << ") && " << span << ".size != 0) {\n";
+      ss << Indent(indent_level + 2)
+         << "json2class::WriteRaw(sink, *lazy_source_, " << span << ");\n";
+      ss << Indent(indent_level + 1) << "} else {\n";
+      ss << Indent(indent_level + 2) << "json2class::WriteJson(sink, "
+         << it.key() << "());\n";
+      ss << Indent(indent_level + 1) << "}\n";
+    } else {
+      ss << Indent(indent_level + 1) << "json2class::WriteJson(sink, "
+         << SanitizeIdentifier(it.key()) << "_);\n";
+    }
+  }
+  if (options_.lazy_parsing) {
+    // Members of unknown keys are passed through as they are
+    ss << Indent(indent_level + 1)
+       << "json2class::WriteRawMembers(sink, lazy_source_, lazy_unknown_, "
+       << (j.empty() ? "true" : "false") << ");\n";
+  }
+  if (!j.empty() || options_.lazy_parsing) {
+    ss << Indent(indent_level + 1) << "sink.Append('}');\n";
+  }
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level) << "void ToJsonString(std::string& out) const {\n";
+  ss << Indent(indent_level + 1) << "out.clear();\n";
+  ss << Indent(indent_level + 1) << "json2class::StringSink sink(out);\n";
+  ss << Indent(indent_level + 1) << "WriteJson(sink);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level)
+     << "std::size_t ToJsonString(char* buffer, std::size_t capacity) const {\n";
+  ss << Indent(indent_level + 1)
+     << "json2class::BufferSink sink(buffer, capacity);\n";
+  ss << Indent(indent_level + 1) << "WriteJson(sink);\n";
+  ss << Indent(indent_level + 1) << "return sink.size();\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateJsonWriterSupport() {
+  static const char kJsonWriterSupport[] = R"(#ifndef JSON2CLASS_JSON_WRITER_
+#define JSON2CLASS_JSON_WRITER_
+
+namespace json2class {
+
+// Appends JSON text to a std::string.
+class StringSink {
+ public:
+  explicit StringSink(std::string& out) : out_(out) {}
+
+  void Append(const char* data, std::size_t size) { out_.append(data, size); }
+  void Append(char c) { out_.push_back(c); }
+  template <std::size_t N>
+  void Append(const char (&text)[N]) {
+    Append(text, N - 1);
+  }
+
+ private:
+  std::string& out_;
+};
+
+// Writes JSON text into a caller-provided buffer without a terminating NUL.
+// size() keeps counting past the capacity, so a caller whose buffer was too
+// small learns how many bytes are needed.
+class BufferSink {
+ public:
+  BufferSink(char* buffer, std::size_t capacity)
+      : buffer_(buffer), capacity_(capacity) {}
+
+  void Append(const char* data, std::size_t size) {
+    if (size_ < capacity_) {
+      std::memcpy(buffer_ + size_, data, std::min(size, capacity_ - size_));
+    }
+    size_ += size;
+  }
+  void Append(char c) {
+    if (size_ < capacity_) {
+      buffer_[size_] = c;
+    }
+    ++size_;
+  }
+  template <std::size_t N>
+  void Append(const char (&text)[N]) {
+    Append(text, N - 1);
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  char* buffer_;
+  std::size_t capacity_;
+  std::size_t size_ = 0;
+};
+
+// Numbers are formatted with std::to_chars. Floating point values use the
+// shortest round-trip form of the double they convert to and keep a ".0"
+// suffix like json::dump; values that JSON cannot represent are written as
+// null.
+template <typename Sink, typename T>
+std::enable_if_t<std::is_arithmetic_v<T>> WriteJson(Sink& sink, T value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    if (value) {
+      sink.Append("true");
+    } else {
+      sink.Append("false");
+    }
+  } else if constexpr (std::is_integral_v<T>) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    sink.Append(buffer, static_cast<std::size_t>(result.ptr - buffer));
+  } else {
+    if (!std::isfinite(value)) {
+      sink.Append("null");
+      return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer) - 2,
+                                static_cast<double>(value));
+    std::size_t size = static_cast<std::size_t>(result.ptr - buffer);
+    if (std::find_if(buffer, result.ptr, [](char c) {
+          return c == '.' || c == 'e';
+        }) == result.ptr) {
+      buffer[size++] = '.';
+      buffer[size++] = '0';
+    }
+    sink.Append(buffer, size);
+  }
+}
+
+// Escapes a string in one pass, copying runs of plain characters at once.
+// The bytes are written as they are, without UTF-8 validation.
+template <typename Sink>
+void WriteJson(Sink& sink, std::string_view value) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  sink.Append('"');
+  std::size_t run = 0;
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    sink.Append(value.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':
+        sink.Append("\\\"");
+        break;
+      case '\\':
+        sink.Append("\\\\");
+        break;
+      case '\b':
+        sink.Append("\\b");
+        break;
+      case '\f':
+        sink.Append("\\f");
+        break;
+      case '\n':
+        sink.Append("\\n");
+        break;
+      case '\r':
+        sink.Append("\\r");
+        break;
+      case '\t':
+        sink.Append("\\t");
+        break;
+      default: {
+        const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+        sink.Append(escaped, sizeof(escaped));
+        break;
+      }
+    }
+  }
+  sink.Append(value.data() + run, value.size() - run);
+  sink.Append('"');
+}
+
+template <typename Sink>
+void WriteJson(Sink& sink, const std::string& value) {
+  WriteJson(sink, std::string_view(value));
+}
+
+template <typename Sink, typename T>
+auto WriteJson(Sink& sink, const T& value) -> decltype(value.WriteJson(sink)) {
+  value.WriteJson(sink);
+}
+
+template <typename Sink, typename T, typename Allocator>
+void WriteJson(Sink& sink, const std::vector<T, Allocator>& value) {
+  sink.Append('[');
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    if (i != 0) {
+      sink.Append(',');
+    }
+    WriteJson(sink, static_cast<const T&>(value[i]));
+  }
+  sink.Append(']');
+}
+
+template <typename Sink,
+          typename Key,
+          typename T,
+          typename Compare,
+          typename Allocator>
+void WriteJson(Sink& sink,
+               const std::map<Key, T, Compare, Allocator>& value) {
+  sink.Append('{');
+  bool first = true;
+  for (const auto& item : value) {
+    if (!first) {
+      sink.Append(',');
+    }
+    first = false;
+    WriteJson(sink, std::string_view(item.first));
+    sink.Append(':');
+    WriteJson(sink, item.second);
+  }
+  sink.Append('}');
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_JSON_WRITER_
+
+)";
+  // Emitted only for classes with enums.
+  static const char kJsonWriterEnumSupport[] = R"(#ifndef JSON2CLASS_JSON_WRITER_ENUM_
+#define JSON2CLASS_JSON_WRITER_ENUM_
+
+namespace json2class {
+
+template <typename Sink, typename T>
+auto WriteJson(Sink& sink, const T& value)
+    -> std::enable_if_t<IsTextEnum<T>::value> {
+  WriteJson(sink, ToString(value));
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_JSON_WRITER_ENUM_
+
+)";
+  std::string support = kJsonWriterSupport;
+  if (!options_.enums.empty()) {
+    support += kJsonWriterEnumSupport;
+  }
+  return support;
+}
+
+std::string JsonClassGenerator::GenerateFieldIndexMethod(const json& j,
+                                                         int indent_level) {
+  std::stringstream ss;
+
+  std::vector<std::string> keys;
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    keys.push_back(it.key());
+  }
+
+  if (keys.empty()) {
+    ss << Indent(indent_level)
+       << "static int FieldIndex(std::string_view) {\n";
+    ss << Indent(indent_level + 1) << "return -1;\n";
+    ss << Indent(indent_level) << "}\n\n";
+    return ss.str();
+  }
+
+  ss << Indent(indent_level)
+     << "static int FieldIndex(std::string_view key) {\n";
+  ss << GenerateKeyTable(keys, "kKeys", "kFields", "key", indent_level + 1);
+  ss << Indent(indent_level + 1)
+     << "return kKeys[slot] == key ? kFields[slot] : -1;\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateKeyTable(
+    const std::vector<std::string>& keys,
+    const std::string& names,
+    const std::string& values,
+    const std::string& key_name,
+    int indent_level) {
+  std::stringstream ss;
+  KeyTable table = BuildKeyTable(keys);
+
+  ss << Indent(indent_level)
+     << "static constexpr std::uint32_t kDisplacements[] = {";
+  for (std::size_t i = 0; i < table.displacements.size(); ++i) {
+    ss << (i ? ", " : "") << table.displacements[i];
+  }
+  ss << "};\n";
+  ss << Indent(indent_level) << "static constexpr std::string_view " << names
+     << "[] = {";
+  for (std::size_t i = 0; i < table.fields.size(); ++i) {
+    ss << (i ? ", " : "")
+       << CppStringLiteral(table.fields[i] == -1 ? "" : keys[table.fields[i]]);
+  }
+  ss << "};\n";
+  ss << Indent(indent_level) << "static constexpr int " << values << "[] = {";
+  for (std::size_t i = 0; i < table.fields.size(); ++i) {
+    ss << (i ? ", " : "") << table.fields[i];
+  }
+  ss << "};\n";
+  ss << Indent(indent_level) << "const std::uint64_t hash = json2class::HashKey("
+     << key_name << ");\n";
+  ss << Indent(indent_level) << "const std::size_t slot = json2class::KeySlot(\n";
+  ss << Indent(indent_level + 2) << "hash, kDisplacements[(hash >> 32) & "
+     << (table.displacements.size() - 1) << "], " << (table.fields.size() - 1)
+     << ");\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateEnum(
+    const std::string& key,
+    const std::vector<std::string>& values,
+    int indent_level) {
+  std::stringstream ss;
+  const std::string enum_name = EnumClassName(key);
+  const std::vector<std::string> enumerators =
+      EnumeratorNames(values, options_.open_enums);
+  const std::size_t count = values.size() + (options_.open_enums ? 1 : 0);
+
+  ss << Indent(indent_level) << "enum class " << enum_name << " : std::uint"
+     << EnumWidth(count) * 8 << "_t {\n";
+  for (const std::string& enumerator : enumerators) {
+    ss << Indent(indent_level + 1) << enumerator << ",\n";
+  }
+  if (options_.open_enums) {
+    // Strings outside the enum, whose text is kept by json2class::OpenEnum
+    ss << Indent(indent_level + 1) << "kOther,\n";
+  }
+  ss << Indent(indent_level) << "};\n\n";
+
+  ss << Indent(indent_level) << "friend std::string_view ToString("
+     << enum_name << " value) {\n";
+  ss << Indent(indent_level + 1) << "static constexpr std::string_view kNames[] = {";
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    ss << (i ? ", " : "") << CppStringLiteral(values[i]);
+  }
+  ss << (options_.open_enums ? ", \"\"" : "") << "};\n";
+  ss << Indent(indent_level + 1)
+     << "return kNames[static_cast<std::size_t>(value)];\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  // The same perfect hash as FieldIndex
+  ss << Indent(indent_level) << "friend bool FromString(std::string_view text, "
+     << enum_name << "& value) {\n";
+  ss << GenerateKeyTable(values, "kNames", "kValues", "text",
+                         indent_level + 1);
+  ss << Indent(indent_level + 1)
+     << "if (kValues[slot] == -1 || kNames[slot] != text) {\n";
+  ss << Indent(indent_level + 2) << "return false;\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "value = static_cast<" << enum_name
+     << ">(kValues[slot]);\n";
+  ss << Indent(indent_level + 1) << "return true;\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level) << "friend void to_json(json& j, " << enum_name
+     << " value) {\n";
+  ss << Indent(indent_level + 1) << "j = ToString(value);\n";
+  ss << Indent(indent_level) << "}\n\n";
+  ss << Indent(indent_level) << "friend void from_json(const json& j, "
+     << enum_name << "& value) {\n";
+  ss << Indent(indent_level + 1) << "json2class::ReadEnum(j, value);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateFieldMaskMethods(const json& j,
+                                                         int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "enum class Field {";
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    ss << (it == j.begin() ? " " : ", ") << SanitizeIdentifier(it.key());
+  }
+  ss << (j.empty() ? "};\n" : " };\n");
+  ss << Indent(indent_level)
+     << "using FieldMask = json2class::FieldMask<Field, " << j.size()
+     << ">;\n\n";
+
+  ss << Indent(indent_level)
+     << "void FromJson(const json& j, FieldMask mask) {\n";
+  ss << GenerateFromJsonMethod("", j, indent_level + 1, ReadMode::kMasked);
+  ss << Indent(indent_level) << "}\n\n";
+
+  // Values of other fields are skipped by the structural scanner, without
+  // being tokenized or allocated
+  ss << Indent(indent_level)
+     << "void FromJsonString(std::string_view text, FieldMask mask) {\n";
+  ss << Indent(indent_level + 1) << "json2class::ScanJsonObject(\n";
+  ss << Indent(indent_level + 3) << "text.data(), text.data() + text.size(),\n";
+  ss << Indent(indent_level + 3)
+     << "[this, mask](std::string_view key, const char* begin,\n";
+  ss << Indent(indent_level + 3)
+     << "             const char* end, const char*) {\n";
+  ss << Indent(indent_level + 4) << "if (mask.test(FieldIndex(key))) {\n";
+  ss << Indent(indent_level + 5)
+     << "json2class::SaxReader reader(SaxMember(this, key));\n";
+  ss << Indent(indent_level + 5) << "json::sax_parse(begin, end, &reader);\n";
+  ss << Indent(indent_level + 4) << "}\n";
+  ss << Indent(indent_level + 3) << "});\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateStatusSupport() {
+  static const char kStatusSupport[] = R"(#ifndef JSON2CLASS_STATUS_
+#define JSON2CLASS_STATUS_
+
+// Like nlohmann::json, errors abort instead of throwing when exceptions are
+// disabled or JSON_NOEXCEPTION is defined. TryFromJson never needs them.
+#if (defined(__cpp_exceptions) || defined(__EXCEPTIONS) || \
+     defined(_CPPUNWIND)) &&                                \
+    !defined(JSON_NOEXCEPTION)
+#define JSON2CLASS_EXCEPTIONS 1
+#define JSON2CLASS_THROW(exception) throw exception
+#else
+#define JSON2CLASS_EXCEPTIONS 0
+#define JSON2CLASS_THROW(exception) \
+  (static_cast<void>(exception), std::abort())
+#endif
+
+namespace json2class {
+
+// Reports a value that cannot be stored in its member with the
+// json::type_error that json::get throws for values of the wrong type, so
+// callers such as ParseNdjson treat it as bad input.
+[[noreturn]] inline void ThrowTypeError(const std::string& message) {
+  JSON2CLASS_THROW(json::type_error::create(302, message, nullptr));
+}
+
+enum class StatusCode : std::uint8_t {
+  kOk,
+  kSyntaxError,   // The text is not valid JSON.
+  kTypeError,     // A value cannot be stored in its member.
+  kUnknownValue,  // A string is not one of the values of its enum.
+};
+
+// Result of TryFromJson. |path| is the JSON pointer of the rejected value,
+// such as "/items/2/name", and stays empty on success and for syntax errors.
+struct ParseStatus {
+  StatusCode code = StatusCode::kOk;
+  std::string path;
+
+  bool ok() const { return code == StatusCode::kOk; }
+  explicit operator bool() const { return ok(); }
+};
+
+// Adds the key or index of an enclosing value in front of |status.path|.
+inline void PrependPath(ParseStatus& status, std::string_view token) {
+  std::string segment = "/";
+  for (char c : token) {
+    segment += c == '~' ? "~0" : c == '/' ? "~1" : std::string(1, c);
+  }
+  status.path.insert(0, segment);
+}
+
+inline bool TypeError(ParseStatus& status) {
+  status.code = StatusCode::kTypeError;
+  return false;
+}
+
+// Stores |number| in |value| if the type of |value| can hold it. Integer
+// members take integers inside their range and doubles without a fraction,
+// float members take doubles inside the float range.
+template <typename T, typename N>
+bool NarrowNumber(N number, T& value) {
+  using Limits = std::numeric_limits<T>;
+  if constexpr (std::is_floating_point_v<T>) {
+    if constexpr (std::is_floating_point_v<N> && sizeof(T) < sizeof(N)) {
+      if (number < -static_cast<N>(Limits::max()) ||
+          number > static_cast<N>(Limits::max())) {
+        return false;
+      }
+    }
+  } else if constexpr (std::is_floating_point_v<N>) {
+    // 2^digits is exact as a double, unlike the largest value of T
+    const N limit = static_cast<N>(Limits::max() / 2 + 1) * 2;
+    if (!(number >= static_cast<N>(Limits::min()) && number < limit) ||
+        static_cast<N>(static_cast<T>(number)) != number) {
+      return false;
+    }
+  } else if constexpr (std::is_signed_v<N>) {
+    if (number < 0 ? !std::is_signed_v<T> ||
+                         static_cast<std::intmax_t>(number) <
+                             static_cast<std::intmax_t>(Limits::min())
+                   : static_cast<std::uintmax_t>(number) >
+                         static_cast<std::uintmax_t>(Limits::max())) {
+      return false;
+    }
+  } else if (static_cast<std::uintmax_t>(number) >
+             static_cast<std::uintmax_t>(Limits::max())) {
+    return false;
+  }
+  value = static_cast<T>(number);
+  return true;
+}
+
+// Converts a number or boolean like json::get, but rejects numbers that do
+// not fit |value| instead of wrapping or truncating them.
+template <typename T>
+bool ConvertNumber(const json& j, T& value) {
+  if (j.is_boolean()) {
+    value = static_cast<T>(*j.get_ptr<const bool*>());
+    return true;
+  }
+  if constexpr (!std::is_same_v<T, bool>) {
+    if (j.is_number_unsigned()) {
+      return NarrowNumber(*j.get_ptr<const json::number_unsigned_t*>(), value);
+    }
+    if (j.is_number_integer()) {
+      return NarrowNumber(*j.get_ptr<const json::number_integer_t*>(), value);
+    }
+    if (j.is_number_float()) {
+      return NarrowNumber(*j.get_ptr<const json::number_float_t*>(), value);
+    }
+  }
+  return false;
+}
+
+// The throwing form of ConvertNumber behind FromJson.
+template <typename T>
+void ReadNumber(const json& j, T& value) {
+  if (std::is_same_v<T, bool> || (!j.is_number() && !j.is_boolean())) {
+    j.get_to(value);
+    return;
+  }
+  if (!ConvertNumber(j, value)) {
+    ThrowTypeError("json2class: " + j.dump() + " does not fit a " +
+                   (std::is_floating_point_v<T> ? "float"
+                    : std::is_signed_v<T>       ? "signed"
+                                                : "unsigned") +
+                   " member of " + std::to_string(sizeof(T) * 8) + " bits");
+  }
+}
+
+// Checked readers behind TryFromJson. Each accepts exactly the values that
+// FromJson accepts for its type, and reports the others in |status|
+// instead of throwing.
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> std::enable_if_t<std::is_arithmetic_v<T>, bool>;
+inline bool TryRead(const json& j, bool& value, ParseStatus& status);
+template <typename Allocator>
+bool TryRead(const json& j,
+             std::basic_string<char, std::char_traits<char>, Allocator>& value,
+             ParseStatus& status);
+template <typename T, typename Allocator>
+bool TryRead(const json& j,
+             std::vector<T, Allocator>& value,
+             ParseStatus& status);
+template <typename K, typename T, typename Compare, typename Allocator>
+bool TryRead(const json& j,
+             std::map<K, T, Compare, Allocator>& value,
+             ParseStatus& status);
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> decltype(value.TryFromJson(j), bool());
+
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> std::enable_if_t<std::is_arithmetic_v<T>, bool> {
+  if (!ConvertNumber(j, value)) {
+    return TypeError(status);
+  }
+  return true;
+}
+
+inline bool TryRead(const json& j, bool& value, ParseStatus& status) {
+  if (!j.is_boolean()) {
+    return TypeError(status);
+  }
+  value = *j.get_ptr<const bool*>();
+  return true;
+}
+
+template <typename Allocator>
+bool TryRead(const json& j,
+             std::basic_string<char, std::char_traits<char>, Allocator>& value,
+             ParseStatus& status) {
+  if (!j.is_string()) {
+    return TypeError(status);
+  }
+  value.assign(*j.get_ptr<const std::string*>());
+  return true;
+}
+
+template <typename T, typename Allocator>
+bool TryRead(const json& j,
+             std::vector<T, Allocator>& value,
+             ParseStatus& status) {
+  if (!j.is_array()) {
+    return TypeError(status);
+  }
+  value.clear();
+  value.reserve(j.size());
+  for (std::size_t i = 0; i < j.size(); ++i) {
+    bool read;
+    if constexpr (std::is_same_v<T, bool>) {
+      bool element = false;
+      read = TryRead(j[i], element, status);
+      value.push_back(element);
+    } else {
+      read = TryRead(j[i], value.emplace_back(), status);
+    }
+    if (!read) {
+      PrependPath(status, std::to_string(i));
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename K, typename T, typename Compare, typename Allocator>
+bool TryRead(const json& j,
+             std::map<K, T, Compare, Allocator>& value,
+             ParseStatus& status) {
+  if (!j.is_object()) {
+    return TypeError(status);
+  }
+  value.clear();
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    if (!TryRead(it.value(), value[K(it.key(), value.get_allocator())],
+                 status)) {
+      PrependPath(status, it.key());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Generated classes check their own fields.
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> decltype(value.TryFromJson(j), bool()) {
+  ParseStatus nested = value.TryFromJson(j);
+  if (!nested.ok()) {
+    status = std::move(nested);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_STATUS_
+
+)";
+  return kStatusSupport;
+}
+
+std::string JsonClassGenerator::GenerateKeyHashSupport() {
+  static const char kKeyHashSupport[] = R"(#ifndef JSON2CLASS_KEY_HASH_
+#define JSON2CLASS_KEY_HASH_
+
+namespace json2class {
+
+// FNV-1a hash of an object key, the first level of the generated perfect
+// hash tables.
+constexpr std::uint64_t HashKey(std::string_view key) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Maps a key hash and its bucket displacement to a table slot.
+constexpr std::size_t KeySlot(std::uint64_t hash,
+                              std::uint32_t displacement,
+                              std::size_t mask) {
+  hash ^= displacement;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return static_cast<std::size_t>(hash & mask);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_KEY_HASH_
+
+)";
+  return kKeyHashSupport;
+}
+
+std::string JsonClassGenerator::GenerateEnumSupport() {
+  static const char kEnumSupport[] = R"(#ifndef JSON2CLASS_ENUM_
+#define JSON2CLASS_ENUM_
+
+namespace json2class {
+
+// The value of an enum field that also accepts strings outside its enum.
+// Those are stored as Enum::kOther together with their text.
+template <typename Enum>
+struct OpenEnum {
+  Enum value{};
+  std::string text;  // The string, if |value| is kOther.
+
+  OpenEnum() = default;
+  OpenEnum(Enum value) : value(value) {}
+
+  friend bool operator==(const OpenEnum& a, const OpenEnum& b) {
+    return a.value == b.value && a.text == b.text;
+  }
+  friend bool operator!=(const OpenEnum& a, const OpenEnum& b) {
+    return !(a == b);
+  }
+  friend bool operator==(const OpenEnum& a, Enum b) { return a.value == b; }
+  friend bool operator!=(const OpenEnum& a, Enum b) { return a.value != b; }
+};
+
+// Generated enums define ToString and FromString as friends of the class
+// that declares them, so they are found by argument-dependent lookup.
+template <typename Enum>
+std::string_view ToString(const OpenEnum<Enum>& value) {
+  if (value.value == Enum::kOther) {
+    return value.text;
+  }
+  return ToString(value.value);
+}
+
+template <typename Enum>
+bool FromString(std::string_view text, OpenEnum<Enum>& value) {
+  if (FromString(text, value.value)) {
+    value.text.clear();
+  } else {
+    value.value = Enum::kOther;
+    value.text.assign(text.data(), text.size());
+  }
+  return true;
+}
+
+// Types that are read from and written as a JSON string through FromString
+// and ToString.
+template <typename T, typename = void>
+struct IsTextEnum : std::false_type {};
+
+template <typename T>
+struct IsTextEnum<T,
+                  std::void_t<decltype(FromString(std::string_view(),
+                                                  std::declval<T&>()))>>
+    : std::true_type {};
+
+template <typename T>
+void ParseEnum(std::string_view text, T& value) {
+  if (!FromString(text, value)) {
+    ThrowTypeError("json2class: unknown enum value \"" + std::string(text) +
+                   "\"");
+  }
+}
+
+// Reads an enum like json::get reads a string; other types throw the same
+// json::type_error.
+template <typename T>
+void ReadEnum(const json& j, T& value) {
+  if (const std::string* text = j.get_ptr<const std::string*>()) {
+    ParseEnum(*text, value);
+  } else {
+    ParseEnum(j.get<std::string>(), value);
+  }
+}
+
+template <typename Enum>
+void to_json(json& j, const OpenEnum<Enum>& value) {
+  j = ToString(value);
+}
+
+template <typename Enum>
+void from_json(const json& j, OpenEnum<Enum>& value) {
+  ReadEnum(j, value);
+}
+
+inline bool UnknownValue(ParseStatus& status) {
+  status.code = StatusCode::kUnknownValue;
+  return false;
+}
+
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> std::enable_if_t<IsTextEnum<T>::value, bool> {
+  if (!j.is_string()) {
+    return TypeError(status);
+  }
+  return FromString(*j.get_ptr<const std::string*>(), value)
+             ? true
+             : UnknownValue(status);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_ENUM_
+
+)";
+  return kEnumSupport;
+}
+
+std::string JsonClassGenerator::GenerateInternSupport() {
+  static const char kInternSupport[] = R"(#ifndef JSON2CLASS_INTERN_
+#define JSON2CLASS_INTERN_
+
+namespace json2class {
+
+class InternPool;
+
+// A string stored once in an InternPool. Copies share the pooled bytes, so
+// a handle is the size of a std::string_view and stays valid as long as its
+// pool. Strings made outside of any InternScope own a reference-counted copy
+// of their bytes instead, which their copies share.
+class InternedString {
+ public:
+  InternedString() = default;
+
+  // Interns |text| into the current pool of the thread, see InternScope, or
+  // copies it when there is none.
+  explicit InternedString(std::string_view text);
+
+  // Refers to |text| without copying it. |text| must outlive every copy, as
+  // string literals do.
+  static InternedString Literal(std::string_view text) {
+    return InternedString(text.data(), text.size());
+  }
+
+  InternedString(const InternedString& other)
+      : data_(other.data_), size_(other.size_) {
+    Retain();
+  }
+  InternedString(InternedString&& other) noexcept
+      : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+  InternedString& operator=(InternedString other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~InternedString() { Release(); }
+
+  std::string_view view() const { return std::string_view(data_, size()); }
+  operator std::string_view() const { return view(); }
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_ & ~kOwned; }
+  bool empty() const { return size() == 0; }
+  void clear() { *this = InternedString(); }
+
+  // Strings of one pool are equal only if they are the same string, which
+  // is checked first.
+  friend bool operator==(const InternedString& a, const InternedString& b) {
+    return (a.data() == b.data() && a.size() == b.size()) ||
+           a.view() == b.view();
+  }
+  friend bool operator!=(const InternedString& a, const InternedString& b) {
+    return !(a == b);
+  }
+  friend bool operator==(const InternedString& a, std::string_view b) {
+    return a.view() == b;
+  }
+  friend bool operator!=(const InternedString& a, std::string_view b) {
+    return a.view() != b;
+  }
+  friend bool operator==(std::string_view a, const InternedString& b) {
+    return a == b.view();
+  }
+  friend bool operator!=(std::string_view a, const InternedString& b) {
+    return a != b.view();
+  }
+  friend bool operator<(const InternedString& a, const InternedString& b) {
+    return a.view() < b.view();
+  }
+
+ private:
+  friend class InternPool;
+
+  // The reference count in front of the bytes of an owned string.
+  using Count = std::atomic<std::size_t>;
+
+  // Set in |size_| for owned strings.
+  static constexpr std::size_t kOwned = ~(~std::size_t{0} >> 1);
+
+  InternedString(const char* data, std::size_t size)
+      : data_(data), size_(size) {}
+
+  static InternedString Own(std::string_view text) {
+    if (text.empty()) {
+      return InternedString();
+    }
+    char* block =
+        static_cast<char*>(::operator new(sizeof(Count) + text.size()));
+    new (block) Count(1);
+    std::memcpy(block + sizeof(Count), text.data(), text.size());
+    return InternedString(block + sizeof(Count), text.size() | kOwned);
+  }
+
+  Count& count() const {
+    return *reinterpret_cast<Count*>(const_cast<char*>(data_) - sizeof(Count));
+  }
+
+  void Retain() {
+    if ((size_ & kOwned) != 0) {
+      count().fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void Release() {
+    if ((size_ & kOwned) != 0 &&
+        count().fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      count().~Count();
+      ::operator delete(const_cast<char*>(data_) - sizeof(Count));
+    }
+  }
+
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Deduplicates strings into immutable storage that lives as long as the
+// pool. Strings are spread over shards by hash, each with its own lock, so
+// that many threads can intern at once.
+class InternPool {
+ public:
+  explicit InternPool(std::size_t shards = 16) {
+    std::size_t count = 1;
+    while (count < shards) {
+      count <<= 1;
+    }
+    shards_.reset(new Shard[count]);
+    mask_ = count - 1;
+  }
+
+  InternPool(const InternPool&) = delete;
+  InternPool& operator=(const InternPool&) = delete;
+
+  InternedString Intern(std::string_view text) {
+    if (text.empty()) {
+      return InternedString();
+    }
+    Shard& shard = shards_[(HashKey(text) >> 32) & mask_];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.strings.find(text);
+    if (it == shard.strings.end()) {
+      it = shard.strings.insert(shard.Store(text)).first;
+    }
+    return InternedString(it->data(), it->size());
+  }
+
+  // The number of distinct strings.
+  std::size_t size() const {
+    std::size_t size = 0;
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      size += shards_[i].strings.size();
+    }
+    return size;
+  }
+
+  // The bytes of string storage allocated by the pool.
+  std::size_t bytes() const {
+    std::size_t bytes = 0;
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      std::lock_guard<std::mutex> lock(shards_[i].mutex);
+      bytes += shards_[i].bytes;
+    }
+    return bytes;
+  }
+
+ private:
+  static constexpr std::size_t kBlockSize = 4096;
+
+  // Shards sit on their own cache lines so that their locks do not contend.
+  struct alignas(64) Shard {
+    mutable std::mutex mutex;
+    std::unordered_set<std::string_view> strings;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* next = nullptr;
+    std::size_t left = 0;
+    std::size_t bytes = 0;
+
+    // Copies |text| into the blocks of the shard. Long strings get a block
+    // of their own.
+    std::string_view Store(std::string_view text) {
+      char* data;
+      if (text.size() > kBlockSize / 4) {
+        blocks.emplace_back(new char[text.size()]);
+        data = blocks.back().get();
+        bytes += text.size();
+      } else {
+        if (left < text.size()) {
+          blocks.emplace_back(new char[kBlockSize]);
+          next = blocks.back().get();
+          left = kBlockSize;
+          bytes += kBlockSize;
+        }
+        data = next;
+        next += text.size();
+        left -= text.size();
+      }
+      std::memcpy(data, text.data(), text.size());
+      return std::string_view(data, text.size());
+    }
+  };
+
+  std::unique_ptr<Shard[]> shards_;
+  std::size_t mask_ = 0;
+};
+
+inline InternPool*& InternPoolSlot() {
+  thread_local InternPool* pool = nullptr;
+  return pool;
+}
+
+// Returns the pool of the innermost InternScope on this thread, or nullptr
+// outside of any scope.
+inline InternPool* CurrentInternPool() { return InternPoolSlot(); }
+
+// Makes the readers on this thread intern into |pool| while it exists.
+// Batch readers pass the pool on to their worker threads.
+class InternScope {
+ public:
+  explicit InternScope(InternPool& pool) : previous_(InternPoolSlot()) {
+    InternPoolSlot() = &pool;
+  }
+  ~InternScope() { InternPoolSlot() = previous_; }
+
+  InternScope(const InternScope&) = delete;
+  InternScope& operator=(const InternScope&) = delete;
+
+ private:
+  InternPool* previous_;
+};
+
+inline InternedString::InternedString(std::string_view text) {
+  if (InternPool* pool = CurrentInternPool()) {
+    *this = pool->Intern(text);
+  } else {
+    *this = Own(text);
+  }
+}
+
+inline void to_json(json& j, const InternedString& value) {
+  j = value.view();
+}
+
+// Rejects other types with the same json::type_error as json::get.
+inline void from_json(const json& j, InternedString& value) {
+  if (const std::string* text = j.get_ptr<const std::string*>()) {
+    value = InternedString(*text);
+  } else {
+    value = InternedString(j.get<std::string>());
+  }
+}
+
+inline bool TryRead(const json& j, InternedString& value, ParseStatus& status) {
+  if (!j.is_string()) {
+    return TypeError(status);
+  }
+  value = InternedString(*j.get_ptr<const std::string*>());
+  return true;
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_INTERN_
+
+)";
+  return kInternSupport;
+}
+
+std::string JsonClassGenerator::GenerateInternMethods(
+    const std::string& class_name,
+    int indent_level) {
+  std::stringstream ss;
+
+  // The readers intern into the pool of the innermost json2class::InternScope
+  ss << Indent(indent_level)
+     << "void FromJson(const json& j, json2class::InternPool& pool) {\n";
+  ss << Indent(indent_level + 1) << "json2class::InternScope scope(pool);\n";
+  ss << Indent(indent_level + 1) << "FromJson(j);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level) << "void FromJsonString(std::string_view text, "
+                                "json2class::InternPool& pool) {\n";
+  ss << Indent(indent_level + 1) << "json2class::InternScope scope(pool);\n";
+  ss << Indent(indent_level + 1) << "FromJsonString(text);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  if (options_.ndjson) {
+    ss << Indent(indent_level) << "static json2class::NdjsonBatch<"
+       << class_name << "> ParseNdjson(\n";
+    ss << Indent(indent_level + 2) << "std::string_view buffer,\n";
+    ss << Indent(indent_level + 2) << "unsigned threads,\n";
+    ss << Indent(indent_level + 2) << "json2class::InternPool& pool) {\n";
+    ss << Indent(indent_level + 1) << "return json2class::ParseNdjson<"
+       << class_name << ">(\n";
+    ss << Indent(indent_level + 3) << "buffer, threads,\n";
+    ss << Indent(indent_level + 3)
+       << "[&pool](std::string_view chunk,\n";
+    ss << Indent(indent_level + 3) << "        json2class::NdjsonBatch<"
+       << class_name << ">& batch) {\n";
+    ss << Indent(indent_level + 4) << "json2class::InternScope scope(pool);\n";
+    ss << Indent(indent_level + 4)
+       << "return json2class::ParseNdjsonChunk(chunk, batch);\n";
+    ss << Indent(indent_level + 3) << "});\n";
+    ss << Indent(indent_level) << "}\n\n";
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateJsonScanSupport() {
+  static const char kJsonScanSupport[] = R"(#ifndef JSON2CLASS_JSON_SCAN_
+#define JSON2CLASS_JSON_SCAN_
+
+namespace json2class {
+
+// Reports malformed input the same way json::parse does.
+[[noreturn]] inline void ThrowParseError(const char* begin, const char* end) {
+  json parsed = json::parse(begin, end);
+  (void)parsed;
+  JSON2CLASS_THROW(std::invalid_argument("json2class: malformed JSON object"));
+}
+
+inline const char* SkipJsonSpace(const char* p, const char* end) {
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    ++p;
+  }
+  return p;
+}
+
+// Returns the position after the string that starts at |p|, or nullptr if it
+// is not terminated.
+inline const char* SkipJsonString(const char* p, const char* end) {
+  const char* const begin = p;
+  for (++p; p < end; ++p) {
+    p = static_cast<const char*>(
+        std::memchr(p, '"', static_cast<std::size_t>(end - p)));
+    if (p == nullptr) {
+      return nullptr;
+    }
+    const char* q = p;
+    while (q - 1 > begin && q[-1] == '\\') {
+      --q;
+    }
+    if ((p - q) % 2 == 0) {
+      return p + 1;
+    }
+  }
+  return nullptr;
+}
+
+inline bool IsJsonDelimiter(char c) {
+  return c == ',' || c == ':' || c == '}' || c == ']' || c == ' ' ||
+         c == '\t' || c == '\n' || c == '\r';
+}
+
+// Returns the position after the number, true, false or null that starts at
+// |p|, or nullptr if there is none.
+inline const char* SkipJsonScalar(const char* p, const char* end) {
+  const auto digits = [end](const char* q) -> const char* {
+    const char* const first = q;
+    while (q != end && *q >= '0' && *q <= '9') {
+      ++q;
+    }
+    return q == first ? nullptr : q;
+  };
+  if (*p == 't' || *p == 'f' || *p == 'n') {
+    const std::string_view literal =
+        *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+    if (static_cast<std::size_t>(end - p) < literal.size() ||
+        std::string_view(p, literal.size()) != literal) {
+      return nullptr;
+    }
+    p += literal.size();
+  } else {
+    if (*p == '-') {
+      ++p;
+    }
+    if (p != end && *p == '0') {
+      ++p;
+    } else if ((p = digits(p)) == nullptr) {
+      return nullptr;
+    }
+    if (p != end && *p == '.' && (p = digits(p + 1)) == nullptr) {
+      return nullptr;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+      ++p;
+      if (p != end && (*p == '+' || *p == '-')) {
+        ++p;
+      }
+      if ((p = digits(p)) == nullptr) {
+        return nullptr;
+      }
+    }
+  }
+  return p == end || IsJsonDelimiter(*p) ? p : nullptr;
+}
+
+// Returns the position after the value that starts at |p|, or nullptr if it
+// is malformed. Brackets, strings and the tokens of numbers and literals are
+// checked, so that skipped values are rejected like parsed ones; commas and
+// colons are not.
+inline const char* SkipJsonValue(const char* p, const char* end) {
+  if (p == end) {
+    return nullptr;
+  }
+  if (*p == '"') {
+    return SkipJsonString(p, end);
+  }
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (p < end) {
+      if (*p == '"') {
+        p = SkipJsonString(p, end);
+        if (p == nullptr) {
+          return nullptr;
+        }
+        continue;
+      }
+      if (*p == '{' || *p == '[') {
+        ++depth;
+      } else if ((*p == '}' || *p == ']') && --depth == 0) {
+        return p + 1;
+      } else if (!IsJsonDelimiter(*p)) {
+        p = SkipJsonScalar(p, end);
+        if (p == nullptr) {
+          return nullptr;
+        }
+        continue;
+      }
+      ++p;
+    }
+    return nullptr;
+  }
+  return SkipJsonScalar(p, end);
+}
+
+// Scans the object in [begin, end) once and calls |member| with every key,
+// the text of its value and where the member starts, at the quote of its key.
+// Values are checked as SkipJsonValue does, never parsed. Returns false if the
+// text is a JSON value that is not an object; malformed text throws
+// json::parse_error.
+template <typename Member>
+bool ScanJsonObject(const char* begin, const char* end, Member&& member) {
+  const char* p = SkipJsonSpace(begin, end);
+  if (p == end || *p != '{') {
+    if (!json::accept(begin, end)) {
+      ThrowParseError(begin, end);
+    }
+    return false;
+  }
+  p = SkipJsonSpace(p + 1, end);
+  if (p != end && *p == '}') {
+    p = SkipJsonSpace(p + 1, end);
+  } else {
+    std::string unescaped;
+    while (true) {
+      if (p == end || *p != '"') {
+        ThrowParseError(begin, end);
+      }
+      const char* const member_begin = p;
+      const char* key_end = SkipJsonString(p, end);
+      if (key_end == nullptr) {
+        ThrowParseError(begin, end);
+      }
+      std::string_view key(p + 1, static_cast<std::size_t>(key_end - p - 2));
+      if (key.find('\\') != std::string_view::npos) {
+        unescaped = json::parse(p, key_end).get<std::string>();
+        key = unescaped;
+      }
+      p = SkipJsonSpace(key_end, end);
+      if (p == end || *p != ':') {
+        ThrowParseError(begin, end);
+      }
+      p = SkipJsonSpace(p + 1, end);
+      const char* value_end = SkipJsonValue(p, end);
+      if (value_end == nullptr) {
+        ThrowParseError(begin, end);
+      }
+      member(key, p, value_end, member_begin);
+      p = SkipJsonSpace(value_end, end);
+      if (p != end && *p == ',') {
+        p = SkipJsonSpace(p + 1, end);
+      } else if (p != end && *p == '}') {
+        p = SkipJsonSpace(p + 1, end);
+        break;
+      } else {
+        ThrowParseError(begin, end);
+      }
+    }
+  }
+  if (p != end) {
+    ThrowParseError(begin, end);
+  }
+  return true;
+}
+
+// Scans the array in [begin, end) once and calls |element| with the text of
+// every element, like ScanJsonObject. Returns false if the text is a JSON
+// value that is not an array; malformed text throws json::parse_error.
+template <typename Element>
+bool ScanJsonArray(const char* begin, const char* end, Element&& element) {
+  const char* p = SkipJsonSpace(begin, end);
+  if (p == end || *p != '[') {
+    if (!json::accept(begin, end)) {
+      ThrowParseError(begin, end);
+    }
+    return false;
+  }
+  p = SkipJsonSpace(p + 1, end);
+  if (p != end && *p == ']') {
+    p = SkipJsonSpace(p + 1, end);
+  } else {
+    while (true) {
+      const char* value_end = SkipJsonValue(p, end);
+      if (value_end == nullptr) {
+        ThrowParseError(begin, end);
+      }
+      element(p, value_end);
+      p = SkipJsonSpace(value_end, end);
+      if (p != end && *p == ',') {
+        p = SkipJsonSpace(p + 1, end);
+      } else if (p != end && *p == ']') {
+        p = SkipJsonSpace(p + 1, end);
+        break;
+      } else {
+        ThrowParseError(begin, end);
+      }
+    }
+  }
+  if (p != end) {
+    ThrowParseError(begin, end);
+  }
+  return true;
+}
+
+// A set of fields of a generated class, named by its Field enum. Parsing
+// with a mask reads only the fields in it.
+template <typename Field, std::size_t N>
+class FieldMask {
+ public:
+  constexpr FieldMask() = default;
+  constexpr FieldMask(std::initializer_list<Field> fields) {
+    for (Field field : fields) {
+      set(field);
+    }
+  }
+
+  constexpr FieldMask& set(Field field) {
+    const auto index = static_cast<std::size_t>(field);
+    words_[index / 64] |= std::uint64_t{1} << (index % 64);
+    return *this;
+  }
+  constexpr bool test(Field field) const {
+    return test(static_cast<int>(field));
+  }
+  // Takes the index returned by FieldIndex; -1 is never set.
+  constexpr bool test(int index) const {
+    return index >= 0 && static_cast<std::size_t>(index) < N &&
+           ((words_[index / 64] >> (index % 64)) & 1) != 0;
+  }
+
+ private:
+  std::uint64_t words_[N == 0 ? 1 : (N + 63) / 64] = {};
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_JSON_SCAN_
+
+)";
+  return kJsonScanSupport;
+}
+
+std::string JsonClassGenerator::GenerateReaderSupport() {
+  static const char kReaderSupport[] = R"(#ifndef JSON2CLASS_READERS_
+#define JSON2CLASS_READERS_
+
+namespace json2class {
+
+// Readers behind FromJson(const json&). They assign into the existing value,
+// so strings and vectors keep their capacity and array elements are reused;
+// values of the wrong type throw the same json::type_error as json::get.
+template <typename T>
+auto AssignJson(const json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>>;
+inline void AssignJson(const json& j, std::string& value);
+template <typename T>
+void AssignJson(const json& j, std::vector<T>& value);
+inline void AssignJson(const json& j, std::vector<bool>& value);
+template <typename T>
+void AssignJson(const json& j, std::map<std::string, T>& value);
+template <typename T>
+auto AssignJson(const json& j, T& value) -> decltype(value.Reparse(j));
+
+template <typename T>
+auto AssignJson(const json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>> {
+  ReadNumber(j, value);
+}
+
+inline void AssignJson(const json& j, std::string& value) {
+  if (!j.is_string()) {
+    j.get_to(value);
+    return;
+  }
+  value.assign(*j.get_ptr<const std::string*>());
+}
+
+template <typename T>
+void AssignJson(const json& j, std::vector<T>& value) {
+  if (!j.is_array()) {
+    j.get_to(value);
+    return;
+  }
+  value.resize(j.size());
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    AssignJson(j[i], value[i]);
+  }
+}
+
+inline void AssignJson(const json& j, std::vector<bool>& value) {
+  if (!j.is_array()) {
+    j.get_to(value);
+    return;
+  }
+  value.clear();
+  for (const json& element : j) {
+    value.push_back(element.get<bool>());
+  }
+}
+
+template <typename T>
+void AssignJson(const json& j, std::map<std::string, T>& value) {
+  j.get_to(value);
+}
+
+// An element of a class type becomes what a new element would have been.
+template <typename T>
+auto AssignJson(const json& j, T& value) -> decltype(value.Reparse(j)) {
+  value.Reparse(j);
+}
+
+// Readers behind FromJson(json&&). Strings and the elements of arrays and
+// objects are moved out of |j| instead of copied; values of the wrong type
+// throw the same json::type_error as json::get.
+template <typename T>
+auto MoveJson(json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>>;
+inline void MoveJson(json& j, std::string& value);
+template <typename T>
+void MoveJson(json& j, std::vector<T>& value);
+inline void MoveJson(json& j, std::vector<bool>& value);
+template <typename T>
+void MoveJson(json& j, std::map<std::string, T>& value);
+template <typename T>
+auto MoveJson(json& j, T& value) -> decltype(value.FromJson(std::move(j)));
+
+template <typename T>
+auto MoveJson(json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>> {
+  ReadNumber(j, value);
+}
+
+inline void MoveJson(json& j, std::string& value) {
+  if (!j.is_string()) {
+    j.get_to(value);
+    return;
+  }
+  value = std::move(*j.get_ptr<std::string*>());
+}
+
+template <typename T>
+void MoveJson(json& j, std::vector<T>& value) {
+  if (!j.is_array()) {
+    j.get_to(value);
+    return;
+  }
+  value.clear();
+  value.reserve(j.size());
+  for (json& element : j) {
+    MoveJson(element, value.emplace_back());
+  }
+}
+
+inline void MoveJson(json& j, std::vector<bool>& value) {
+  j.get_to(value);
+}
+
+template <typename T>
+void MoveJson(json& j, std::map<std::string, T>& value) {
+  if (!j.is_object()) {
+    j.get_to(value);
+    return;
+  }
+  value.clear();
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    MoveJson(it.value(), value[it.key()]);
+  }
+}
+
+template <typename T>
+auto MoveJson(json& j, T& value) -> decltype(value.FromJson(std::move(j))) {
+  value.FromJson(std::move(j));
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_READERS_
+
+)";
+  // Emitted only with --intern.
+  static const char kReaderInternSupport[] = R"(#ifndef JSON2CLASS_READERS_INTERN_
+#define JSON2CLASS_READERS_INTERN_
+
+namespace json2class {
+
+inline void AssignJson(const json& j, InternedString& value) {
+  j.get_to(value);
+}
+
+// Interned strings are copied into their pool.
+inline void MoveJson(json& j, InternedString& value) {
+  j.get_to(value);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_READERS_INTERN_
+
+)";
+  std::string support = kReaderSupport;
+  if (options_.intern_strings) {
+    support += kReaderInternSupport;
+  }
+  return support;
+}
+
+std::string JsonClassGenerator::GenerateSimdjsonSupport() {
+  static const char kSimdjsonSupport[] = R"(#ifndef JSON2CLASS_SIMDJSON_
+#define JSON2CLASS_SIMDJSON_
+
+namespace json2class {
+
+inline bool SyntaxError(ParseStatus& status) {
+  status.code = StatusCode::kSyntaxError;
+  return false;
+}
+
+// Adds |token| to the path of a rejected value; syntax errors keep no path.
+inline bool Rejected(ParseStatus& status, std::string_view token) {
+  if (status.code != StatusCode::kSyntaxError) {
+    PrependPath(status, token);
+  }
+  return false;
+}
+
+// The parser behind ParseFrom, reused by every call on the same thread so
+// that its buffers are allocated once.
+inline simdjson::ondemand::parser& ThreadParser() {
+  thread_local simdjson::ondemand::parser parser;
+  return parser;
+}
+
+// Readers for simdjson On-Demand values behind FromJson(ondemand::value).
+// They accept exactly the values that json::get accepts for their type,
+// assign in place like AssignJson, and report the first rejected value in
+// |status|.
+template <typename T>
+auto ReadSimdjson(simdjson::ondemand::value value,
+                  T& out,
+                  ParseStatus& status)
+    -> std::enable_if_t<std::is_arithmetic_v<T>, bool>;
+inline bool ReadSimdjson(simdjson::ondemand::value value,
+                         bool& out,
+                         ParseStatus& status);
+template <typename Allocator>
+bool ReadSimdjson(
+    simdjson::ondemand::value value,
+    std::basic_string<char, std::char_traits<char>, Allocator>& out,
+    ParseStatus& status);
+template <typename T, typename Allocator>
+bool ReadSimdjson(simdjson::ondemand::value value,
+                  std::vector<T, Allocator>& out,
+                  ParseStatus& status);
+template <typename K, typename T, typename Compare, typename Allocator>
+bool ReadSimdjson(simdjson::ondemand::value value,
+                  std::map<K, T, Compare, Allocator>& out,
+                  ParseStatus& status);
+template <typename T>
+auto ReadSimdjson(simdjson::ondemand::value value,
+                  T& out,
+                  ParseStatus& status)
+    -> decltype(out.FromJson(value), bool());
+
+template <typename T>
+auto ReadSimdjson(simdjson::ondemand::value value,
+                  T& out,
+                  ParseStatus& status)
+    -> std::enable_if_t<std::is_arithmetic_v<T>, bool> {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type == simdjson::ondemand::json_type::boolean) {
+    bool boolean;
+    if (value.get_bool().get(boolean)) {
+      return SyntaxError(status);
+    }
+    out = static_cast<T>(boolean);
+    return true;
+  }
+  if (type != simdjson::ondemand::json_type::number) {
+    return TypeError(status);
+  }
+  simdjson::ondemand::number_type number_type;
+  if (value.get_number_type().get(number_type)) {
+    return SyntaxError(status);
+  }
+  // The value is only assigned once it has been read without an error and
+  // fits the member
+  if (number_type == simdjson::ondemand::number_type::signed_integer) {
+    std::int64_t number;
+    if (value.get_int64().get(number)) {
+      return SyntaxError(status);
+    }
+    if (!NarrowNumber(number, out)) {
+      return TypeError(status);
+    }
+  } else if (number_type == simdjson::ondemand::number_type::unsigned_integer) {
+    std::uint64_t number;
+    if (value.get_uint64().get(number)) {
+      return SyntaxError(status);
+    }
+    if (!NarrowNumber(number, out)) {
+      return TypeError(status);
+    }
+  } else {
+    // Integers beyond 64 bits are doubles, as in nlohmann/json
+    double number;
+    if (value.get_double().get(number)) {
+      return SyntaxError(status);
+    }
+    if (!NarrowNumber(number, out)) {
+      return TypeError(status);
+    }
+  }
+  return true;
+}
+
+inline bool ReadSimdjson(simdjson::ondemand::value value,
+                         bool& out,
+                         ParseStatus& status) {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type != simdjson::ondemand::json_type::boolean) {
+    return TypeError(status);
+  }
+  return value.get_bool().get(out) ? SyntaxError(status) : true;
+}
+
+template <typename Allocator>
+bool ReadSimdjson(
+    simdjson::ondemand::value value,
+    std::basic_string<char, std::char_traits<char>, Allocator>& out,
+    ParseStatus& status) {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type != simdjson::ondemand::json_type::string) {
+    return TypeError(status);
+  }
+  std::string_view text;
+  if (value.get_string().get(text)) {
+    return SyntaxError(status);
+  }
+  out.assign(text.data(), text.size());
+  return true;
+}
+
+template <typename T, typename Allocator>
+bool ReadSimdjson(simdjson::ondemand::value value,
+                  std::vector<T, Allocator>& out,
+                  ParseStatus& status) {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type != simdjson::ondemand::json_type::array) {
+    return TypeError(status);
+  }
+  simdjson::ondemand::array array;
+  if (value.get_array().get(array)) {
+    return SyntaxError(status);
+  }
+  // Elements left from an earlier parse are reused
+  std::size_t size = 0;
+  if constexpr (std::is_same_v<T, bool>) {
+    out.clear();
+  }
+  for (auto result : array) {
+    simdjson::ondemand::value element;
+    if (result.get(element)) {
+      return SyntaxError(status);
+    }
+    bool read;
+    if constexpr (std::is_same_v<T, bool>) {
+      bool boolean = false;
+      read = ReadSimdjson(element, boolean, status);
+      out.push_back(boolean);
+    } else {
+      if (size == out.size()) {
+        out.emplace_back();
+      } else if constexpr (HasClear<T>::value) {
+        out[size].Clear();
+      }
+      read = ReadSimdjson(element, out[size], status);
+    }
+    if (!read) {
+      return Rejected(status, std::to_string(size));
+    }
+    ++size;
+  }
+  out.erase(out.begin() + size, out.end());
+  return true;
+}
+
+template <typename K, typename T, typename Compare, typename Allocator>
+bool ReadSimdjson(simdjson::ondemand::value value,
+                  std::map<K, T, Compare, Allocator>& out,
+                  ParseStatus& status) {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type != simdjson::ondemand::json_type::object) {
+    return TypeError(status);
+  }
+  simdjson::ondemand::object object;
+  if (value.get_object().get(object)) {
+    return SyntaxError(status);
+  }
+  out.clear();
+  for (auto field : object) {
+    std::string_view key;
+    simdjson::ondemand::value member;
+    if (field.unescaped_key().get(key) || field.value().get(member)) {
+      return SyntaxError(status);
+    }
+    if (!ReadSimdjson(member, out[K(key, out.get_allocator())], status)) {
+      return Rejected(status, key);
+    }
+  }
+  return true;
+}
+
+// Generated classes read their own fields. Values that are not objects
+// leave them unchanged, as FromJson does.
+template <typename T>
+auto ReadSimdjson(simdjson::ondemand::value value,
+                  T& out,
+                  ParseStatus& status)
+    -> decltype(out.FromJson(value), bool()) {
+  ParseStatus nested = out.FromJson(value);
+  if (!nested.ok()) {
+    status = std::move(nested);
+    return false;
+  }
+  return true;
+}
+
+// Reads a member that FromJson skips when |value| is not of |type|.
+template <typename T>
+bool ReadSimdjsonIf(simdjson::ondemand::value value,
+                    simdjson::ondemand::json_type type,
+                    T& out,
+                    ParseStatus& status) {
+  simdjson::ondemand::json_type actual;
+  if (value.type().get(actual)) {
+    return SyntaxError(status);
+  }
+  return actual != type || ReadSimdjson(value, out, status);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SIMDJSON_
+
+)";
+  // Emitted only for classes with enums.
+  static const char kSimdjsonEnumSupport[] = R"(#ifndef JSON2CLASS_SIMDJSON_ENUM_
+#define JSON2CLASS_SIMDJSON_ENUM_
+
+namespace json2class {
+
+template <typename T>
+auto ReadSimdjson(simdjson::ondemand::value value,
+                  T& out,
+                  ParseStatus& status)
+    -> std::enable_if_t<IsTextEnum<T>::value, bool> {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type != simdjson::ondemand::json_type::string) {
+    return TypeError(status);
+  }
+  std::string_view text;
+  if (value.get_string().get(text)) {
+    return SyntaxError(status);
+  }
+  return FromString(text, out) ? true : UnknownValue(status);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SIMDJSON_ENUM_
+
+)";
+  // Emitted only with --intern.
+  static const char kSimdjsonInternSupport[] = R"(#ifndef JSON2CLASS_SIMDJSON_INTERN_
+#define JSON2CLASS_SIMDJSON_INTERN_
+
+namespace json2class {
+
+inline bool ReadSimdjson(simdjson::ondemand::value value,
+                         InternedString& out,
+                         ParseStatus& status) {
+  simdjson::ondemand::json_type type;
+  if (value.type().get(type)) {
+    return SyntaxError(status);
+  }
+  if (type != simdjson::ondemand::json_type::string) {
+    return TypeError(status);
+  }
+  std::string_view text;
+  if (value.get_string().get(text)) {
+    return SyntaxError(status);
+  }
+  out = InternedString(text);
+  return true;
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SIMDJSON_INTERN_
+
+)";
+  std::string support = kSimdjsonSupport;
+  if (!options_.enums.empty()) {
+    support += kSimdjsonEnumSupport;
+  }
+  if (options_.intern_strings) {
+    support += kSimdjsonInternSupport;
+  }
+  return support;
+}
+
+std::string JsonClassGenerator::GenerateSaxSupport() {
+  // Emitted once per header and guarded, so several generated headers can be
+  // included in the same translation unit.
+  static const char kSaxSupport[] = R"(#ifndef JSON2CLASS_SAX_READER_
+#define JSON2CLASS_SAX_READER_
+
+namespace json2class {
+
+struct SaxOps;
+
+// A value that SAX events are written into. An empty slot skips the value.
+struct SaxSlot {
+  void* target = nullptr;
+  const SaxOps* ops = nullptr;
+};
+
+// Applies SAX events to a value of one C++ type. A null callback means the
+// type does not accept that kind of JSON value.
+struct SaxOps {
+  void (*value)(void* target, const json& value);
+  void (*string)(void* target, std::string& value);
+  SaxSlot (*member)(void* target, std::string_view key);
+  // Returns the slot of element |index| of the array. Elements left from an
+  // earlier parse are reused.
+  SaxSlot (*element)(void* target, std::size_t index);
+  // Called when an element of the array is complete. Returning false stops
+  // the parse.
+  bool (*end_element)(void* target);
+  // Called with the number of elements when the array ends, to drop the
+  // elements that were not reused.
+  void (*end_array)(void* target, std::size_t size);
+};
+
+template <typename T, typename = void>
+struct HasClear : std::false_type {};
+
+template <typename T>
+struct HasClear<T, std::void_t<decltype(std::declval<T&>().Clear())>>
+    : std::true_type {};
+
+// Resets a reused array element before it is parsed again. Generated classes
+// and containers keep the memory they already own.
+template <typename T>
+void ClearValue(T& value) {
+  if constexpr (HasClear<T>::value) {
+    value.Clear();
+  } else if constexpr (std::is_class_v<T>) {
+    value.clear();
+  }
+}
+
+// Scalars convert like the DOM based FromJson, so they accept and reject
+// exactly the same values.
+template <typename T, typename = void>
+struct SaxBinding {
+  static void Value(void* target, const json& value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      ReadNumber(value, *static_cast<T*>(target));
+    } else {
+      value.get_to(*static_cast<T*>(target));
+    }
+  }
+  static void String(void* target, std::string& value) {
+    Value(target, json(std::move(value)));
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+template <typename T>
+SaxSlot MakeSaxSlot(T& target) {
+  return {&target, &SaxBinding<T>::kOps};
+}
+
+template <>
+struct SaxBinding<std::string> {
+  static void Value(void* target, const json& value) {
+    value.get_to(*static_cast<std::string*>(target));
+  }
+  static void String(void* target, std::string& value) {
+    // Copied rather than moved, so both the member and the lexer keep their
+    // buffers for the next value
+    static_cast<std::string*>(target)->assign(value);
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+template <typename T>
+struct SaxBinding<std::vector<T>> {
+  static SaxSlot Element(void* target, std::size_t index) {
+    auto& value = *static_cast<std::vector<T>*>(target);
+    if (index < value.size()) {
+      ClearValue(value[index]);
+      return MakeSaxSlot(value[index]);
+    }
+    return MakeSaxSlot(value.emplace_back());
+  }
+  static void EndArray(void* target, std::size_t size) {
+    auto& value = *static_cast<std::vector<T>*>(target);
+    if (size < value.size()) {
+      value.erase(value.begin() + size, value.end());
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr, nullptr,
+                                  &Element, nullptr, &EndArray};
+};
+
+// std::vector<bool> has no addressable elements, so values are appended.
+template <>
+struct SaxBinding<std::vector<bool>> {
+  static void Append(void* target, const json& value) {
+    static_cast<std::vector<bool>*>(target)->push_back(value.get<bool>());
+  }
+  static void AppendString(void* target, std::string& value) {
+    Append(target, json(std::move(value)));
+  }
+  static constexpr SaxOps kElementOps = {&Append, &AppendString, nullptr,
+                                         nullptr, nullptr, nullptr};
+  static SaxSlot Element(void* target, std::size_t index) {
+    if (index == 0) {
+      static_cast<std::vector<bool>*>(target)->clear();
+    }
+    return {target, &kElementOps};
+  }
+  static void EndArray(void* target, std::size_t size) {
+    if (size == 0) {
+      static_cast<std::vector<bool>*>(target)->clear();
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr, nullptr,
+                                  &Element, nullptr, &EndArray};
+};
+
+template <typename T>
+struct SaxBinding<std::map<std::string, T>> {
+  static SaxSlot Member(void* target, std::string_view key) {
+    return MakeSaxSlot(
+        (*static_cast<std::map<std::string, T>*>(target))[std::string(key)]);
+  }
+  static constexpr SaxOps kOps = {nullptr, nullptr, &Member,
+                                  nullptr, nullptr, nullptr};
+};
+
+// Generated classes dispatch keys through their SaxMember function.
+template <typename T>
+struct SaxBinding<T, std::void_t<decltype(&T::SaxMember)>> {
+  static constexpr SaxOps kOps = {nullptr, nullptr, &T::SaxMember,
+                                  nullptr, nullptr, nullptr};
+};
+
+// Hands the elements of an array to a callback one at a time instead of
+// storing them, so only one element is in memory at once. The callback
+// takes a T&& or const T& and may return false to stop the parse.
+template <typename T, typename Callback>
+class SaxStream {
+ public:
+  explicit SaxStream(Callback& callback) : callback_(callback) {}
+
+  SaxSlot slot() { return {this, &kOps}; }
+
+ private:
+  static SaxSlot Element(void* target, std::size_t) {
+    // One element object is reused, so its buffers are allocated only once
+    auto* self = static_cast<SaxStream*>(target);
+    ClearValue(self->element_);
+    return MakeSaxSlot(self->element_);
+  }
+  static bool EndElement(void* target) {
+    auto* self = static_cast<SaxStream*>(target);
+    if constexpr (std::is_same_v<std::invoke_result_t<Callback&, T&&>,
+                                 bool>) {
+      return self->callback_(std::move(self->element_));
+    } else {
+      self->callback_(std::move(self->element_));
+      return true;
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr,     nullptr,
+                                  &Element, &EndElement, nullptr};
+
+  Callback& callback_;
+  T element_;
+};
+
+// SAX handler that writes a JSON document straight into a generated class
+// without building a DOM. Unknown keys and mismatched containers are skipped
+// like FromJson does; scalar type errors throw json::type_error.
+class SaxReader final : public nlohmann::json_sax<json> {
+ public:
+  explicit SaxReader(SaxSlot root) : root_(root) { stack_.reserve(16); }
+
+  // Writes the value of |key| in the root object into |stream| instead of
+  // the member of the root class.
+  SaxReader(SaxSlot root, std::string key, SaxSlot stream)
+      : root_(root), stream_key_(std::move(key)), stream_(stream) {
+    stack_.reserve(16);
+  }
+
+  bool null() override { return Scalar(json()); }
+  bool boolean(bool val) override { return Scalar(json(val)); }
+  bool number_integer(number_integer_t val) override {
+    return Scalar(json(val));
+  }
+  bool number_unsigned(number_unsigned_t val) override {
+    return Scalar(json(val));
+  }
+  bool number_float(number_float_t val, const string_t&) override {
+    return Scalar(json(val));
+  }
+
+  bool string(string_t& val) override {
+    SaxSlot slot = Next();
+    if (slot.ops && slot.ops->string) {
+      slot.ops->string(slot.target, val);
+    }
+    return EndValue();
+  }
+
+  bool binary(binary_t&) override {
+    Next();
+    return EndValue();
+  }
+
+  bool start_object(std::size_t) override {
+    SaxSlot slot = Next();
+    if (slot.ops && !slot.ops->member) {
+      Reject(slot, json::value_t::object);
+      slot = {};
+    }
+    stack_.push_back({slot, false, 0});
+    return true;
+  }
+
+  bool key(string_t& val) override {
+    const SaxSlot& object = stack_.back().slot;
+    if (stream_.ops && stack_.size() == 1 && val == stream_key_) {
+      member_ = stream_;
+      return true;
+    }
+    member_ = object.ops ? object.ops->member(object.target, val) : SaxSlot{};
+    return true;
+  }
+
+  bool end_object() override {
+    stack_.pop_back();
+    return EndValue();
+  }
+
+  bool start_array(std::size_t) override {
+    SaxSlot slot = Next();
+    if (slot.ops && !slot.ops->element) {
+      Reject(slot, json::value_t::array);
+      slot = {};
+    }
+    stack_.push_back({slot, true, 0});
+    return true;
+  }
+
+  bool end_array() override {
+    const Frame& top = stack_.back();
+    if (top.slot.ops && top.slot.ops->end_array) {
+      top.slot.ops->end_array(top.slot.target, top.size);
+    }
+    stack_.pop_back();
+    return EndValue();
+  }
+
+  bool parse_error(std::size_t,
+                   const std::string&,
+                   const nlohmann::detail::exception& ex) override {
+    // Rethrow the concrete type, as json::parse does
+    if (const auto* error = dynamic_cast<const json::parse_error*>(&ex)) {
+      JSON2CLASS_THROW(*error);
+    }
+    if (const auto* error = dynamic_cast<const json::out_of_range*>(&ex)) {
+      JSON2CLASS_THROW(*error);
+    }
+    JSON2CLASS_THROW(ex);
+  }
+
+ private:
+  struct Frame {
+    SaxSlot slot;
+    bool array;
+    std::size_t size;  // Elements started so far.
+  };
+
+  // Returns the slot for the value that starts with the current event.
+  SaxSlot Next() {
+    if (stack_.empty()) {
+      return std::exchange(root_, SaxSlot{});
+    }
+    Frame& top = stack_.back();
+    if (!top.array) {
+      return std::exchange(member_, SaxSlot{});
+    }
+    const std::size_t index = top.size++;
+    return top.slot.ops ? top.slot.ops->element(top.slot.target, index)
+                        : SaxSlot{};
+  }
+
+  bool Scalar(const json& value) {
+    SaxSlot slot = Next();
+    if (slot.ops && slot.ops->value) {
+      slot.ops->value(slot.target, value);
+    }
+    return EndValue();
+  }
+
+  // Reports a completed value to the array that contains it.
+  bool EndValue() {
+    if (stack_.empty() || !stack_.back().array) {
+      return true;
+    }
+    const SaxSlot& array = stack_.back().slot;
+    return !array.ops || !array.ops->end_element ||
+           array.ops->end_element(array.target);
+  }
+
+  // A container where a scalar is expected fails the same way json::get does.
+  static void Reject(const SaxSlot& slot, json::value_t type) {
+    if (slot.ops->value && !slot.ops->member && !slot.ops->element) {
+      slot.ops->value(slot.target, json(type));
+    }
+  }
+
+  SaxSlot root_;
+  SaxSlot member_;
+  std::string stream_key_;
+  SaxSlot stream_;
+  std::vector<Frame> stack_;
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SAX_READER_
+
+)";
+  // Emitted only for classes with enums.
+  static const char kSaxEnumSupport[] = R"(#ifndef JSON2CLASS_SAX_ENUM_
+#define JSON2CLASS_SAX_ENUM_
+
+namespace json2class {
+
+// Enums are looked up in place, without converting the string to a json.
+template <typename T>
+struct SaxBinding<T, std::enable_if_t<IsTextEnum<T>::value>> {
+  static void Value(void* target, const json& value) {
+    ReadEnum(value, *static_cast<T*>(target));
+  }
+  static void String(void* target, std::string& value) {
+    ParseEnum(value, *static_cast<T*>(target));
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SAX_ENUM_
+
+)";
+  // Emitted only with --intern.
+  static const char kSaxInternSupport[] = R"(#ifndef JSON2CLASS_SAX_INTERN_
+#define JSON2CLASS_SAX_INTERN_
+
+namespace json2class {
+
+template <>
+struct SaxBinding<InternedString> {
+  static void Value(void* target, const json& value) {
+    value.get_to(*static_cast<InternedString*>(target));
+  }
+  static void String(void* target, std::string& value) {
+    *static_cast<InternedString*>(target) = InternedString(value);
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SAX_INTERN_
+
+)";
+  std::string support = kSaxSupport;
+  if (!options_.enums.empty()) {
+    support += kSaxEnumSupport;
+  }
+  if (options_.intern_strings) {
+    support += kSaxInternSupport;
+  }
+  return support;
+}
+
+std::string JsonClassGenerator::GenerateBinaryMethods(const json& j,
+                                                      int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "template <typename Writer>\n";
+  ss << Indent(indent_level) << "void WriteBinary(Writer& writer) const {\n";
+  ss << Indent(indent_level + 1) << "writer.MapHeader(" << j.size() << ");\n";
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    ss << Indent(indent_level + 1) << "writer.String("
+       << CppStringLiteral(it.key()) << ");\n";
+    ss << Indent(indent_level + 1) << "json2class::WriteBinary(writer, "
+       << SanitizeIdentifier(it.key()) << "_);\n";
+  }
+  ss << Indent(indent_level) << "}\n\n";
+
+  // Mismatched containers are skipped and scalar type errors throw, like
+  // the SAX reader does
+  ss << Indent(indent_level) << "template <typename Reader>\n";
+  ss << Indent(indent_level)
+     << "void ReadBinary(Reader& reader, json2class::BinaryToken token) {\n";
+  ss << Indent(indent_level + 1)
+     << "if (token.type != json2class::BinaryType::kMap) {\n";
+  ss << Indent(indent_level + 2) << "json2class::SkipBinary(reader, token);\n";
+  ss << Indent(indent_level + 2) << "return;\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level + 1) << "while (reader.Next(token)) {\n";
+  ss << Indent(indent_level + 2) << "switch (FieldIndex(reader.ReadKey())) {\n";
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
+    ss << Indent(indent_level + 3) << "case " << field_index << ":\n";
+    ss << Indent(indent_level + 4)
+       << "json2class::ReadBinary(reader, reader.Read(), "
+       << SanitizeIdentifier(it.key()) << "_);\n";
+    ss << Indent(indent_level + 4) << "break;\n";
+  }
+  ss << Indent(indent_level + 3) << "default:\n";
+  ss << Indent(indent_level + 4)
+     << "json2class::SkipBinary(reader, reader.Read());\n";
+  ss << Indent(indent_level + 4) << "break;\n";
+  ss << Indent(indent_level + 2) << "}\n";
+  ss << Indent(indent_level + 1) << "}\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  for (const char* format : {"MsgPack", "Cbor"}) {
+    ss << Indent(indent_level) << "void To" << format
+       << "(std::vector<std::uint8_t>& out) const {\n";
+    ss << Indent(indent_level + 1) << "out.clear();\n";
+    ss << Indent(indent_level + 1) << "json2class::" << format
+       << "Writer writer(out);\n";
+    ss << Indent(indent_level + 1) << "WriteBinary(writer);\n";
+    ss << Indent(indent_level) << "}\n\n";
+
+    ss << Indent(indent_level) << "void From" << format
+       << "(const std::uint8_t* data, std::size_t size) {\n";
+    ss << Indent(indent_level + 1) << "json2class::" << format
+       << "Reader reader(data, size);\n";
+    ss << Indent(indent_level + 1) << "ReadBinary(reader, reader.Read());\n";
+    ss << Indent(indent_level + 1) << "reader.Finish();\n";
+    ss << Indent(indent_level) << "}\n\n";
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateBinarySupport() {
+  static const char kBinarySupport[] = R"(#ifndef JSON2CLASS_BINARY_
+#define JSON2CLASS_BINARY_
+
+namespace json2class {
+
+template <typename T>
+void AppendBigEndian(std::vector<std::uint8_t>& out, T value) {
+  std::uint8_t bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  if constexpr (sizeof(T) > 1) {
+    const std::uint16_t probe = 1;
+    if (*reinterpret_cast<const std::uint8_t*>(&probe) == 1) {
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+  }
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Writes MessagePack in the same encoding as json::to_msgpack: every
+// number, string and container header uses its smallest form.
+class MsgPackWriter {
+ public:
+  explicit MsgPackWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+  void Null() { out_.push_back(0xc0); }
+  void Boolean(bool value) { out_.push_back(value ? 0xc3 : 0xc2); }
+  void Integer(std::int64_t value) {
+    if (value >= 0) {
+      Unsigned(static_cast<std::uint64_t>(value));
+    } else if (value >= -32) {
+      out_.push_back(static_cast<std::uint8_t>(value));
+    } else if (value >= INT8_MIN) {
+      out_.push_back(0xd0);
+      AppendBigEndian(out_, static_cast<std::int8_t>(value));
+    } else if (value >= INT16_MIN) {
+      out_.push_back(0xd1);
+      AppendBigEndian(out_, static_cast<std::int16_t>(value));
+    } else if (value >= INT32_MIN) {
+      out_.push_back(0xd2);
+      AppendBigEndian(out_, static_cast<std::int32_t>(value));
+    } else {
+      out_.push_back(0xd3);
+      AppendBigEndian(out_, value);
+    }
+  }
+  void Unsigned(std::uint64_t value) {
+    if (value < 128) {
+      out_.push_back(static_cast<std::uint8_t>(value));
+    } else if (value <= UINT8_MAX) {
+      out_.push_back(0xcc);
+      out_.push_back(static_cast<std::uint8_t>(value));
+    } else if (value <= UINT16_MAX) {
+      out_.push_back(0xcd);
+      AppendBigEndian(out_, static_cast<std::uint16_t>(value));
+    } else if (value <= UINT32_MAX) {
+      out_.push_back(0xce);
+      AppendBigEndian(out_, static_cast<std::uint32_t>(value));
+    } else {
+      out_.push_back(0xcf);
+      AppendBigEndian(out_, value);
+    }
+  }
+  void Float(double value) {
+    if (value >= std::numeric_limits<float>::lowest() &&
+        value <= (std::numeric_limits<float>::max)() &&
+        static_cast<double>(static_cast<float>(value)) == value) {
+      out_.push_back(0xca);
+      AppendBigEndian(out_, static_cast<float>(value));
+    } else {
+      out_.push_back(0xcb);
+      AppendBigEndian(out_, value);
+    }
+  }
+  void String(std::string_view value) {
+    Header(value.size(), 0xa0, 31, 0xd9);
+    out_.insert(out_.end(), value.begin(), value.end());
+  }
+  template <std::size_t N>
+  void String(const char (&text)[N]) {
+    String(std::string_view(text, N - 1));
+  }
+  void ArrayHeader(std::size_t size) { Header(size, 0x90, 15, 0); }
+  void MapHeader(std::size_t size) { Header(size, 0x80, 15, 0); }
+
+ private:
+  // |fix| is the prefix of the short form that holds sizes up to |fix_max|;
+  // longer values use the 8, 16 or 32 bit forms that follow |first|, or the
+  // 16 and 32 bit forms after the short one when |first| is 0.
+  void Header(std::size_t size,
+              std::uint8_t fix,
+              std::size_t fix_max,
+              std::uint8_t first) {
+    if (size <= fix_max) {
+      out_.push_back(static_cast<std::uint8_t>(fix | size));
+    } else if (first != 0 && size <= UINT8_MAX) {
+      out_.push_back(first);
+      out_.push_back(static_cast<std::uint8_t>(size));
+    } else if (size <= UINT16_MAX) {
+      out_.push_back(first != 0 ? first + 1 : (fix == 0x90 ? 0xdc : 0xde));
+      AppendBigEndian(out_, static_cast<std::uint16_t>(size));
+    } else {
+      out_.push_back(first != 0 ? first + 2 : (fix == 0x90 ? 0xdd : 0xdf));
+      AppendBigEndian(out_, static_cast<std::uint32_t>(size));
+    }
+  }
+
+  std::vector<std::uint8_t>& out_;
+};
+
+// Writes CBOR in the same encoding as json::to_cbor.
+class CborWriter {
+ public:
+  explicit CborWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+  void Null() { out_.push_back(0xf6); }
+  void Boolean(bool value) { out_.push_back(value ? 0xf5 : 0xf4); }
+  void Integer(std::int64_t value) {
+    if (value >= 0) {
+      Head(0x00, static_cast<std::uint64_t>(value));
+    } else {
+      Head(0x20, static_cast<std::uint64_t>(-1 - value));
+    }
+  }
+  void Unsigned(std::uint64_t value) { Head(0x00, value); }
+  void Float(double value) {
+    if (std::isnan(value)) {
+      out_.insert(out_.end(), {0xf9, 0x7e, 0x00});
+    } else if (std::isinf(value)) {
+      out_.insert(out_.end(), {0xf9, value > 0 ? std::uint8_t{0x7c}
+                                               : std::uint8_t{0xfc},
+                               0x00});
+    } else if (value >= std::numeric_limits<float>::lowest() &&
+               value <= (std::numeric_limits<float>::max)() &&
+               static_cast<double>(static_cast<float>(value)) == value) {
+      out_.push_back(0xfa);
+      AppendBigEndian(out_, static_cast<float>(value));
+    } else {
+      out_.push_back(0xfb);
+      AppendBigEndian(out_, value);
+    }
+  }
+  void String(std::string_view value) {
+    Head(0x60, value.size());
+    out_.insert(out_.end(), value.begin(), value.end());
+  }
+  template <std::size_t N>
+  void String(const char (&text)[N]) {
+    String(std::string_view(text, N - 1));
+  }
+  void ArrayHeader(std::size_t size) { Head(0x80, size); }
+  void MapHeader(std::size_t size) { Head(0xa0, size); }
+
+ private:
+  // Writes a major type and its argument in the smallest form.
+  void Head(std::uint8_t major, std::uint64_t value) {
+    if (value <= 0x17) {
+      out_.push_back(static_cast<std::uint8_t>(major | value));
+    } else if (value <= UINT8_MAX) {
+      out_.push_back(major | 0x18);
+      out_.push_back(static_cast<std::uint8_t>(value));
+    } else if (value <= UINT16_MAX) {
+      out_.push_back(major | 0x19);
+      AppendBigEndian(out_, static_cast<std::uint16_t>(value));
+    } else if (value <= UINT32_MAX) {
+      out_.push_back(major | 0x1a);
+      AppendBigEndian(out_, static_cast<std::uint32_t>(value));
+    } else {
+      out_.push_back(major | 0x1b);
+      AppendBigEndian(out_, value);
+    }
+  }
+
+  std::vector<std::uint8_t>& out_;
+};
+
+template <typename Writer, typename T>
+std::enable_if_t<std::is_arithmetic_v<T>> WriteBinary(Writer& writer,
+                                                      T value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    writer.Boolean(value);
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    writer.Integer(value);
+  } else if constexpr (std::is_integral_v<T>) {
+    writer.Unsigned(value);
+  } else {
+    writer.Float(value);
+  }
+}
+
+template <typename Writer, typename Traits, typename Allocator>
+void WriteBinary(Writer& writer,
+                 const std::basic_string<char, Traits, Allocator>& value) {
+  writer.String(std::string_view(value.data(), value.size()));
+}
+
+template <typename Writer, typename T>
+auto WriteBinary(Writer& writer, const T& value)
+    -> decltype(value.WriteBinary(writer)) {
+  value.WriteBinary(writer);
+}
+
+template <typename Writer, typename T, typename Allocator>
+void WriteBinary(Writer& writer, const std::vector<T, Allocator>& value) {
+  writer.ArrayHeader(value.size());
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    WriteBinary(writer, static_cast<const T&>(value[i]));
+  }
+}
+
+template <typename Writer,
+          typename Key,
+          typename T,
+          typename Compare,
+          typename Allocator>
+void WriteBinary(Writer& writer,
+                 const std::map<Key, T, Compare, Allocator>& value) {
+  writer.MapHeader(value.size());
+  for (const auto& item : value) {
+    writer.String(std::string_view(item.first.data(), item.first.size()));
+    WriteBinary(writer, item.second);
+  }
+}
+
+enum class BinaryType {
+  kNull,
+  kBoolean,
+  kInteger,
+  kUnsigned,
+  kFloat,
+  kString,
+  kBinary,
+  kArray,
+  kMap,
+};
+
+// The header of one encoded value. Strings and byte strings point into the
+// input; arrays and maps carry their element count, which Next counts down.
+struct BinaryToken {
+  static constexpr std::size_t kIndefinite = SIZE_MAX;
+
+  BinaryType type = BinaryType::kNull;
+  bool boolean = false;
+  std::int64_t integer = 0;
+  std::uint64_t unsigned_integer = 0;
+  double number = 0;
+  std::string_view text;
+  std::size_t size = 0;
+};
+
+// Input handling shared by the MessagePack and CBOR readers. Malformed or
+// truncated input throws json::parse_error with the messages of
+// json::from_msgpack and json::from_cbor.
+class BinaryReader {
+ public:
+  BinaryReader(const std::uint8_t* data, std::size_t size, const char* format)
+      : data_(data), size_(size), format_(format) {}
+
+  std::size_t remaining() const { return size_ - pos_; }
+
+  void Finish() const {
+    if (pos_ != size_) {
+      char last[8];
+      std::snprintf(last, sizeof(last), "0x%02X", data_[pos_]);
+      Fail(110, std::string("expected end of input; last byte: ") + last);
+    }
+  }
+
+ protected:
+  std::uint8_t Byte() {
+    if (pos_ == size_) {
+      Fail(110, "unexpected end of input");
+    }
+    return data_[pos_++];
+  }
+
+  std::uint8_t Peek() {
+    if (pos_ == size_) {
+      Fail(110, "unexpected end of input");
+    }
+    return data_[pos_];
+  }
+
+  std::string_view Bytes(std::uint64_t size) {
+    if (size > remaining()) {
+      pos_ = size_;
+      Fail(110, "unexpected end of input");
+    }
+    const char* begin = reinterpret_cast<const char*>(data_ + pos_);
+    pos_ += static_cast<std::size_t>(size);
+    return std::string_view(begin, static_cast<std::size_t>(size));
+  }
+
+  template <typename T>
+  T BigEndian() {
+    const std::string_view bytes = Bytes(sizeof(T));
+    std::uint8_t value[sizeof(T)];
+    std::memcpy(value, bytes.data(), sizeof(T));
+    const std::uint16_t probe = 1;
+    if (*reinterpret_cast<const std::uint8_t*>(&probe) == 1) {
+      std::reverse(value, value + sizeof(T));
+    }
+    T result;
+    std::memcpy(&result, value, sizeof(T));
+    return result;
+  }
+
+  [[noreturn]] void Fail(int id, const std::string& message) const {
+    JSON2CLASS_THROW(json::parse_error::create(
+        id, pos_,
+        std::string("syntax error while parsing ") + format_ +
+            " value: " + message,
+        nullptr));
+  }
+
+  [[noreturn]] void FailByte(std::uint8_t byte) const {
+    char text[8];
+    std::snprintf(text, sizeof(text), "0x%02X", byte);
+    Fail(112, std::string("invalid byte: ") + text);
+  }
+
+ private:
+  const std::uint8_t* data_;
+  std::size_t size_;
+  std::size_t pos_ = 0;
+  const char* format_;
+};
+
+class MsgPackReader : public BinaryReader {
+ public:
+  MsgPackReader(const std::uint8_t* data, std::size_t size)
+      : BinaryReader(data, size, "MessagePack") {}
+
+  BinaryToken Read() {
+    BinaryToken token;
+    const std::uint8_t byte = Byte();
+    if (byte <= 0x7f) {
+      token.type = BinaryType::kUnsigned;
+      token.unsigned_integer = byte;
+    } else if (byte <= 0x8f) {
+      token.type = BinaryType::kMap;
+      token.size = byte & 0x0f;
+    } else if (byte <= 0x9f) {
+      token.type = BinaryType::kArray;
+      token.size = byte & 0x0f;
+    } else if (byte <= 0xbf) {
+      token.type = BinaryType::kString;
+      token.text = Bytes(byte & 0x1f);
+    } else if (byte >= 0xe0) {
+      token.type = BinaryType::kInteger;
+      token.integer = static_cast<std::int8_t>(byte);
+    } else {
+      switch (byte) {
+        case 0xc0:
+          break;
+        case 0xc2:
+        case 0xc3:
+          token.type = BinaryType::kBoolean;
+          token.boolean = byte == 0xc3;
+          break;
+        case 0xc4:
+          token.type = BinaryType::kBinary;
+          token.text = Bytes(BigEndian<std::uint8_t>());
+          break;
+        case 0xc5:
+          token.type = BinaryType::kBinary;
+          token.text = Bytes(BigEndian<std::uint16_t>());
+          break;
+        case 0xc6:
+          token.type = BinaryType::kBinary;
+          token.text = Bytes(BigEndian<std::uint32_t>());
+          break;
+        case 0xc7:
+        case 0xc8:
+        case 0xc9: {
+          const std::uint32_t size =
+              byte == 0xc7   ? BigEndian<std::uint8_t>()
+              : byte == 0xc8 ? BigEndian<std::uint16_t>()
+                             : BigEndian<std::uint32_t>();
+          Byte();  // Extension type
+          token.type = BinaryType::kBinary;
+          token.text = Bytes(size);
+          break;
+        }
+        case 0xca:
+          token.type = BinaryType::kFloat;
+          token.number = BigEndian<float>();
+          break;
+        case 0xcb:
+          token.type = BinaryType::kFloat;
+          token.number = BigEndian<double>();
+          break;
+        case 0xcc:
+          token.type = BinaryType::kUnsigned;
+          token.unsigned_integer = BigEndian<std::uint8_t>();
+          break;
+        case 0xcd:
+          token.type = BinaryType::kUnsigned;
+          token.unsigned_integer = BigEndian<std::uint16_t>();
+          break;
+        case 0xce:
+          token.type = BinaryType::kUnsigned;
+          token.unsigned_integer = BigEndian<std::uint32_t>();
+          break;
+        case 0xcf:
+          token.type = BinaryType::kUnsigned;
+          token.unsigned_integer = BigEndian<std::uint64_t>();
+          break;
+        case 0xd0:
+          token.type = BinaryType::kInteger;
+          token.integer = BigEndian<std::int8_t>();
+          break;
+        case 0xd1:
+          token.type = BinaryType::kInteger;
+          token.integer = BigEndian<std::int16_t>();
+          break;
+        case 0xd2:
+          token.type = BinaryType::kInteger;
+          token.integer = BigEndian<std::int32_t>();
+          break;
+        case 0xd3:
+          token.type = BinaryType::kInteger;
+          token.integer = BigEndian<std::int64_t>();
+          break;
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+        case 0xd7:
+        case 0xd8:
+          Byte();  // Extension type
+          token.type = BinaryType::kBinary;
+          token.text = Bytes(std::size_t{1} << (byte - 0xd4));
+          break;
+        case 0xd9:
+          token.type = BinaryType::kString;
+          token.text = Bytes(BigEndian<std::uint8_t>());
+          break;
+        case 0xda:
+          token.type = BinaryType::kString;
+          token.text = Bytes(BigEndian<std::uint16_t>());
+          break;
+        case 0xdb:
+          token.type = BinaryType::kString;
+          token.text = Bytes(BigEndian<std::uint32_t>());
+          break;
+        case 0xdc:
+          token.type = BinaryType::kArray;
+          token.size = BigEndian<std::uint16_t>();
+          break;
+        case 0xdd:
+          token.type = BinaryType::kArray;
+          token.size = BigEndian<std::uint32_t>();
+          break;
+        case 0xde:
+          token.type = BinaryType::kMap;
+          token.size = BigEndian<std::uint16_t>();
+          break;
+        case 0xdf:
+          token.type = BinaryType::kMap;
+          token.size = BigEndian<std::uint32_t>();
+          break;
+        default:
+          FailByte(byte);
+      }
+    }
+    return token;
+  }
+
+  // Returns whether another element, or key and value pair, of |container|
+  // follows.
+  bool Next(BinaryToken& container) {
+    if (container.size == 0) {
+      return false;
+    }
+    --container.size;
+    return true;
+  }
+
+  std::string_view ReadKey() {
+    const BinaryToken key = Read();
+    if (key.type != BinaryType::kString) {
+      Fail(113, "expected a string key");
+    }
+    return key.text;
+  }
+};
+
+class CborReader : public BinaryReader {
+ public:
+  CborReader(const std::uint8_t* data, std::size_t size)
+      : BinaryReader(data, size, "CBOR") {}
+
+  BinaryToken Read() {
+    BinaryToken token;
+    std::uint8_t byte = Byte();
+    // Tags are ignored
+    while ((byte >> 5) == 6) {
+      Argument(byte & 0x1f);
+      byte = Byte();
+    }
+    const std::uint8_t info = byte & 0x1f;
+    switch (byte >> 5) {
+      case 0:
+        token.type = BinaryType::kUnsigned;
+        token.unsigned_integer = Argument(info);
+        break;
+      case 1:
+        token.type = BinaryType::kInteger;
+        token.integer =
+            std::int64_t{-1} - static_cast<std::int64_t>(Argument(info));
+        break;
+      case 2:
+      case 3:
+        token.type = byte >> 5 == 2 ? BinaryType::kBinary : BinaryType::kString;
+        token.text = StringBody(byte >> 5, info);
+        break;
+      case 4:
+      case 5:
+        token.type = byte >> 5 == 4 ? BinaryType::kArray : BinaryType::kMap;
+        token.size =
+            info == 31 ? BinaryToken::kIndefinite
+                       : static_cast<std::size_t>(Argument(info));
+        break;
+      default:
+        switch (info) {
+          case 20:
+          case 21:
+            token.type = BinaryType::kBoolean;
+            token.boolean = info == 21;
+            break;
+          case 22:
+            break;
+          case 25: {
+            const std::uint16_t half = BigEndian<std::uint16_t>();
+            const int exponent = (half >> 10) & 0x1f;
+            const int mantissa = half & 0x3ff;
+            double value;
+            if (exponent == 0) {
+              value = std::ldexp(mantissa, -24);
+            } else if (exponent == 31) {
+              value = mantissa == 0 ? std::numeric_limits<double>::infinity()
+                                    : std::numeric_limits<double>::quiet_NaN();
+            } else {
+              value = std::ldexp(mantissa + 1024, exponent - 25);
+            }
+            token.type = BinaryType::kFloat;
+            token.number = (half & 0x8000) != 0 ? -value : value;
+            break;
+          }
+          case 26:
+            token.type = BinaryType::kFloat;
+            token.number = BigEndian<float>();
+            break;
+          case 27:
+            token.type = BinaryType::kFloat;
+            token.number = BigEndian<double>();
+            break;
+          default:
+            FailByte(byte);
+        }
+    }
+    return token;
+  }
+
+  // Returns whether another element, or key and value pair, of |container|
+  // follows.
+  bool Next(BinaryToken& container) {
+    if (container.size == BinaryToken::kIndefinite) {
+      if (Peek() == 0xff) {
+        Byte();
+        return false;
+      }
+      return true;
+    }
+    if (container.size == 0) {
+      return false;
+    }
+    --container.size;
+    return true;
+  }
+
+  std::string_view ReadKey() {
+    const BinaryToken key = Read();
+    if (key.type != BinaryType::kString) {
+      Fail(113, "expected a string key");
+    }
+    return key.text;
+  }
+
+ private:
+  std::uint64_t Argument(std::uint8_t info) {
+    switch (info) {
+      case 24:
+        return BigEndian<std::uint8_t>();
+      case 25:
+        return BigEndian<std::uint16_t>();
+      case 26:
+        return BigEndian<std::uint32_t>();
+      case 27:
+        return BigEndian<std::uint64_t>();
+      default:
+        if (info > 27) {
+          FailByte(static_cast<std::uint8_t>(info));
+        }
+        return info;
+    }
+  }
+
+  // Definite strings point into the input. The chunks of an indefinite
+  // string are joined in a buffer that the next indefinite string reuses.
+  std::string_view StringBody(int major, std::uint8_t info) {
+    if (info != 31) {
+      return Bytes(Argument(info));
+    }
+    chunks_.clear();
+    for (std::uint8_t byte = Byte(); byte != 0xff; byte = Byte()) {
+      if ((byte >> 5) != major || (byte & 0x1f) == 31) {
+        FailByte(byte);
+      }
+      const std::string_view chunk = Bytes(Argument(byte & 0x1f));
+      chunks_.append(chunk.data(), chunk.size());
+    }
+    return chunks_;
+  }
+
+  std::string chunks_;
+};
+
+template <typename Reader>
+void SkipBinary(Reader& reader, BinaryToken token) {
+  if (token.type == BinaryType::kArray) {
+    while (reader.Next(token)) {
+      SkipBinary(reader, reader.Read());
+    }
+  } else if (token.type == BinaryType::kMap) {
+    while (reader.Next(token)) {
+      reader.ReadKey();
+      SkipBinary(reader, reader.Read());
+    }
+  }
+}
+
+// The json value of a scalar token, used to convert and reject values
+// exactly like json::get does.
+inline json BinaryScalar(const BinaryToken& token) {
+  switch (token.type) {
+    case BinaryType::kBoolean:
+      return token.boolean;
+    case BinaryType::kInteger:
+      return token.integer;
+    case BinaryType::kUnsigned:
+      return token.unsigned_integer;
+    case BinaryType::kFloat:
+      return token.number;
+    case BinaryType::kString:
+      return std::string(token.text);
+    case BinaryType::kBinary:
+      return json::binary(std::vector<std::uint8_t>(token.text.begin(),
+                                                    token.text.end()));
+    case BinaryType::kArray:
+      return json::array();
+    case BinaryType::kMap:
+      return json::object();
+    default:
+      return nullptr;
+  }
+}
+
+template <typename Reader, typename T>
+std::enable_if_t<std::is_arithmetic_v<T>> ReadBinary(Reader& reader,
+                                                     const BinaryToken& token,
+                                                     T& value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    if (token.type == BinaryType::kBoolean) {
+      value = token.boolean;
+      return;
+    }
+  } else {
+    switch (token.type) {
+      case BinaryType::kBoolean:
+        value = static_cast<T>(token.boolean);
+        return;
+      case BinaryType::kInteger:
+        if (NarrowNumber(token.integer, value)) {
+          return;
+        }
+        break;
+      case BinaryType::kUnsigned:
+        if (NarrowNumber(token.unsigned_integer, value)) {
+          return;
+        }
+        break;
+      case BinaryType::kFloat:
+        if (NarrowNumber(token.number, value)) {
+          return;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  // Numbers that do not fit throw like FromJson
+  SkipBinary(reader, token);
+  ReadNumber(BinaryScalar(token), value);
+}
+
+template <typename Reader, typename Traits, typename Allocator>
+void ReadBinary(Reader& reader,
+                const BinaryToken& token,
+                std::basic_string<char, Traits, Allocator>& value) {
+  if (token.type == BinaryType::kString) {
+    value.assign(token.text.data(), token.text.size());
+    return;
+  }
+  SkipBinary(reader, token);
+  value = BinaryScalar(token).template get<std::string>();
+}
+
+template <typename Reader, typename T>
+auto ReadBinary(Reader& reader, const BinaryToken& token, T& value)
+    -> decltype(value.ReadBinary(reader, token)) {
+  value.ReadBinary(reader, token);
+}
+
+template <typename Reader, typename T, typename Allocator>
+void ReadBinary(Reader& reader,
+                BinaryToken token,
+                std::vector<T, Allocator>& value) {
+  if (token.type != BinaryType::kArray) {
+    SkipBinary(reader, token);
+    return;
+  }
+  value.clear();
+  value.reserve(std::min(token.size, reader.remaining()));
+  while (reader.Next(token)) {
+    if constexpr (std::is_same_v<T, bool>) {
+      bool element = false;
+      ReadBinary(reader, reader.Read(), element);
+      value.push_back(element);
+    } else {
+      ReadBinary(reader, reader.Read(), value.emplace_back());
+    }
+  }
+}
+
+template <typename Reader,
+          typename Key,
+          typename T,
+          typename Compare,
+          typename Allocator>
+void ReadBinary(Reader& reader,
+                BinaryToken token,
+                std::map<Key, T, Compare, Allocator>& value) {
+  if (token.type != BinaryType::kMap) {
+    SkipBinary(reader, token);
+    return;
+  }
+  value.clear();
+  while (reader.Next(token)) {
+    T& item = value[Key(reader.ReadKey(), value.get_allocator())];
+    ReadBinary(reader, reader.Read(), item);
+  }
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_BINARY_
+
+)";
+  // Emitted only for classes with enums.
+  static const char kBinaryEnumSupport[] = R"(#ifndef JSON2CLASS_BINARY_ENUM_
+#define JSON2CLASS_BINARY_ENUM_
+
+namespace json2class {
+
+// Enums are encoded as their strings.
+template <typename Writer, typename T>
+auto WriteBinary(Writer& writer, const T& value)
+    -> std::enable_if_t<IsTextEnum<T>::value> {
+  writer.String(ToString(value));
+}
+
+template <typename Reader, typename T>
+auto ReadBinary(Reader& reader, const BinaryToken& token, T& value)
+    -> std::enable_if_t<IsTextEnum<T>::value> {
+  if (token.type == BinaryType::kString) {
+    ParseEnum(token.text, value);
+    return;
+  }
+  SkipBinary(reader, token);
+  ReadEnum(BinaryScalar(token), value);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_BINARY_ENUM_
+
+)";
+  // Emitted only with --intern.
+  static const char kBinaryInternSupport[] = R"(#ifndef JSON2CLASS_BINARY_INTERN_
+#define JSON2CLASS_BINARY_INTERN_
+
+namespace json2class {
+
+template <typename Writer>
+void WriteBinary(Writer& writer, const InternedString& value) {
+  writer.String(value.view());
+}
+
+template <typename Reader>
+void ReadBinary(Reader& reader,
+                const BinaryToken& token,
+                InternedString& value) {
+  if (token.type == BinaryType::kString) {
+    value = InternedString(token.text);
+    return;
+  }
+  SkipBinary(reader, token);
+  BinaryScalar(token).get_to(value);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_BINARY_INTERN_
+
+)";
+  std::string support = kBinarySupport;
+  if (!options_.enums.empty()) {
+    support += kBinaryEnumSupport;
+  }
+  if (options_.intern_strings) {
+    support += kBinaryInternSupport;
+  }
+  return support;
+}
+
+std::string JsonClassGenerator::GenerateNdjsonMethod(
+    const std::string& class_name,
+    int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "static json2class::NdjsonBatch<" << class_name
+     << "> ParseNdjson(std::string_view buffer, unsigned threads) {\n";
+  if (options_.intern_strings) {
+    // The workers intern into the pool of the calling thread, if it has one
+    ss << Indent(indent_level + 1) << "if (json2class::InternPool* pool = "
+       << "json2class::CurrentInternPool()) {\n";
+    ss << Indent(indent_level + 2)
+       << "return ParseNdjson(buffer, threads, *pool);\n";
+    ss << Indent(indent_level + 1) << "}\n";
+  }
+  ss << Indent(indent_level + 1) << "return json2class::ParseNdjson<"
+     << class_name << ">(\n";
+  ss << Indent(indent_level + 3) << "buffer, threads, &json2class::"
+     << (options_.lazy_parsing ? "IndexNdjsonChunk<" : "ParseNdjsonChunk<")
+     << class_name << ">);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateNdjsonSupport() {
+  static const char kNdjsonSupport[] = R"(#ifndef JSON2CLASS_NDJSON_
+#define JSON2CLASS_NDJSON_
+
+namespace json2class {
+
+// A line of an NDJSON batch that could not be parsed, numbered from 1.
+struct NdjsonError {
+  std::size_t line;
+  std::string message;
+};
+
+// The records of an NDJSON batch in input order, and the lines that failed.
+template <typename T>
+struct NdjsonBatch {
+  std::vector<T> records;
+  std::vector<NdjsonError> errors;
+};
+
+// Parses every non-blank line of |text| into a new record with
+// |parse|(line, record). A line that throws json::exception, or that holds a
+// JSON value other than an object, is reported in |batch|.errors with its
+// number relative to |text|. Returns the number of lines.
+template <typename T, typename Parse>
+std::size_t ParseNdjsonLines(std::string_view text,
+                             NdjsonBatch<T>& batch,
+                             Parse parse) {
+  std::size_t lines = 0;
+  while (!text.empty()) {
+    const std::size_t end = std::min(text.find('\n'), text.size());
+    const std::string_view line = text.substr(0, end);
+    text.remove_prefix(std::min(end + 1, text.size()));
+    ++lines;
+    const std::size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) {
+      continue;
+    }
+    T& record = batch.records.emplace_back();
+#if JSON2CLASS_EXCEPTIONS
+    try {
+      // The readers ignore other values, which would give default records
+      if (line[start] != '{') {
+        ThrowTypeError("json2class: NDJSON record must be an object, but is " +
+                       std::string(json::parse(line).type_name()));
+      }
+      parse(line, record);
+    } catch (const json::exception& e) {
+      batch.records.pop_back();
+      batch.errors.push_back({lines, e.what()});
+    }
+#else
+    if (line[start] != '{') {
+      ThrowTypeError("json2class: NDJSON record must be an object");
+    }
+    parse(line, record);
+#endif
+  }
+  return lines;
+}
+
+// Chunk parser for ParseNdjson that fills each record from its own line.
+template <typename T>
+std::size_t ParseNdjsonChunk(std::string_view chunk, NdjsonBatch<T>& batch) {
+  return ParseNdjsonLines(chunk, batch, [](std::string_view line, T& record) {
+    record.FromJsonString(line);
+  });
+}
+
+// Splits |buffer| into chunks that end at line breaks and parses them with
+// |parse_chunk| on up to |threads| threads, the calling thread included;
+// 0 uses one thread per core. There are several chunks per thread and idle
+// threads take the next unclaimed one, so a slow chunk does not hold the
+// others back. |parse_chunk|(chunk, batch) returns the number of lines of the
+// chunk. Exceptions other than json::exception are rethrown.
+template <typename T, typename ParseChunk>
+NdjsonBatch<T> ParseNdjson(std::string_view buffer,
+                           unsigned threads,
+                           ParseChunk parse_chunk) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const std::size_t chunk_size = std::clamp<std::size_t>(
+      buffer.size() / (std::size_t{threads} * 8), 1 << 16, 1 << 26);
+  std::vector<std::string_view> chunks;
+  while (!buffer.empty()) {
+    std::size_t end = buffer.size() <= chunk_size
+                          ? std::string_view::npos
+                          : buffer.find('\n', chunk_size);
+    end = end == std::string_view::npos ? buffer.size() : end + 1;
+    chunks.push_back(buffer.substr(0, end));
+    buffer.remove_prefix(end);
+  }
+
+  struct ChunkResult {
+    NdjsonBatch<T> batch;
+    std::size_t lines = 0;
+    std::exception_ptr exception;
+  };
+  std::vector<ChunkResult> results(chunks.size());
+  std::atomic<std::size_t> next_chunk{0};
+  auto work = [&] {
+    for (std::size_t i = next_chunk.fetch_add(1, std::memory_order_relaxed);
+         i < chunks.size();
+         i = next_chunk.fetch_add(1, std::memory_order_relaxed)) {
+#if JSON2CLASS_EXCEPTIONS
+      try {
+        results[i].lines = parse_chunk(chunks[i], results[i].batch);
+      } catch (...) {
+        results[i].exception = std::current_exception();
+      }
+#else
+      results[i].lines = parse_chunk(chunks[i], results[i].batch);
+#endif
+    }
+  };
+  const std::size_t thread_count =
+      std::min<std::size_t>(threads, chunks.size());
+  std::vector<std::thread> workers;
+  workers.reserve(thread_count);
+#if JSON2CLASS_EXCEPTIONS
+  try {
+    while (workers.size() + 1 < thread_count) {
+      workers.emplace_back(work);
+    }
+  } catch (const std::system_error&) {
+    // Continue with the threads that could be started.
+  }
+#else
+  while (workers.size() + 1 < thread_count) {
+    workers.emplace_back(work);
+  }
+#endif
+  work();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  NdjsonBatch<T> batch;
+  std::size_t record_count = 0;
+  for (const ChunkResult& result : results) {
+    record_count += result.batch.records.size();
+  }
+  batch.records.reserve(record_count);
+  std::size_t first_line = 0;
+  for (ChunkResult& result : results) {
+    if (result.exception) {
+      std::rethrow_exception(result.exception);
+    }
+    batch.records.insert(batch.records.end(),
+                         std::make_move_iterator(result.batch.records.begin()),
+                         std::make_move_iterator(result.batch.records.end()));
+    for (NdjsonError& error : result.batch.errors) {
+      error.line += first_line;
+      batch.errors.push_back(std::move(error));
+    }
+    first_line += result.lines;
+  }
+  return batch;
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_NDJSON_
+
+)";
+  return kNdjsonSupport;
+}
+
+std::string JsonClassGenerator::GenerateFileMethods(
+    const std::string& class_name,
+    int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "void FromFile(const std::string& path) {\n";
+  ss << Indent(indent_level + 1) << "json2class::MappedFile file;\n";
+  ss << Indent(indent_level + 1) << "json2class::MapFile(file, path);\n";
+  ss << Indent(indent_level + 1) << "FromJsonString(file.data());\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  if (options_.ndjson) {
+    ss << Indent(indent_level) << "static json2class::NdjsonBatch<"
+       << class_name << "> ParseNdjsonFile(\n";
+    ss << Indent(indent_level + 2)
+       << "const std::string& path, unsigned threads) {\n";
+    ss << Indent(indent_level + 1) << "json2class::MappedFile file;\n";
+    ss << Indent(indent_level + 1) << "json2class::MapFile(file, path);\n";
+    ss << Indent(indent_level + 1)
+       << "return ParseNdjson(file.data(), threads);\n";
+    ss << Indent(indent_level) << "}\n\n";
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateMappedFileSupport() {
+  static const char kMapFileSupport[] = R"(#ifndef JSON2CLASS_MAP_FILE_
+#define JSON2CLASS_MAP_FILE_
+
+namespace json2class {
+
+// Maps |path| for the generated file readers. Throws std::system_error if the
+// file cannot be mapped.
+inline void MapFile(MappedFile& file, const std::string& path) {
+  if (!file.Open(path)) {
+    JSON2CLASS_THROW(
+        std::system_error(file.error(), "json2class: cannot map " + path));
+  }
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_MAP_FILE_
+
+)";
+  // mapped_file.h from its include guard on, without the copyright header
+  const std::string_view source(kMappedFileSource);
+  return std::string(source.substr(
+             source.find("#ifndef JSON2CLASS_MAPPED_FILE_"))) +
+         "\n" + kMapFileSupport;
+}
+
+std::string JsonClassGenerator::GenerateFlatMethods(const json& j,
+                                                    bool root,
+                                                    int indent_level) {
+  std::stringstream ss;
+
+  int table_size = 0;
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    table_size += GetFlatSlotSize(it.key(), it.value());
+  }
+  ss << Indent(indent_level) << "static constexpr std::size_t kFlatSize = "
+     << table_size << ";\n";
+  if (root) {
+    std::stringstream fingerprint;
+    fingerprint << std::hex << HashKey(GetFlatSchema(j));
+    ss << Indent(indent_level)
+       << "static constexpr std::uint64_t kFlatFingerprint = 0x"
+       << fingerprint.str() << "ull;\n";
+  }
+  ss << "\n";
+
+  if (j.empty()) {
+    ss << Indent(indent_level)
+       << "void WriteFlat(json2class::FlatBuilder&, std::size_t) const {}\n\n";
+  } else {
+    ss << Indent(indent_level) << "void WriteFlat(json2class::FlatBuilder& "
+                                  "builder, std::size_t pos) const {\n";
+    int offset = 0;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      // Lazy fields are read through their getters, which parse them first
+      const std::string field = options_.lazy_parsing
+                                    ? it.key() + "()"
+                                    : SanitizeIdentifier(it.key()) + "_";
+      ss << Indent(indent_level + 1) << "json2class::WriteFlat(builder, pos + "
+         << offset << ", " << field << ");\n";
+      offset += GetFlatSlotSize(it.key(), it.value());
+    }
+    ss << Indent(indent_level) << "}\n\n";
+  }
+
+  if (root) {
+    ss << Indent(indent_level) << "void Build(std::string& out) const {\n";
+    ss << Indent(indent_level + 1)
+       << "json2class::FlatBuilder builder(out, kFlatFingerprint);\n";
+    ss << Indent(indent_level + 1)
+       << "WriteFlat(builder, builder.Reserve(kFlatSize));\n";
+    ss << Indent(indent_level) << "}\n\n";
+  }
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateFlatView(const json& j,
+                                                 bool root,
+                                                 int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "class View {\n";
+  ss << Indent(indent_level) << " public:\n";
+  ss << Indent(indent_level + 1)
+     << "View(std::string_view data, std::size_t pos) : data_(data), "
+        "pos_(pos) {}\n\n";
+  if (root) {
+    ss << Indent(indent_level + 1)
+       << "static View Open(std::string_view data) {\n";
+    ss << Indent(indent_level + 2) << "return View(data, json2class::OpenFlat(\n";
+    ss << Indent(indent_level + 4)
+       << "data, kFlatFingerprint, kFlatSize));\n";
+    ss << Indent(indent_level + 1) << "}\n\n";
+  }
+
+  int offset = 0;
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    const json& value = it.value();
+    NumberType number;
+    const std::string type =
+        value.is_object() ? SanitizeIdentifier(it.key()) + "_type"
+        : GetNumberType(it.key(), value, number)
+            ? GetFieldType(it.key(), value)
+            : GetTypeForValue(value, ElementClassName(it.key()));
+    ss << Indent(indent_level + 1) << "json2class::FlatView<" << type << "> "
+       << it.key() << "() const {\n";
+    ss << Indent(indent_level + 2) << "return json2class::ReadFlat<" << type
+       << ">(data_, pos_ + " << offset << ");\n";
+    ss << Indent(indent_level + 1) << "}\n\n";
+    offset += GetFlatSlotSize(it.key(), value);
+  }
+
+  ss << Indent(indent_level) << " private:\n";
+  ss << Indent(indent_level + 1) << "std::string_view data_;\n";
+  ss << Indent(indent_level + 1) << "std::size_t pos_;\n";
+  ss << Indent(indent_level) << "};\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateFlatSupport() {
+  static const char kFlatSupport[] = R"(#ifndef JSON2CLASS_FLAT_
+#define JSON2CLASS_FLAT_
+
+namespace json2class {
+
+// A flat snapshot starts with a 16-byte header: the magic, the format version
+// and the fingerprint of the schema it was built from. The root table
+// follows. A table has one fixed-size slot per field in declaration order:
+// scalars are stored inline, strings and arrays as a 32-bit offset and
+// count, nested objects as the 32-bit offset of their own table. Values are
+// little-endian and unaligned, so a snapshot can be read straight from a
+// memory mapping.
+constexpr char kFlatMagic[4] = {'J', '2', 'C', 'F'};
+constexpr std::uint32_t kFlatVersion = 1;
+constexpr std::size_t kFlatHeaderSize = 16;
+
+inline bool FlatLittleEndian() {
+  const std::uint16_t probe = 1;
+  unsigned char first;
+  std::memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+template <typename T>
+T LoadFlat(const char* data) {
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, data, sizeof(T));
+  if (!FlatLittleEndian()) {
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void StoreFlat(char* data, T value) {
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  if (!FlatLittleEndian()) {
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+  std::memcpy(data, bytes, sizeof(T));
+}
+
+// Throws std::runtime_error unless |size| bytes at |pos| lie within |data|.
+inline void CheckFlatRange(std::string_view data,
+                           std::uint64_t pos,
+                           std::uint64_t size) {
+  if (pos > data.size() || size > data.size() - pos) {
+    JSON2CLASS_THROW(
+        std::runtime_error("json2class: snapshot is truncated or corrupt"));
+  }
+}
+
+// Checks the header of a snapshot and returns the offset of its root table.
+inline std::size_t OpenFlat(std::string_view data,
+                            std::uint64_t fingerprint,
+                            std::size_t table_size) {
+  if (data.size() < kFlatHeaderSize ||
+      std::memcmp(data.data(), kFlatMagic, sizeof(kFlatMagic)) != 0 ||
+      LoadFlat<std::uint32_t>(data.data() + 4) != kFlatVersion) {
+    JSON2CLASS_THROW(std::runtime_error("json2class: not a snapshot"));
+  }
+  if (LoadFlat<std::uint64_t>(data.data() + 8) != fingerprint) {
+    JSON2CLASS_THROW(std::runtime_error(
+        "json2class: snapshot was built for a different schema"));
+  }
+  CheckFlatRange(data, kFlatHeaderSize, table_size);
+  return kFlatHeaderSize;
+}
+
+// Appends tables and out-of-line data to a snapshot. Slots are addressed by
+// offset because the buffer moves as it grows.
+class FlatBuilder {
+ public:
+  FlatBuilder(std::string& out, std::uint64_t fingerprint) : out_(out) {
+    out_.assign(kFlatHeaderSize, '\0');
+    std::memcpy(&out_[0], kFlatMagic, sizeof(kFlatMagic));
+    Store(4, kFlatVersion);
+    Store(8, fingerprint);
+  }
+
+  // Appends |size| zero bytes and returns their offset.
+  std::size_t Reserve(std::size_t size) {
+    const std::size_t pos = out_.size();
+    if (size > std::numeric_limits<std::uint32_t>::max() - pos) {
+      JSON2CLASS_THROW(std::length_error("json2class: snapshot exceeds 4 GiB"));
+    }
+    out_.resize(pos + size);
+    return pos;
+  }
+
+  std::size_t Append(const char* data, std::size_t size) {
+    const std::size_t pos = Reserve(size);
+    if (size != 0) {
+      std::memcpy(&out_[pos], data, size);
+    }
+    return pos;
+  }
+
+  template <typename T>
+  void Store(std::size_t pos, T value) {
+    StoreFlat(&out_[pos], value);
+  }
+
+  // Stores the offset and count of out-of-line data in the slot at |pos|.
+  void StoreRange(std::size_t pos, std::size_t offset, std::size_t count) {
+    Store(pos, static_cast<std::uint32_t>(offset));
+    Store(pos + 4, static_cast<std::uint32_t>(count));
+  }
+
+ private:
+  std::string& out_;
+};
+
+// Describes how a member type is laid out: the width of its slot, the type a
+// view returns for it, and how to read and write the slot.
+template <typename T, typename = void>
+struct FlatTraits;
+
+template <typename T>
+using FlatView = typename FlatTraits<T>::View;
+
+template <typename T>
+FlatView<T> ReadFlat(std::string_view data, std::size_t pos) {
+  return FlatTraits<T>::Read(data, pos);
+}
+
+template <typename T>
+void WriteFlat(FlatBuilder& builder, std::size_t pos, const T& value) {
+  FlatTraits<T>::Write(builder, pos, value);
+}
+
+template <typename T>
+struct FlatTraits<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+  using View = T;
+  static constexpr std::size_t kSize = sizeof(T);
+
+  static View Read(std::string_view data, std::size_t pos) {
+    return LoadFlat<T>(data.data() + pos);
+  }
+
+  static void Write(FlatBuilder& builder, std::size_t pos, T value) {
+    builder.Store(pos, value);
+  }
+};
+
+template <>
+struct FlatTraits<bool> {
+  using View = bool;
+  static constexpr std::size_t kSize = 1;
+
+  static View Read(std::string_view data, std::size_t pos) {
+    return data[pos] != 0;
+  }
+
+  static void Write(FlatBuilder& builder, std::size_t pos, bool value) {
+    builder.Store(pos, static_cast<std::uint8_t>(value));
+  }
+};
+
+template <>
+struct FlatTraits<std::string_view> {
+  using View = std::string_view;
+  static constexpr std::size_t kSize = 8;
+
+  static View Read(std::string_view data, std::size_t pos) {
+    const std::uint32_t offset = LoadFlat<std::uint32_t>(data.data() + pos);
+    const std::uint32_t size = LoadFlat<std::uint32_t>(data.data() + pos + 4);
+    CheckFlatRange(data, offset, size);
+    return data.substr(offset, size);
+  }
+
+  static void Write(FlatBuilder& builder,
+                    std::size_t pos,
+                    std::string_view value) {
+    builder.StoreRange(pos, builder.Append(value.data(), value.size()),
+                       value.size());
+  }
+};
+
+// Owned strings have the layout of string views.
+template <typename Traits, typename Allocator>
+struct FlatTraits<std::basic_string<char, Traits, Allocator>>
+    : FlatTraits<std::string_view> {};
+
+// A read-only view of an array in a snapshot.
+template <typename T>
+class FlatVector {
+ public:
+  using value_type = FlatView<T>;
+
+  class iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = FlatView<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    iterator(const FlatVector* vector, std::size_t index)
+        : vector_(vector), index_(index) {}
+
+    value_type operator*() const { return (*vector_)[index_]; }
+
+    iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+
+    bool operator==(const iterator& other) const {
+      return index_ == other.index_;
+    }
+
+    bool operator!=(const iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    const FlatVector* vector_;
+    std::size_t index_;
+  };
+
+  FlatVector() = default;
+  FlatVector(std::string_view data, std::size_t pos, std::size_t size)
+      : data_(data), pos_(pos), size_(size) {}
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  value_type operator[](std::size_t index) const {
+    return FlatTraits<T>::Read(data_, pos_ + index * FlatTraits<T>::kSize);
+  }
+
+  value_type at(std::size_t index) const {
+    if (index >= size_) {
+      JSON2CLASS_THROW(std::out_of_range("json2class: index out of range"));
+    }
+    return (*this)[index];
+  }
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size_); }
+
+ private:
+  std::string_view data_;
+  std::size_t pos_ = 0;
+  std::size_t size_ = 0;
+};
+
+template <typename T, typename Allocator>
+struct FlatTraits<std::vector<T, Allocator>> {
+  using View = FlatVector<T>;
+  static constexpr std::size_t kSize = 8;
+
+  static View Read(std::string_view data, std::size_t pos) {
+    const std::uint32_t offset = LoadFlat<std::uint32_t>(data.data() + pos);
+    const std::uint32_t size = LoadFlat<std::uint32_t>(data.data() + pos + 4);
+    CheckFlatRange(data, offset,
+                   static_cast<std::uint64_t>(size) * FlatTraits<T>::kSize);
+    return View(data, offset, size);
+  }
+
+  static void Write(FlatBuilder& builder,
+                    std::size_t pos,
+                    const std::vector<T, Allocator>& value) {
+    const std::size_t elements =
+        builder.Reserve(value.size() * FlatTraits<T>::kSize);
+    builder.StoreRange(pos, elements, value.size());
+    for (std::size_t i = 0; i < value.size(); ++i) {
+      FlatTraits<T>::Write(builder, elements + i * FlatTraits<T>::kSize,
+                           value[i]);
+    }
+  }
+};
+
+// A read-only view of a map in a snapshot. Entries are stored sorted by key,
+// so a lookup is a binary search.
+template <typename T>
+class FlatMap {
+ public:
+  static constexpr std::size_t kEntrySize = 8 + FlatTraits<T>::kSize;
+
+  FlatMap() = default;
+  FlatMap(std::string_view data, std::size_t pos, std::size_t size)
+      : data_(data), pos_(pos), size_(size) {}
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  std::string_view key(std::size_t index) const {
+    return ReadFlat<std::string>(data_, pos_ + index * kEntrySize);
+  }
+
+  FlatView<T> value(std::size_t index) const {
+    return FlatTraits<T>::Read(data_, pos_ + index * kEntrySize + 8);
+  }
+
+  // Returns the index of |key|, or size() if it is not present.
+  std::size_t find(std::string_view key) const {
+    std::size_t low = 0;
+    std::size_t high = size_;
+    while (low < high) {
+      const std::size_t middle = low + (high - low) / 2;
+      if (this->key(middle) < key) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    return low < size_ && this->key(low) == key ? low : size_;
+  }
+
+  bool contains(std::string_view key) const { return find(key) != size_; }
+
+  FlatView<T> at(std::string_view key) const {
+    const std::size_t index = find(key);
+    if (index == size_) {
+      JSON2CLASS_THROW(std::out_of_range("json2class: key not found"));
+    }
+    return value(index);
+  }
+
+ private:
+  std::string_view data_;
+  std::size_t pos_ = 0;
+  std::size_t size_ = 0;
+};
+
+template <typename Key, typename T, typename Compare, typename Allocator>
+struct FlatTraits<std::map<Key, T, Compare, Allocator>> {
+  using View = FlatMap<T>;
+  static constexpr std::size_t kSize = 8;
+
+  static View Read(std::string_view data, std::size_t pos) {
+    const std::uint32_t offset = LoadFlat<std::uint32_t>(data.data() + pos);
+    const std::uint32_t size = LoadFlat<std::uint32_t>(data.data() + pos + 4);
+    CheckFlatRange(data, offset,
+                   static_cast<std::uint64_t>(size) * View::kEntrySize);
+    return View(data, offset, size);
+  }
+
+  static void Write(FlatBuilder& builder,
+                    std::size_t pos,
+                    const std::map<Key, T, Compare, Allocator>& value) {
+    std::size_t entry = builder.Reserve(value.size() * View::kEntrySize);
+    builder.StoreRange(pos, entry, value.size());
+    for (const auto& item : value) {
+      FlatTraits<Key>::Write(builder, entry, item.first);
+      FlatTraits<T>::Write(builder, entry + 8, item.second);
+      entry += View::kEntrySize;
+    }
+  }
+};
+
+// Generated classes are stored as the offset of their own table.
+template <typename T>
+struct FlatTraits<T, std::void_t<typename T::View, decltype(T::kFlatSize)>> {
+  using View = typename T::View;
+  static constexpr std::size_t kSize = 4;
+
+  static View Read(std::string_view data, std::size_t pos) {
+    const std::uint32_t offset = LoadFlat<std::uint32_t>(data.data() + pos);
+    CheckFlatRange(data, offset, T::kFlatSize);
+    return View(data, offset);
+  }
+
+  static void Write(FlatBuilder& builder, std::size_t pos, const T& value) {
+    const std::size_t table = builder.Reserve(T::kFlatSize);
+    builder.Store(pos, static_cast<std::uint32_t>(table));
+    value.WriteFlat(builder, table);
+  }
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_FLAT_
+
+)";
+  // Emitted only for classes with enums.
+  static const char kFlatEnumSupport[] = R"(#ifndef JSON2CLASS_FLAT_ENUM_
+#define JSON2CLASS_FLAT_ENUM_
+
+namespace json2class {
+
+// Enums are stored as their strings, so the layout does not depend on the
+// numbering of their values.
+template <typename T>
+struct FlatTraits<T, std::enable_if_t<IsTextEnum<T>::value>>
+    : FlatTraits<std::string_view> {
+  static void Write(FlatBuilder& builder, std::size_t pos, const T& value) {
+    FlatTraits<std::string_view>::Write(builder, pos, ToString(value));
+  }
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_FLAT_ENUM_
+
+)";
+  // Emitted only with --intern.
+  static const char kFlatInternSupport[] = R"(#ifndef JSON2CLASS_FLAT_INTERN_
+#define JSON2CLASS_FLAT_INTERN_
+
+namespace json2class {
+
+template <>
+struct FlatTraits<InternedString> : FlatTraits<std::string_view> {};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_FLAT_INTERN_
+
+)";
+  std::string support = kFlatSupport;
+  if (!options_.enums.empty()) {
+    support += kFlatEnumSupport;
+  }
+  if (options_.intern_strings) {
+    support += kFlatInternSupport;
+  }
+  return support;
+}
+
+void JsonClassGenerator::CollectColumnFields(
+    const json& j,
+    const std::string& prefix,
+    const std::string& parent,
+    const std::string& scope,
+    std::vector<ColumnField>& fields) {
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    const std::string name = prefix + SanitizeIdentifier(it.key());
+    const json& value = it.value();
+    if (value.is_object()) {
+      const std::string path = field_path_;
+      field_path_ += NestedPath(it.key(), value);
+      CollectColumnFields(value, name + "_", parent + it.key() + "().",
+                          scope + SanitizeIdentifier(it.key()) + "_type::",
+                          fields);
+      field_path_ = path;
+    } else {
+      // Columns own their strings even when the records hold views, and
+      // store enums as they are
+      fields.push_back({name, GetFieldType(it.key(), value, scope, true),
+                        GetFieldType(it.key(), value, scope), parent,
+                        it.key(),
+                        GetEnumValues(it.key(), value).empty() &&
+                            (value.is_string() || value.is_null())});
+    }
+  }
+}
+
+std::string JsonClassGenerator::GenerateColumnsClass(
+    const std::string& class_name,
+    const json& j) {
+  std::stringstream ss;
+  std::vector<ColumnField> fields;
+  CollectColumnFields(j, "", "", class_name + "::", fields);
+  const std::string columns_name = class_name + "_columns";
+  // Classes without fields have no columns to use the parameters
+  const bool has_fields = !fields.empty();
+
+  ss << "class " << columns_name << " {\n";
+  ss << " public:\n";
+  ss << "  std::size_t size() const {\n";
+  ss << "    return size_;\n";
+  ss << "  }\n\n";
+  ss << "  bool empty() const {\n";
+  ss << "    return size_ == 0;\n";
+  ss << "  }\n\n";
+
+  ss << "  void reserve(std::size_t" << (has_fields ? " size" : "")
+     << ") {\n";
+  for (const ColumnField& field : fields) {
+    ss << "    " << field.name << "_.reserve(size);\n";
+  }
+  ss << "  }\n\n";
+
+  ss << "  void clear() {\n";
+  for (const ColumnField& field : fields) {
+    ss << "    " << field.name << "_.clear();\n";
+  }
+  ss << "    size_ = 0;\n";
+  ss << "  }\n\n";
+
+  ss << "  void append(const json& j) {\n";
+  ss << "    append(" << class_name << "(j));\n";
+  ss << "  }\n\n";
+
+  ss << "  void append(const " << class_name << "&"
+     << (has_fields ? " record" : "") << ") {\n";
+  for (const ColumnField& field : fields) {
+    const std::string value = "record." + field.parent + field.key + "()";
+    ss << "    " << field.name << "_.push_back("
+       << (field.is_string || field.type == field.member_type
+               ? value
+               : "json2class::ConvertStrings<" + field.type + ">(" + value +
+                     ")")
+       << ");\n";
+  }
+  ss << "    ++size_;\n";
+  ss << "  }\n\n";
+
+  ss << "  " << class_name << " row(std::size_t"
+     << (has_fields ? " index" : "") << ") const {\n";
+  ss << "    " << class_name << " record;\n";
+  for (const ColumnField& field : fields) {
+    std::string value = field.name + "_[index]";
+    if (field.type != field.member_type) {
+      value = field.is_string ? value
+                              : "json2class::ConvertStrings<" +
+                                    field.member_type + ">(" + value + ")";
+    } else if (field.is_string) {
+      value = field.type + "(" + value + ")";
+    }
+    ss << "    record." << field.parent << "set_" << field.key << "("
+       << value << ");\n";
+  }
+  ss << "    return record;\n";
+  ss << "  }\n\n";
+
+  for (const ColumnField& field : fields) {
+    ss << "  const json2class::Column<" << field.type << ">& " << field.name
+       << "() const {\n";
+    ss << "    return " << field.name << "_;\n";
+    ss << "  }\n\n";
+  }
+
+  ss << " private:\n";
+  for (const ColumnField& field : fields) {
+    ss << "  json2class::Column<" << field.type << "> " << field.name
+       << "_;\n";
+  }
+  ss << "  std::size_t size_ = 0;\n";
+  ss << "};\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateColumnsSupport() {
+  static const char kColumnsSupport[] = R"(#ifndef JSON2CLASS_COLUMNS_
+#define JSON2CLASS_COLUMNS_
+
+namespace json2class {
+
+// Converts between arrays of owned strings and the arrays of string views
+// or interned strings of a record.
+template <typename To, typename From>
+To ConvertStrings(const From& value) {
+  if constexpr (std::is_constructible_v<To, const From&>) {
+    return To(value);
+  } else {
+    To converted;
+    converted.reserve(value.size());
+    for (const auto& element : value) {
+      converted.push_back(ConvertStrings<typename To::value_type>(element));
+    }
+    return converted;
+  }
+}
+
+// A read-only view of contiguous values.
+template <typename T>
+class ColumnSpan {
+ public:
+  ColumnSpan(T* data, std::size_t size) : data_(data), size_(size) {}
+
+  T* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T& operator[](std::size_t index) const { return data_[index]; }
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+
+ private:
+  T* data_;
+  std::size_t size_;
+};
+
+// One field of many records, stored contiguously. Scans over a column touch
+// only that field.
+template <typename T>
+class Column {
+ public:
+  std::size_t size() const { return values_.size(); }
+  void reserve(std::size_t size) { values_.reserve(size); }
+  void clear() { values_.clear(); }
+  void push_back(const T& value) { values_.push_back(value); }
+  const T& operator[](std::size_t index) const { return values_[index]; }
+
+  ColumnSpan<const T> span() const {
+    return ColumnSpan<const T>(values_.data(), values_.size());
+  }
+
+ private:
+  std::vector<T> values_;
+};
+
+// Booleans are stored one per byte, not as std::vector<bool> bits, so that
+// the column is a plain array.
+template <>
+class Column<bool> {
+ public:
+  std::size_t size() const { return values_.size(); }
+  void reserve(std::size_t size) { values_.reserve(size); }
+  void clear() { values_.clear(); }
+  void push_back(bool value) { values_.push_back(value ? 1 : 0); }
+  bool operator[](std::size_t index) const { return values_[index] != 0; }
+
+  ColumnSpan<const std::uint8_t> span() const {
+    return ColumnSpan<const std::uint8_t>(values_.data(), values_.size());
+  }
+
+ private:
+  std::vector<std::uint8_t> values_;
+};
+
+// Strings are stored back to back in one arena, with the end offset of each.
+template <typename Traits, typename Allocator>
+class Column<std::basic_string<char, Traits, Allocator>> {
+ public:
+  std::size_t size() const { return ends_.size(); }
+
+  void reserve(std::size_t size) { ends_.reserve(size); }
+
+  void clear() {
+    chars_.clear();
+    ends_.clear();
+  }
+
+  void push_back(std::string_view value) {
+    chars_.append(value.data(), value.size());
+    ends_.push_back(chars_.size());
+  }
+
+  std::string_view operator[](std::size_t index) const {
+    const std::size_t begin = index == 0 ? 0 : ends_[index - 1];
+    return std::string_view(chars_.data() + begin, ends_[index] - begin);
+  }
+
+  // All strings of the column, concatenated.
+  std::string_view chars() const { return chars_; }
+
+  ColumnSpan<const std::size_t> ends() const {
+    return ColumnSpan<const std::size_t>(ends_.data(), ends_.size());
+  }
+
+ private:
+  std::string chars_;
+  std::vector<std::size_t> ends_;
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_COLUMNS_
+
+)";
+  return kColumnsSupport;
+}
+
+std::string JsonClassGenerator::GenerateLazyIndexMethods(int indent_level) {
+  std::stringstream ss;
+
+  ss << Indent(indent_level) << "void FromJsonString(std::string_view text) {\n";
+  ss << Indent(indent_level + 1)
+     << "FromJsonBuffer(std::make_shared<const std::string>(text));\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level) << "void FromJsonStream(std::istream& in) {\n";
+  ss << Indent(indent_level + 1)
+     << "FromJsonBuffer(std::make_shared<const std::string>(\n";
+  ss << Indent(indent_level + 3) << "std::istreambuf_iterator<char>(in),\n";
+  ss << Indent(indent_level + 3) << "std::istreambuf_iterator<char>()));\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level)
+     << "void FromJsonBuffer(std::shared_ptr<const std::string> buffer) {\n";
+  ss << Indent(indent_level + 1)
+     << "const json2class::LazySpan span = json2class::WholeSpan(*buffer);\n";
+  ss << Indent(indent_level + 1) << "IndexJson(std::move(buffer), span);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  // Takes over a document the caller no longer needs without copying it
+  ss << Indent(indent_level) << "void FromJsonBuffer(std::string&& text) {\n";
+  ss << Indent(indent_level + 1)
+     << "FromJsonBuffer(std::make_shared<const std::string>(std::move(text)));"
+        "\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  ss << Indent(indent_level)
+     << "void IndexJson(std::shared_ptr<const std::string> source,\n";
+  ss << Indent(indent_level + 4) << "json2class::LazySpan span) {\n";
+  // The object is only changed once the whole document was scanned, so a
+  // malformed one leaves it as it was
+  ss << Indent(indent_level + 1) << "decltype(lazy_spans_) spans;\n";
+  ss << Indent(indent_level + 1)
+     << "std::vector<json2class::LazySpan> unknown;\n";
+  ss << Indent(indent_level + 1)
+     << "json2class::IndexJsonObject(*source, span, &FieldIndex, spans, "
+        "unknown);\n";
+  ss << Indent(indent_level + 1) << "lazy_spans_ = spans;\n";
+  ss << Indent(indent_level + 1) << "lazy_unknown_.swap(unknown);\n";
+  ss << Indent(indent_level + 1) << "lazy_source_ = std::move(source);\n";
+  ss << Indent(indent_level + 1) << "lazy_ready_.clear();\n";
+  ss << Indent(indent_level + 1) << "lazy_dirty_.clear();\n";
+  if (options_.string_views) {
+    ss << Indent(indent_level + 1) << "lazy_strings_.clear();\n";
+  }
+  ss << Indent(indent_level) << "}\n\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateLazyMaterialize(const std::string& key,
+                                                        const json& value,
+                                                        int field_index,
+                                                        int indent_level) {
+  std::stringstream ss;
+  const std::string member = SanitizeIdentifier(key) + "_";
+  const std::string span =
+      "lazy_spans_[" + std::to_string(field_index) + "]";
+
+  const std::string test =
+      "lazy_ready_.test(" + std::to_string(field_index) + ")";
+
+  // The thread-safe variant checks its bit with one acquire load and
+  // materializes under a lock, so concurrent readers parse a field once.
+  int level = indent_level;
+  ss << Indent(level) << "if (!" << test << ") {\n";
+  if (options_.thread_safe) {
+    ss << Indent(level + 1)
+       << "std::lock_guard<std::mutex> lock(json2class::LazyMutex(this));\n";
+    ss << Indent(level + 1) << "if (!" << test << ") {\n";
+    level += 2;
+  } else {
+    level += 1;
+  }
+  if (value.is_object()) {
+    ss << Indent(level) << member << " = decltype(" << member << "){};\n";
+    ss << Indent(level) << "if (" << span << ".size != 0) {\n";
+    ss << Indent(level + 1) << member << ".IndexJson(lazy_source_, " << span
+       << ");\n";
+  } else if (ObjectElementSample(value).is_object()) {
+    // Elements share the source, like nested objects
+    ss << Indent(level) << member << " = decltype(" << member << "){};\n";
+    ss << Indent(level) << "if (" << span << ".size != 0) {\n";
+    ss << Indent(level + 1) << "json2class::IndexJsonValue(lazy_source_, "
+       << span << ", " << member << ");\n";
+  } else if (options_.string_views && HoldsStrings(value) &&
+             GetEnumValues(key, value).empty()) {
+    // Strings without escapes are views into the source
+    ss << Indent(level) << member << " = decltype(" << member << "){"
+       << GetDefaultValueString(value) << "};\n";
+    ss << Indent(level) << "if (" << span << ".size != 0) {\n";
+    ss << Indent(level + 1) << "json2class::ParseView(*lazy_source_, " << span
+       << ", " << member << ", lazy_strings_, " << field_index << ");\n";
+  } else {
+    ss << Indent(level) << member << " = decltype(" << member << "){"
+       << GetFieldDefault(key, value) << "};\n";
+    ss << Indent(level) << "if (" << span << ".size != 0) {\n";
+    ss << Indent(level + 1) << "json2class::ParseValue(*lazy_source_, " << span
+       << ", " << member << ");\n";
+  }
+  ss << Indent(level) << "}\n";
+  ss << Indent(level) << "lazy_ready_.set(" << field_index << ");\n";
+  if (options_.thread_safe) {
+    ss << Indent(indent_level + 1) << "}\n";
+  }
+  ss << Indent(indent_level) << "}\n";
+
+  return ss.str();
+}
+
+std::string JsonClassGenerator::GenerateLazyIndexSupport() {
+  static const char kLazyIndexSupport[] = R"(#ifndef JSON2CLASS_LAZY_INDEX_
+#define JSON2CLASS_LAZY_INDEX_
+
+namespace json2class {
+
+// Location of a value inside the retained source text of a lazy class. An
+// empty span means the key was not present.
+struct LazySpan {
+  std::uint32_t offset = 0;
+  std::uint32_t size = 0;
+};
+
+// Smallest unsigned type that holds one bit per field, up to 64 bits.
+template <std::size_t N>
+using LazyBitsWord = std::conditional_t<
+    N <= 8,
+    std::uint8_t,
+    std::conditional_t<N <= 16,
+                       std::uint16_t,
+                       std::conditional_t<N <= 32, std::uint32_t,
+                                          std::uint64_t>>>;
+
+// One bit per field of a lazy class, set once the field is materialized.
+template <std::size_t N>
+class LazyBits {
+ public:
+  using Word = LazyBitsWord<N>;
+  static constexpr std::size_t kWordBits = sizeof(Word) * 8;
+
+  bool test(std::size_t i) const {
+    return (words_[i / kWordBits] >> (i % kWordBits)) & 1;
+  }
+  void set(std::size_t i) {
+    words_[i / kWordBits] |= static_cast<Word>(Word{1} << (i % kWordBits));
+  }
+  void clear() { words_.fill(0); }
+
+ private:
+  std::array<Word, (N + kWordBits - 1) / kWordBits> words_{};
+};
+
+inline LazySpan WholeSpan(const std::string& source) {
+  if (source.size() > UINT32_MAX) {
+    JSON2CLASS_THROW(
+        std::length_error("json2class: lazy documents are limited to 4 GiB"));
+  }
+  return {0, static_cast<std::uint32_t>(source.size())};
+}
+
+// Returns the span of [begin, end), which lies inside |source|.
+inline LazySpan SourceSpan(const std::string& source,
+                           const char* begin,
+                           const char* end) {
+  return {static_cast<std::uint32_t>(begin - source.data()),
+          static_cast<std::uint32_t>(end - begin)};
+}
+
+// Records where the value of every key known to |field_index| is in the
+// object in |span| of |source|, and where each other member is in |unknown|,
+// so that it can be written back. Values themselves are not parsed. Anything
+// that is not an object leaves all spans empty, like FromJson.
+template <std::size_t N>
+void IndexJsonObject(const std::string& source,
+                     LazySpan span,
+                     int (*field_index)(std::string_view),
+                     std::array<LazySpan, N>& spans,
+                     std::vector<LazySpan>& unknown) {
+  spans.fill(LazySpan{});
+  unknown.clear();
+  const char* const begin = source.data() + span.offset;
+  ScanJsonObject(begin, begin + span.size,
+                 [&](std::string_view key, const char* value,
+                     const char* value_end, const char* member) {
+                   const int field = field_index(key);
+                   if (field >= 0) {
+                     spans[field] = SourceSpan(source, value, value_end);
+                   } else {
+                     unknown.push_back(SourceSpan(source, member, value_end));
+                   }
+                 });
+}
+
+// Copies one value of the retained source to |sink| as it is.
+template <typename Sink>
+void WriteRaw(Sink& sink, const std::string& source, LazySpan span) {
+  sink.Append(source.data() + span.offset, span.size);
+}
+
+// Copies the members of the retained source in |members| to |sink|, with a
+// comma before each one but the first if |first|.
+template <typename Sink>
+void WriteRawMembers(Sink& sink,
+                     const std::shared_ptr<const std::string>& source,
+                     const std::vector<LazySpan>& members,
+                     bool first) {
+  for (const LazySpan& member : members) {
+    if (!first) {
+      sink.Append(',');
+    }
+    first = false;
+    WriteRaw(sink, *source, member);
+  }
+}
+
+// Adds the members of the retained source in |members| to |j|.
+inline void AddRawMembers(json& j,
+                          const std::shared_ptr<const std::string>& source,
+                          const std::vector<LazySpan>& members) {
+  if (members.empty()) {
+    return;
+  }
+  std::string text;
+  StringSink sink(text);
+  sink.Append('{');
+  WriteRawMembers(sink, source, members, true);
+  sink.Append('}');
+  j.update(json::parse(text));
+}
+
+// Parses one value of the retained source into a json value.
+inline json ParseRaw(const std::string& source, LazySpan span) {
+  const char* const begin = source.data() + span.offset;
+  return json::parse(begin, begin + span.size);
+}
+
+// Parses one value of the retained source into |value|.
+template <typename T>
+void ParseValue(const std::string& source, LazySpan span, T& value) {
+  SaxReader reader(MakeSaxSlot(value));
+  const char* const begin = source.data() + span.offset;
+  json::sax_parse(begin, begin + span.size, &reader);
+}
+
+// Indexes a lazy class, or every element of an array of them, in place. The
+// elements keep a reference to |source| instead of a copy of their text.
+// Values that are not arrays leave the array empty, like the SAX reader.
+template <typename T>
+auto IndexJsonValue(const std::shared_ptr<const std::string>& source,
+                    LazySpan span,
+                    T& value) -> decltype(value.IndexJson(source, span)) {
+  value.IndexJson(source, span);
+}
+
+template <typename T, typename Allocator>
+void IndexJsonValue(const std::shared_ptr<const std::string>& source,
+                    LazySpan span,
+                    std::vector<T, Allocator>& value) {
+  value.clear();
+  const char* const begin = source->data() + span.offset;
+  ScanJsonArray(begin, begin + span.size,
+                [&](const char* element, const char* element_end) {
+                  IndexJsonValue(source,
+                                 SourceSpan(*source, element, element_end),
+                                 value.emplace_back());
+                });
+}
+
+// Owns the strings that a string_view member cannot point to in the source:
+// unescaped values and values passed to setters. Each field has a slot, and
+// storing into it releases what the field held before, so the arena stays as
+// large as the current values however often they are set. Copies share the
+// strings, so views stay valid for as long as any copy is alive.
+class StringArena {
+ public:
+  std::string_view Store(std::size_t slot, std::string_view value) {
+    std::vector<std::shared_ptr<const std::string>> strings;
+    const std::string_view stored = Add(strings, std::string(value));
+    Slot(slot).swap(strings);
+    return stored;
+  }
+
+  template <typename T, typename Allocator>
+  std::vector<T, Allocator> Store(std::size_t slot,
+                                  const std::vector<T, Allocator>& values) {
+    std::vector<std::shared_ptr<const std::string>> strings;
+    std::vector<T, Allocator> stored;
+    stored.reserve(values.size());
+    for (const T& value : values) {
+      stored.push_back(Add(strings, std::string(value)));
+    }
+    Slot(slot).swap(strings);
+    return stored;
   }
-  ss << "\n";
-  ss << "using json = nlohmann::json;\n\n";
 
-  // Generate class definition
-  ss << "class " << class_name << " {\n";
-  ss << " public:\n";
-  ss << "  " << class_name << "() = default;\n";
-  ss << "  ~" << class_name << "() = default;\n\n";
+  // Adds |value| to the strings of |slot|, next to those already there. Only
+  // a field that is being parsed adds to its slot, which starts out empty.
+  std::string_view Append(std::size_t slot, std::string&& value) {
+    return Add(Slot(slot), std::move(value));
+  }
 
-  // JSON constructor
-  ss << "  " << class_name << "(const json& j) {\n";
-  if (lazy_parsing) {
-    ss << "    json_ = j;\n";
-  } else {
-    ss << "    FromJson(j);\n";
+  void clear() { slots_.clear(); }
+
+ private:
+  static std::string_view Add(
+      std::vector<std::shared_ptr<const std::string>>& strings,
+      std::string&& value) {
+    if (value.empty()) {
+      return {};
+    }
+    strings.push_back(std::make_shared<const std::string>(std::move(value)));
+    return *strings.back();
   }
-  ss << "  }\n\n";
 
-  // Add FromJson and ToJson method implementations (directly in the class)
-  ss << "  void FromJson(const json& j) {\n";
-  ss << GenerateFromJsonMethod(class_name, j, 2, lazy_parsing);
-  if (lazy_parsing) {
-    ss << "    json_ = j;\n";
+  std::vector<std::shared_ptr<const std::string>>& Slot(std::size_t slot) {
+    if (slot >= slots_.size()) {
+      slots_.resize(slot + 1);
+    }
+    return slots_[slot];
   }
-  ss << "  }\n\n";
 
-  ss << "  json ToJson() const {\n";
-  ss << GenerateToJsonMethod(class_name, j, 2, lazy_parsing);
-  ss << "  }\n\n";
+  std::vector<std::vector<std::shared_ptr<const std::string>>> slots_;
+};
 
-  // Add member variables
-  ss << " private:\n";
-  if (lazy_parsing) {
-    ss << "  mutable json json_;\n";
+// Returns whether the text of a string token, without its quotes, is the
+// string itself: it has no escapes and no control characters, and it is
+// valid UTF-8 as json::parse checks it.
+inline bool IsPlainJsonString(const char* p, const char* end) {
+  while (p != end) {
+    const auto c = static_cast<unsigned char>(*p);
+    if (c < 0x80) {
+      if (c < 0x20 || c == '\\') {
+        return false;
+      }
+      ++p;
+      continue;
+    }
+    std::size_t length = 0;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+      length = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+      length = 3;
+      low = c == 0xE0 ? 0xA0 : 0x80;
+      high = c == 0xED ? 0x9F : 0xBF;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+      length = 4;
+      low = c == 0xF0 ? 0x90 : 0x80;
+      high = c == 0xF4 ? 0x8F : 0xBF;
+    } else {
+      return false;
+    }
+    if (static_cast<std::size_t>(end - p) < length) {
+      return false;
+    }
+    for (std::size_t i = 1; i < length; ++i) {
+      const auto next = static_cast<unsigned char>(p[i]);
+      if (next < low || next > high) {
+        return false;
+      }
+      low = 0x80;
+      high = 0xBF;
+    }
+    p += length;
   }
-  ss << GenerateClassContent(class_name, j, 1, lazy_parsing);
-
-  // Add getter and setter methods
-  ss << " public:\n";
-  ss << GenerateGettersSetters(class_name, j, 1, lazy_parsing);
+  return true;
+}
 
-  ss << "};\n\n";
-  ss << "#endif  // " << class_name << "_H_\n";
+// Parses a string of the retained source into a view of its text. Strings
+// with escapes are unescaped into |slot| of |strings|, next to what it holds
+// already; any other value is read like ParseValue reads it into a
+// std::string.
+inline void ParseView(const std::string& source,
+                      LazySpan span,
+                      std::string_view& value,
+                      StringArena& strings,
+                      std::size_t slot) {
+  const char* const begin = source.data() + span.offset;
+  const char* const end = begin + span.size;
+  if (span.size >= 2 && *begin == '"' && end[-1] == '"' &&
+      IsPlainJsonString(begin + 1, end - 1)) {
+    value = std::string_view(begin + 1, span.size - 2);
+    return;
+  }
+  std::string text(value);
+  ParseValue(source, span, text);
+  if (text != value) {
+    value = strings.Append(slot, std::move(text));
+  }
+}
 
-  return ss.str();
+// Values that are not arrays leave the array unchanged, like the SAX reader.
+template <typename T, typename Allocator>
+void ParseView(const std::string& source,
+               LazySpan span,
+               std::vector<T, Allocator>& value,
+               StringArena& strings,
+               std::size_t slot) {
+  std::vector<T, Allocator> elements;
+  const char* const begin = source.data() + span.offset;
+  if (ScanJsonArray(begin, begin + span.size,
+                    [&](const char* element, const char* element_end) {
+                      ParseView(source,
+                                SourceSpan(source, element, element_end),
+                                elements.emplace_back(), strings, slot);
+                    })) {
+    value = std::move(elements);
+  }
 }
 
-std::string JsonClassGenerator::GenerateClassContent(
-    const std::string& class_name,
-    const json& j,
-    int indent_level,
-    bool lazy_parsing) {
-  (void)class_name;
-  std::stringstream ss;
+}  // namespace json2class
 
-  for (auto it = j.begin(); it != j.end(); ++it) {
-    const std::string& key = it.key();
-    std::string sanitized_key = SanitizeIdentifier(key);
-    const json& value = it.value();
+#endif  // JSON2CLASS_LAZY_INDEX_
 
-    if (value.is_object()) {
-      // Nested object, create inner class
-      std::string nested_class_name = sanitized_key + "_type";
-      ss << Indent(indent_level) << "class " << nested_class_name << " {\n";
-      ss << Indent(indent_level) << " public:\n";
-      ss << Indent(indent_level + 1) << nested_class_name << "() = default;\n";
-      ss << Indent(indent_level + 1) << "~" << nested_class_name
-         << "() = default;\n\n";
+)";
+  // Emitted only with --ndjson.
+  static const char kLazyNdjsonSupport[] = R"(#ifndef JSON2CLASS_LAZY_NDJSON_
+#define JSON2CLASS_LAZY_NDJSON_
 
-      // Add member variables and method declarations
-      ss << Indent(indent_level + 1) << "void FromJson(const json& j) {\n";
-      ss << GenerateFromJsonMethod(nested_class_name, value, indent_level + 2,
-                                   lazy_parsing);
-      if (lazy_parsing) {
-        ss << Indent(indent_level + 2) << "json_ = j;\n";
-      }
-      ss << Indent(indent_level + 1) << "}\n\n";
+namespace json2class {
 
-      ss << Indent(indent_level + 1) << "json ToJson() const {\n";
-      ss << GenerateToJsonMethod(nested_class_name, value, indent_level + 2,
-                                 lazy_parsing);
-      ss << Indent(indent_level + 1) << "}\n\n";
+// Chunk parser for ParseNdjson. The records of one chunk share a single copy
+// of its text as their source.
+template <typename T>
+std::size_t IndexNdjsonChunk(std::string_view chunk, NdjsonBatch<T>& batch) {
+  auto source = std::make_shared<const std::string>(chunk);
+  WholeSpan(*source);
+  return ParseNdjsonLines(
+      std::string_view(*source), batch,
+      [&source](std::string_view line, T& record) {
+        record.IndexJson(
+            source,
+            {static_cast<std::uint32_t>(line.data() - source->data()),
+             static_cast<std::uint32_t>(line.size())});
+      });
+}
 
-      ss << Indent(indent_level) << " private:\n";
-      if (lazy_parsing) {
-        ss << Indent(indent_level + 1) << "mutable json json_;\n";
-      }
-      ss << GenerateClassContent(nested_class_name, value, indent_level + 1,
-                                 lazy_parsing);
+}  // namespace json2class
 
-      // Add getter and setter methods
-      ss << Indent(indent_level) << " public:\n";
-      ss << GenerateGettersSetters(nested_class_name, value, indent_level + 1,
-                                   lazy_parsing);
+#endif  // JSON2CLASS_LAZY_NDJSON_
 
-      ss << Indent(indent_level) << "};\n\n";
+)";
+  std::string support = kLazyIndexSupport;
+  if (options_.ndjson) {
+    support += kLazyNdjsonSupport;
+  }
+  return support;
+}
 
-      // Add instance of the inner class
-      if (lazy_parsing) {
-        ss << Indent(indent_level) << "mutable std::optional<"
-           << nested_class_name << "> " << sanitized_key << "_{" << "decltype("
-           << sanitized_key << "_)::value_type{}};\n";
-      } else {
-        ss << Indent(indent_level) << nested_class_name << " " << sanitized_key
-           << "_;\n";
-      }
-    } else {
-      // Regular member variable
-      std::string type = GetTypeForValue(value);
-      std::string default_value = GetDefaultValueString(value);
+std::string JsonClassGenerator::GenerateLazySyncSupport() {
+  static const char kLazySyncSupport[] = R"(#ifndef JSON2CLASS_LAZY_SYNC_
+#define JSON2CLASS_LAZY_SYNC_
 
-      if (lazy_parsing) {
-        ss << Indent(indent_level) << "mutable std::optional<" << type << "> "
-           << sanitized_key << "_{" << "decltype(" << sanitized_key
-           << "_)::value_type{" << default_value << "}};\n";
-      } else {
-        ss << Indent(indent_level) << type << " " << sanitized_key << "_{"
-           << default_value << "};\n";
-      }
+namespace json2class {
+
+// Materialization bits of a thread-safe lazy class. A bit is set with
+// release semantics after the value is stored, so a reader that sees it set
+// can use the value without locking. Copies take a snapshot of the bits.
+template <std::size_t N>
+class AtomicLazyBits {
+ public:
+  using Word = LazyBitsWord<N>;
+  static constexpr std::size_t kWordBits = sizeof(Word) * 8;
+
+  AtomicLazyBits() = default;
+  AtomicLazyBits(const AtomicLazyBits& other) noexcept { *this = other; }
+  AtomicLazyBits& operator=(const AtomicLazyBits& other) noexcept {
+    for (std::size_t i = 0; i < words_.size(); ++i) {
+      words_[i].store(other.words_[i].load(std::memory_order_acquire),
+                      std::memory_order_release);
     }
+    return *this;
   }
 
-  return ss.str();
+  bool test(std::size_t i) const {
+    return (words_[i / kWordBits].load(std::memory_order_acquire) >>
+            (i % kWordBits)) &
+           1;
+  }
+  void set(std::size_t i) {
+    words_[i / kWordBits].fetch_or(
+        static_cast<Word>(Word{1} << (i % kWordBits)),
+        std::memory_order_release);
+  }
+  void clear() {
+    for (auto& word : words_) {
+      word.store(0, std::memory_order_release);
+    }
+  }
+
+ private:
+  std::array<std::atomic<Word>, (N + kWordBits - 1) / kWordBits> words_{};
+};
+
+// Serializes the slow path of the lazy getters. Objects share a small pool
+// of mutexes so the classes do not grow by a mutex each.
+inline std::mutex& LazyMutex(const void* object) {
+  static std::mutex mutexes[64];
+  return mutexes[(reinterpret_cast<std::uintptr_t>(object) >> 4) % 64];
 }
 
-std::string JsonClassGenerator::GenerateFromJsonMethod(
+}  // namespace json2class
+
+#endif  // JSON2CLASS_LAZY_SYNC_
+
+)";
+  return kLazySyncSupport;
+}
+
+std::string JsonClassGenerator::GeneratePmrMethods(
     const std::string& class_name,
     const json& j,
-    int indent_level,
-    bool lazy_parsing) {
-  (void)class_name;
+    int indent_level) {
   std::stringstream ss;
 
-  if (!lazy_parsing) {
-    // Directly parse JSON
-    for (auto it = j.begin(); it != j.end(); ++it) {
-      const std::string& key = it.key();
-      const json& value = it.value();
+  // Initializers of the members that allocate, in declaration order.
+  std::vector<std::string> defaults;
+  std::vector<std::string> copies;
+  std::vector<std::string> moves;
+  for (const std::string& key : GetMemberOrder(j)) {
+    const std::string member = SanitizeIdentifier(key) + "_";
+    const json& value = j.at(key);
+    if (value.is_boolean() || value.is_number() ||
+        !GetEnumValues(key, value).empty()) {
+      copies.push_back(member + "(other." + member + ")");
+      moves.push_back(member + "(other." + member + ")");
+      continue;
+    }
+    const std::string default_value =
+        value.is_array() && !value.empty() ? GetFieldDefault(key, value) : "";
+    if (value.is_string()) {
+      defaults.push_back(member + "(" + GetDefaultValueString(value) +
+                         ", alloc)");
+    } else if (!default_value.empty()) {
+      defaults.push_back(member + "({" + default_value + "}, alloc)");
+    } else {
+      defaults.push_back(member + "(alloc)");
+    }
+    copies.push_back(member + "(other." + member + ", alloc)");
+    moves.push_back(member + "(std::move(other." + member + "), alloc)");
+  }
 
-      if (value.is_object()) {
-        // Nested object
-        ss << Indent(indent_level) << "if (j.contains(\"" << key
-           << "\") && j[\"" << key << "\"].is_object()) {\n";
-        ss << Indent(indent_level + 1) << key << "_.FromJson(j[\"" << key
-           << "\"]);\n";
-        ss << Indent(indent_level) << "}\n";
-      } else if (value.is_array()) {
-        // Array
-        ss << Indent(indent_level) << "if (j.contains(\"" << key
-           << "\") && j[\"" << key << "\"].is_array()) {\n";
-        ss << Indent(indent_level + 1) << key << "_ = j[\"" << key << "\"].get<"
-           << GetTypeForValue(value) << ">();\n";
-        ss << Indent(indent_level) << "}\n";
+  auto write_initializers = [&](const std::vector<std::string>& initializers) {
+    for (std::size_t i = 0; i < initializers.size(); ++i) {
+      if (i == 0) {
+        ss << "\n" << Indent(indent_level + 2) << ": ";
       } else {
-        // Basic type
-        std::string type = GetTypeForValue(value);
-        ss << Indent(indent_level) << "if (j.contains(\"" << key << "\")) {\n";
-        ss << Indent(indent_level + 1) << key << "_ = j[\"" << key << "\"].get<"
-           << type << ">();\n";
-        ss << Indent(indent_level) << "}\n";
+        ss << ",\n" << Indent(indent_level + 3);
       }
+      ss << initializers[i];
     }
-  } else {
-    // Lazy parsing version
-    for (auto it = j.begin(); it != j.end(); ++it) {
-      const std::string& key = it.key();
-      ss << Indent(indent_level) << key << "_.reset();\n";
-    }
-  }
+    ss << " {}\n\n";
+  };
+
+  ss << Indent(indent_level)
+     << "using allocator_type = std::pmr::polymorphic_allocator<char>;\n\n";
+
+  ss << Indent(indent_level) << "explicit " << class_name
+     << "(const allocator_type&" << (defaults.empty() ? "" : " alloc") << ")";
+  write_initializers(defaults);
+
+  ss << Indent(indent_level) << class_name << "(const " << class_name << "&"
+     << (copies.empty() ? "" : " other") << ", const allocator_type&"
+     << (defaults.empty() ? "" : " alloc") << ")";
+  write_initializers(copies);
+
+  ss << Indent(indent_level) << class_name << "(" << class_name << "&&"
+     << (moves.empty() ? "" : " other") << ", const allocator_type&"
+     << (defaults.empty() ? "" : " alloc") << ")";
+  write_initializers(moves);
+
+  ss << Indent(indent_level) << class_name
+     << "(const json& j, const allocator_type& alloc) : " << class_name
+     << "(alloc) {\n";
+  ss << Indent(indent_level + 1) << "FromJson(j);\n";
+  ss << Indent(indent_level) << "}\n\n";
+
+  // Merges like FromJson(j) into a copy, so a rejected |j| leaves the object
+  // unchanged. The members keep their own resource when the copy is moved in
+  ss << Indent(indent_level)
+     << "void FromJson(const json& j, std::pmr::memory_resource* resource) {\n";
+  ss << Indent(indent_level + 1) << class_name << " parsed(*this, resource);\n";
+  ss << Indent(indent_level + 1) << "parsed.FromJson(j);\n";
+  ss << Indent(indent_level + 1) << "*this = std::move(parsed);\n";
+  ss << Indent(indent_level) << "}\n\n";
 
   return ss.str();
 }
 
-std::string JsonClassGenerator::GenerateToJsonMethod(
-    const std::string& class_name,
-    const json& j,
-    int indent_level,
-    bool lazy_parsing) {
-  (void)class_name;
-  std::stringstream ss;
+std::string JsonClassGenerator::GeneratePmrSupport() {
+  static const char kPmrSupport[] = R"(#ifndef JSON2CLASS_PMR_
+#define JSON2CLASS_PMR_
+
+namespace json2class {
+
+// Readers for std::pmr members. They fill a member in place, so its memory
+// comes from the resource it was constructed with and array elements are
+// reused; json::get would build a std::allocator copy first. Mismatched types
+// throw the same json::type_error as json::get.
+template <typename T>
+auto ReadJson(const json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>>;
+inline void ReadJson(const json& j, std::pmr::string& value);
+template <typename T>
+void ReadJson(const json& j, std::pmr::vector<T>& value);
+inline void ReadJson(const json& j, std::pmr::vector<bool>& value);
+template <typename T>
+void ReadJson(const json& j, std::pmr::map<std::pmr::string, T>& value);
+template <typename T>
+auto ReadJson(const json& j, T& value) -> decltype(value.Reparse(j));
 
-  ss << Indent(indent_level) << "json j;\n";
+template <typename T>
+auto ReadJson(const json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>> {
+  ReadNumber(j, value);
+}
+
+inline void ReadJson(const json& j, std::pmr::string& value) {
+  if (!j.is_string()) {
+    JSON2CLASS_THROW(json::type_error::create(
+        302, std::string("type must be string, but is ") + j.type_name(), &j));
+  }
+  value.assign(*j.get_ptr<const std::string*>());
+}
+
+template <typename T>
+void ReadJson(const json& j, std::pmr::vector<T>& value) {
+  if (!j.is_array()) {
+    JSON2CLASS_THROW(json::type_error::create(
+        302, std::string("type must be array, but is ") + j.type_name(), &j));
+  }
+  value.resize(j.size());
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    ReadJson(j[i], value[i]);
+  }
+}
 
+inline void ReadJson(const json& j, std::pmr::vector<bool>& value) {
+  if (!j.is_array()) {
+    JSON2CLASS_THROW(json::type_error::create(
+        302, std::string("type must be array, but is ") + j.type_name(), &j));
+  }
+  value.clear();
+  value.reserve(j.size());
+  for (const json& element : j) {
+    value.push_back(element.get<bool>());
+  }
+}
+
+template <typename T>
+void ReadJson(const json& j, std::pmr::map<std::pmr::string, T>& value) {
+  if (!j.is_object()) {
+    JSON2CLASS_THROW(json::type_error::create(
+        302, std::string("type must be object, but is ") + j.type_name(), &j));
+  }
+  value.clear();
   for (auto it = j.begin(); it != j.end(); ++it) {
-    const std::string& key = it.key();
-    const json& value = it.value();
+    ReadJson(it.value(),
+             value[std::pmr::string(it.key(), value.get_allocator())]);
+  }
+}
 
-    if (value.is_object()) {
-      // Nested object
-      if (lazy_parsing) {
-        ss << Indent(indent_level) << "j[\"" << key << "\"] = " << key
-           << "_.value().ToJson();\n";
-      } else {
-        ss << Indent(indent_level) << "j[\"" << key << "\"] = " << key
-           << "_.ToJson();\n";
-      }
+template <typename T>
+auto ReadJson(const json& j, T& value) -> decltype(value.Reparse(j)) {
+  value.Reparse(j);
+}
 
-    } else {
-      // Basic type or array
-      if (lazy_parsing) {
-        ss << Indent(indent_level) << "j[\"" << key << "\"] = " << key
-           << "_.value_or(decltype(" << key << "_)::value_type{"
-           << GetDefaultValueString(value) << "});\n";
-      } else {
-        ss << Indent(indent_level) << "j[\"" << key << "\"] = " << key
-           << "_;\n";
-      }
+template <>
+struct SaxBinding<std::pmr::string> {
+  static void Value(void* target, const json& value) {
+    ReadJson(value, *static_cast<std::pmr::string*>(target));
+  }
+  static void String(void* target, std::string& value) {
+    static_cast<std::pmr::string*>(target)->assign(value);
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+template <typename T>
+struct SaxBinding<std::pmr::vector<T>> {
+  static SaxSlot Element(void* target, std::size_t index) {
+    auto& value = *static_cast<std::pmr::vector<T>*>(target);
+    if (index < value.size()) {
+      ClearValue(value[index]);
+      return MakeSaxSlot(value[index]);
+    }
+    return MakeSaxSlot(value.emplace_back());
+  }
+  static void EndArray(void* target, std::size_t size) {
+    auto& value = *static_cast<std::pmr::vector<T>*>(target);
+    if (size < value.size()) {
+      value.erase(value.begin() + size, value.end());
     }
   }
+  static constexpr SaxOps kOps = {nullptr,  nullptr, nullptr,
+                                  &Element, nullptr, &EndArray};
+};
 
-  ss << Indent(indent_level) << "return j;\n";
+template <>
+struct SaxBinding<std::pmr::vector<bool>> {
+  static void Append(void* target, const json& value) {
+    static_cast<std::pmr::vector<bool>*>(target)->push_back(value.get<bool>());
+  }
+  static void AppendString(void* target, std::string& value) {
+    Append(target, json(std::move(value)));
+  }
+  static constexpr SaxOps kElementOps = {&Append, &AppendString, nullptr,
+                                         nullptr, nullptr, nullptr};
+  static SaxSlot Element(void* target, std::size_t index) {
+    if (index == 0) {
+      static_cast<std::pmr::vector<bool>*>(target)->clear();
+    }
+    return {target, &kElementOps};
+  }
+  static void EndArray(void* target, std::size_t size) {
+    if (size == 0) {
+      static_cast<std::pmr::vector<bool>*>(target)->clear();
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr, nullptr,
+                                  &Element, nullptr, &EndArray};
+};
 
-  return ss.str();
+template <typename T>
+struct SaxBinding<std::pmr::map<std::pmr::string, T>> {
+  static SaxSlot Member(void* target, std::string_view key) {
+    auto& map = *static_cast<std::pmr::map<std::pmr::string, T>*>(target);
+    return MakeSaxSlot(map[std::pmr::string(key, map.get_allocator())]);
+  }
+  static constexpr SaxOps kOps = {nullptr, nullptr, &Member,
+                                  nullptr, nullptr, nullptr};
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_PMR_
+
+)";
+  return kPmrSupport;
 }
 
 std::string JsonClassGenerator::GenerateGettersSetters(
     const std::string& class_name,
     const json& j,
-    int indent_level,
-    bool lazy_parsing) {
+    int indent_level) {
   (void)class_name;
   std::stringstream ss;
 
-  for (auto it = j.begin(); it != j.end(); ++it) {
+  int field_index = 0;
+  for (auto it = j.begin(); it != j.end(); ++it, ++field_index) {
     const std::string& key = it.key();
+    const std::string member = SanitizeIdentifier(key) + "_";
     const json& value = it.value();
-    std::string type = GetTypeForValue(value);
+    std::string type = GetFieldType(key, value);
+    const bool enumerated = !GetEnumValues(key, value).empty();
+    const bool views =
+        options_.string_views && HoldsStrings(value) && !enumerated;
+    const bool interned = options_.intern_strings && !enumerated &&
+                          (value.is_string() || value.is_null());
 
     // Capitalized property name for method names
     std::string capitalized_key = key;
@@ -266,32 +6216,21 @@ std::string JsonClassGenerator::GenerateGettersSetters(
       // For nested objects, return reference
       std::string nested_class_name = key + "_type";
 
-      if (lazy_parsing) {
+      if (options_.lazy_parsing) {
         // Lazy parsing version
         ss << Indent(indent_level) << "const " << nested_class_name << "& "
            << key << "() const {\n";
-        ss << Indent(indent_level + 1) << "if (!" << key << "_) {\n";
-        ss << Indent(indent_level + 2) << "if (json_.contains(\"" << key
-           << "\") && json_[\"" << key << "\"].is_object()) {\n";
-        ss << Indent(indent_level + 3) << key << "_->FromJson(json_[\"" << key
-           << "\"]);\n";
-        ss << Indent(indent_level + 2) << "} else {\n";
-        ss << Indent(indent_level + 2) << "}\n";
-        ss << Indent(indent_level + 1) << "}\n";
-        ss << Indent(indent_level + 1) << "return *" << key << "_;\n";
+        ss << GenerateLazyMaterialize(key, value, field_index,
+                                      indent_level + 1);
+        ss << Indent(indent_level + 1) << "return " << member << ";\n";
         ss << Indent(indent_level) << "}\n\n";
 
+        // The object tracks its own modifications
         ss << Indent(indent_level) << nested_class_name << "& " << key
            << "() {\n";
-        ss << Indent(indent_level + 1) << "if (!" << key << "_) {\n";
-        ss << Indent(indent_level + 2) << "if (json_.contains(\"" << key
-           << "\") && json_[\"" << key << "\"].is_object()) {\n";
-        ss << Indent(indent_level + 3) << key << "_->FromJson(json_[\"" << key
-           << "\"]);\n";
-        ss << Indent(indent_level + 2) << "} else {\n";
-        ss << Indent(indent_level + 2) << "}\n";
-        ss << Indent(indent_level + 1) << "}\n";
-        ss << Indent(indent_level + 1) << "return *" << key << "_;\n";
+        ss << GenerateLazyMaterialize(key, value, field_index,
+                                      indent_level + 1);
+        ss << Indent(indent_level + 1) << "return " << member << ";\n";
         ss << Indent(indent_level) << "}\n\n";
       } else {
         ss << Indent(indent_level) << "const " << nested_class_name << "& "
@@ -304,53 +6243,41 @@ std::string JsonClassGenerator::GenerateGettersSetters(
         ss << Indent(indent_level + 1) << "return " << key << "_;\n";
         ss << Indent(indent_level) << "}\n\n";
       }
+    } else if (views) {
+      // Views are only set through the setters, which copy what they point
+      // to, so there is no non-const getter
+      ss << Indent(indent_level)
+         << (value.is_array() ? "const " + type + "& " : type + " ") << key
+         << "() const {\n";
+      ss << GenerateLazyMaterialize(key, value, field_index, indent_level + 1);
+      ss << Indent(indent_level + 1) << "return " << member << ";\n";
+      ss << Indent(indent_level) << "}\n\n";
     } else {
-      if (lazy_parsing) {
+      if (options_.lazy_parsing) {
         ss << Indent(indent_level) << "const " << type << "& " << key
            << "() const {\n";
-        ss << Indent(indent_level + 1) << "if (!" << key << "_) {\n";
-        ss << Indent(indent_level + 2) << "if (json_.contains(\"" << key
-           << "\")) {\n";
-        if (value.is_array()) {
-          ss << Indent(indent_level + 3) << "if (json_[\"" << key
-             << "\"].is_array()) {\n";
-          ss << Indent(indent_level + 4) << key << "_ = json_[\"" << key
-             << "\"].get<" << type << ">();\n";
-          ss << Indent(indent_level + 3) << "} else {\n";
-          ss << Indent(indent_level + 4) << key << "_ = " << type << "{};\n";
-          ss << Indent(indent_level + 3) << "}\n";
-        } else {
-          ss << Indent(indent_level + 3) << key << "_ = json_[\"" << key
-             << "\"].get<" << type << ">();\n";
-        }
-        ss << Indent(indent_level + 2) << "} else {\n";
-        ss << Indent(indent_level + 3) << key << "_ = " << type << "{};\n";
-        ss << Indent(indent_level + 2) << "}\n";
-        ss << Indent(indent_level + 1) << "}\n";
-        ss << Indent(indent_level + 1) << "return *" << key << "_;\n";
+        ss << GenerateLazyMaterialize(key, value, field_index,
+                                      indent_level + 1);
+        ss << Indent(indent_level + 1) << "return " << member << ";\n";
+        ss << Indent(indent_level) << "}\n\n";
+
+        // Reading a field does not modify it, so only this accessor and the
+        // setters mark it to be written instead of copied from the source
+        ss << Indent(indent_level) << type << "& mutable_" << key
+           << "() {\n";
+        ss << GenerateLazyMaterialize(key, value, field_index,
+                                      indent_level + 1);
+        ss << Indent(indent_level + 1) << "lazy_dirty_.set(" << field_index
+           << ");\n";
+        ss << Indent(indent_level + 1) << "return " << member << ";\n";
         ss << Indent(indent_level) << "}\n\n";
 
+        // The old non-const getter stays for existing callers and, like
+        // before, marks the field modified
+        ss << Indent(indent_level) << "[[deprecated(\"use " << key
+           << "() const or mutable_" << key << "()\")]]\n";
         ss << Indent(indent_level) << type << "& " << key << "() {\n";
-        ss << Indent(indent_level + 1) << "if (!" << key << "_) {\n";
-        ss << Indent(indent_level + 2) << "if (json_.contains(\"" << key
-           << "\")) {\n";
-        if (value.is_array()) {
-          ss << Indent(indent_level + 3) << "if (json_[\"" << key
-             << "\"].is_array()) {\n";
-          ss << Indent(indent_level + 4) << key << "_ = json_[\"" << key
-             << "\"].get<" << type << ">();\n";
-          ss << Indent(indent_level + 3) << "} else {\n";
-          ss << Indent(indent_level + 4) << key << "_ = " << type << "{};\n";
-          ss << Indent(indent_level + 3) << "}\n";
-        } else {
-          ss << Indent(indent_level + 3) << key << "_ = json_[\"" << key
-             << "\"].get<" << type << ">();\n";
-        }
-        ss << Indent(indent_level + 2) << "} else {\n";
-        ss << Indent(indent_level + 3) << key << "_ = " << type << "{};\n";
-        ss << Indent(indent_level + 2) << "}\n";
-        ss << Indent(indent_level + 1) << "}\n";
-        ss << Indent(indent_level + 1) << "return *" << key << "_;\n";
+        ss << Indent(indent_level + 1) << "return mutable_" << key << "();\n";
         ss << Indent(indent_level) << "}\n\n";
       } else {
         ss << Indent(indent_level) << "const " << type << "& " << key
@@ -364,79 +6291,373 @@ std::string JsonClassGenerator::GenerateGettersSetters(
       }
     }
 
-    // Setter
-    if (value.is_object()) {
-      std::string nested_class_name = key + "_type";
-      if (lazy_parsing) {
-        ss << Indent(indent_level) << "void set_" << key << "(const "
-           << nested_class_name << "& value) {\n";
-        ss << Indent(indent_level + 1) << key << "_ = value;\n";
-        ss << Indent(indent_level) << "}\n\n";
-      } else {
-        ss << Indent(indent_level) << "void set_" << key << "(const "
-           << nested_class_name << "& value) {\n";
-        ss << Indent(indent_level + 1) << key << "_ = value;\n";
-        ss << Indent(indent_level) << "}\n\n";
-      }
+    // Setters. Strings, containers and nested objects can also be moved in,
+    // and views are copied into the string arena
+    const std::string value_type = value.is_object() ? key + "_type" : type;
+    std::vector<std::pair<std::string, std::string>> setters;
+    if (views) {
+      setters.emplace_back(value.is_array() ? "const " + type + "& value"
+                                            : type + " value",
+                           "lazy_strings_.Store(" +
+                               std::to_string(field_index) + ", value)");
+    } else if (interned) {
+      setters.emplace_back("const " + type + "& value", "value");
+      setters.emplace_back("std::string_view value",
+                           "json2class::InternedString(value)");
     } else {
-      if (lazy_parsing) {
-        ss << Indent(indent_level) << "void set_" << key << "(const " << type
-           << "& value) {\n";
-        ss << Indent(indent_level + 1) << key << "_ = value;\n";
-        ss << Indent(indent_level) << "}\n\n";
-      } else {
-        ss << Indent(indent_level) << "void set_" << key << "(const " << type
-           << "& value) {\n";
-        ss << Indent(indent_level + 1) << key << "_ = value;\n";
-        ss << Indent(indent_level) << "}\n\n";
+      setters.emplace_back("const " + value_type + "& value", "value");
+      if (!value.is_boolean() && !value.is_number() &&
+          (!enumerated || options_.open_enums)) {
+        setters.emplace_back(value_type + "&& value", "std::move(value)");
       }
     }
+    for (const auto& setter : setters) {
+      ss << Indent(indent_level) << "void set_" << key << "(" << setter.first
+         << ") {\n";
+      ss << Indent(indent_level + 1) << key << "_ = " << setter.second
+         << ";\n";
+      if (options_.lazy_parsing) {
+        ss << Indent(indent_level + 1) << "lazy_ready_.set(" << field_index
+           << ");\n";
+        ss << Indent(indent_level + 1) << "lazy_dirty_.set(" << field_index
+           << ");\n";
+      }
+      ss << Indent(indent_level) << "}\n\n";
+    }
   }
 
   return ss.str();
 }
 
-std::string JsonClassGenerator::GetTypeForValue(const json& value) {
+std::string JsonClassGenerator::GetTypeForValue(
+    const json& value,
+    const std::string& element_class,
+    bool owned) {
+  const std::string std_namespace = options_.pmr ? "std::pmr::" : "std::";
+  const std::string owned_string_type = std_namespace + "string";
+  std::string string_type = owned_string_type;
+  if (options_.string_views && !owned) {
+    string_type = "std::string_view";
+  } else if (options_.intern_strings && !owned) {
+    string_type = "json2class::InternedString";
+  }
   if (value.is_string()) {
-    return "std::string";
+    return string_type;
   } else if (value.is_boolean()) {
     return "bool";
   } else if (value.is_number_integer()) {
-    return "int";
-  } else if (value.is_number_unsigned()) {
-    return "unsigned int";
+    return IntegerType(value);
   } else if (value.is_number_float()) {
     return "double";
   } else if (value.is_array()) {
     if (value.empty()) {
-      return "std::vector<std::string>";  // Default to string array
+      // Default to string array
+      return std_namespace + "vector<" + string_type + ">";
     } else {
-      return "std::vector<" + GetTypeForValue(value[0]) + ">";
+      return std_namespace + "vector<" +
+             GetTypeForValue(ElementSample(value), element_class, owned) + ">";
     }
   } else if (value.is_object()) {
-    return "std::map<std::string, std::string>";  // Default to string map
+    if (!element_class.empty()) {
+      return element_class;
+    }
+    // Default to string map
+    return std_namespace + "map<" + owned_string_type + ", " +
+           owned_string_type + ">";
   } else if (value.is_null()) {
-    return "std::string";  // Default to string
+    return string_type;  // Default to string
+  }
+
+  return string_type;  // Default to string
+}
+
+int JsonClassGenerator::GetTypeAlignment(const json& value) {
+  if (value.is_boolean()) {
+    return 1;
+  } else if (value.is_number_integer() && IntegerType(value) == "int") {
+    return 4;
+  }
+  // Strings, containers, doubles, 64-bit integers and nested classes
+  return 8;
+}
+
+JsonClassGenerator::MemberLayout JsonClassGenerator::GetFieldLayout(
+    const std::string& key,
+    const json& value) {
+  MemberLayout layout;
+  NumberType number;
+  const std::vector<std::string> values = GetEnumValues(key, value);
+  if (value.is_object()) {
+    const std::string path = field_path_;
+    field_path_ += NestedPath(key, value);
+    const MemberLayout nested = GetClassLayout(value);
+    field_path_ = path;
+    layout.size = nested.size;
+    layout.alignment = nested.alignment;
+  } else if (!values.empty()) {
+    // Open enums keep the text of unknown values in a std::string
+    layout.size = options_.open_enums ? 40 : EnumWidth(values.size());
+    layout.alignment = options_.open_enums ? 8 : layout.size;
+  } else if (value.is_array()) {
+    layout.size = options_.pmr ? 32 : 24;
+    layout.alignment = 8;
+  } else if (value.is_boolean()) {
+    layout.size = 1;
+    layout.alignment = 1;
+  } else if (value.is_number()) {
+    if (GetNumberType(key, value, number)) {
+      layout.size = Info(number).size;
+    } else {
+      layout.size =
+          value.is_number_integer() && IntegerType(value) == "int" ? 4 : 8;
+    }
+    layout.alignment = layout.size;
+  } else {
+    layout.size = options_.intern_strings ? 16 : options_.pmr ? 40 : 32;
+    layout.alignment = 8;
   }
+  return layout;
+}
+
+JsonClassGenerator::MemberLayout JsonClassGenerator::GetClassLayout(
+    const json& j) {
+  MemberLayout layout;
+  std::string previous;
+  auto pad = [&](std::size_t alignment) {
+    const std::size_t gap = (alignment - layout.size % alignment) % alignment;
+    if (gap != 0) {
+      layout.size += gap;
+      layout.padding += gap;
+      layout.gaps += (layout.gaps.empty() ? "" : ", ") +
+                     std::to_string(gap) + " after " + previous;
+    }
+  };
+  for (const std::string& key : GetMemberOrder(j)) {
+    const MemberLayout member = GetFieldLayout(key, j.at(key));
+    pad(member.alignment);
+    layout.size += member.size;
+    layout.alignment = std::max(layout.alignment, member.alignment);
+    previous = SanitizeIdentifier(key) + "_";
+  }
+  pad(layout.alignment);
+  // Empty classes still take a byte
+  layout.size = std::max<std::size_t>(layout.size, 1);
+  return layout;
+}
+
+std::vector<std::string> JsonClassGenerator::GetMemberOrder(const json& j) {
+  std::vector<std::string> keys;
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    keys.push_back(it.key());
+  }
+  if (!options_.compact_layout) {
+    return keys;
+  }
+
+  // Hot fields first, then by decreasing alignment, so that no padding is
+  // needed within either group
+  std::vector<std::pair<std::pair<bool, std::size_t>, std::string>> order;
+  for (const std::string& key : keys) {
+    order.push_back({{options_.hot_fields.count(field_path_ + key) != 0,
+                      GetFieldLayout(key, j.at(key)).alignment},
+                     key});
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    keys[i] = order[i].second;
+  }
+  return keys;
+}
+
+void JsonClassGenerator::AddLayoutReport(const json& j) {
+  const MemberLayout layout = GetClassLayout(j);
+
+  // The same class with the types of the sample, in sample order
+  const GeneratorOptions options = options_;
+  options_.compact_layout = false;
+  options_.number_types.clear();
+  const std::size_t sample_size = GetClassLayout(j).size;
+  options_ = options;
+
+  std::stringstream ss;
+  ss << "  " << class_scope_ << ": sizeof " << layout.size << " ("
+     << sample_size << " in sample order), padding " << layout.padding;
+  if (!layout.gaps.empty()) {
+    ss << " (" << layout.gaps << ")";
+  }
+  ss << "\n";
+  layout_report_ += ss.str();
+}
+
+bool JsonClassGenerator::GetNumberType(const std::string& key,
+                                       const json& value,
+                                       NumberType& type) {
+  auto it = options_.number_types.find(field_path_ + key);
+  if (it == options_.number_types.end() ||
+      !ObjectElementSample(value).is_number()) {
+    return false;
+  }
+  type = it->second;
+  return true;
+}
+
+int JsonClassGenerator::GetFlatSlotSize(const std::string& key,
+                                        const json& value) {
+  NumberType number;
+  if (value.is_number() && GetNumberType(key, value, number)) {
+    return static_cast<int>(Info(number).size);
+  } else if (value.is_boolean()) {
+    return 1;
+  } else if (value.is_number_integer() && IntegerType(value) == "int") {
+    return 4;
+  } else if (value.is_object()) {
+    // Nested classes are stored as the offset of their table
+    return 4;
+  }
+  // Doubles, 64-bit integers, and strings and containers as an offset and
+  // count
+  return 8;
+}
+
+std::string JsonClassGenerator::ElementClassName(const std::string& key) {
+  return SanitizeIdentifier(key) + "_item_type";
+}
+
+std::string JsonClassGenerator::EnumClassName(const std::string& key) {
+  return SanitizeIdentifier(key) + "_enum";
+}
 
-  return "std::string";  // Default to string
+std::vector<std::string> JsonClassGenerator::GetEnumValues(
+    const std::string& key,
+    const json& value) {
+  auto it = options_.enums.find(field_path_ + key);
+  if (!value.is_string() || it == options_.enums.end()) {
+    return {};
+  }
+  std::vector<std::string> values;
+  for (const std::string& text : it->second) {
+    if (std::find(values.begin(), values.end(), text) == values.end()) {
+      values.push_back(text);
+    }
+  }
+  const std::string& sample = value.get_ref<const std::string&>();
+  if (std::find(values.begin(), values.end(), sample) == values.end()) {
+    values.push_back(sample);
+  }
+  return values;
+}
+
+std::string JsonClassGenerator::GetFieldType(const std::string& key,
+                                             const json& value,
+                                             const std::string& scope,
+                                             bool owned) {
+  NumberType number;
+  if (GetNumberType(key, value, number)) {
+    std::string type = Info(number).type;
+    for (json sample = value; sample.is_array();
+         sample = ElementSample(sample)) {
+      type = (options_.pmr ? "std::pmr::vector<" : "std::vector<") + type +
+             ">";
+    }
+    return type;
+  }
+  if (GetEnumValues(key, value).empty()) {
+    return GetTypeForValue(value, scope + ElementClassName(key), owned);
+  }
+  const std::string enum_name = scope + EnumClassName(key);
+  return options_.open_enums ? "json2class::OpenEnum<" + enum_name + ">"
+                             : enum_name;
+}
+
+std::string JsonClassGenerator::GetFieldDefault(const std::string& key,
+                                                const json& value) {
+  NumberType number;
+  if (GetNumberType(key, value, number)) {
+    return GetDefaultValueString(
+        ConvertNumbers(value, number, field_path_ + key));
+  }
+  const std::vector<std::string> values = GetEnumValues(key, value);
+  if (values.empty()) {
+    return GetDefaultValueString(value);
+  }
+  const std::size_t index =
+      std::find(values.begin(), values.end(),
+                value.get_ref<const std::string&>()) -
+      values.begin();
+  return EnumClassName(key) + "::" +
+         EnumeratorNames(values, options_.open_enums)[index];
+}
+
+std::string JsonClassGenerator::GetFlatTypeCode(const std::string& key,
+                                                const json& value) {
+  NumberType number;
+  if (value.is_boolean()) {
+    return "b";
+  } else if (value.is_number()) {
+    const std::string type = GetNumberType(key, value, number)
+                                 ? Info(number).type
+                             : value.is_number_integer() ? IntegerType(value)
+                                                         : "double";
+    return type == "int" ? "i" : type == "double" ? "d" : type;
+  } else if (value.is_array()) {
+    return "[" +
+           (value.empty() ? std::string("s")
+                          : GetFlatTypeCode(key, ElementSample(value))) +
+           "]";
+  } else if (value.is_object()) {
+    // Element classes have the layout of their own table
+    return GetFlatSchema(value);
+  }
+  return "s";
+}
+
+std::string JsonClassGenerator::GetFlatSchema(const json& j) {
+  std::string schema = "{";
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    const json& value = it.value();
+    schema += std::to_string(it.key().size()) + ":" + it.key() + "=";
+    const std::string path = field_path_;
+    if (ObjectElementSample(value).is_object()) {
+      field_path_ += NestedPath(it.key(), value);
+    }
+    schema += value.is_object() ? GetFlatSchema(value)
+                                : GetFlatTypeCode(it.key(), value);
+    field_path_ = path;
+    schema += ";";
+  }
+  return schema + "}";
 }
 
 std::string JsonClassGenerator::GetDefaultValueString(const json& value) {
-  if (value.is_string()) {
+  if (value.is_string() && options_.intern_strings) {
+    // Defaults refer to their literals instead of being interned
+    return "json2class::InternedString::Literal(\"" +
+           value.get<std::string>() + "\")";
+  } else if (value.is_string()) {
     return "\"" + value.get<std::string>() + "\"";
   } else if (value.is_boolean()) {
     return value.get<bool>() ? "true" : "false";
+  } else if (value.is_number_integer() &&
+             IntegerType(value) == "std::uint64_t") {
+    return std::to_string(value.get<std::uint64_t>()) + "u";
   } else if (value.is_number_integer()) {
-    return std::to_string(value.get<int>());
-  } else if (value.is_number_unsigned()) {
-    return std::to_string(value.get<unsigned int>());
+    const std::int64_t number = value.get<std::int64_t>();
+    if (number == std::numeric_limits<std::int64_t>::min()) {
+      // The literal 9223372036854775808 does not fit in any signed type
+      return std::to_string(number + 1) + " - 1";
+    }
+    return std::to_string(number);
   } else if (value.is_number_float()) {
     return std::to_string(value.get<double>());
   } else if (value.is_array()) {
     if (value.empty()) {
       return "[]";
     }
+    if (ObjectElementSample(value).is_object()) {
+      // Elements of generated classes start out empty
+      return "";
+    }
 
     std::stringstream ss;
 
@@ -455,6 +6676,27 @@ std::string JsonClassGenerator::GetDefaultValueString(const json& value) {
   return "";
 }
 
+std::string JsonClassGenerator::CppStringLiteral(const std::string& text) {
+  std::string literal = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      literal += '\\';
+      literal += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      // Octal escapes cannot swallow the characters that follow them.
+      static const char kOctal[] = "01234567";
+      literal += '\\';
+      literal += kOctal[(c >> 6) & 7];
+      literal += kOctal[(c >> 3) & 7];
+      literal += kOctal[c & 7];
+    } else {
+      literal += c;
+    }
+  }
+  literal += '"';
+  return literal;
+}
+
 std::string JsonClassGenerator::Indent(int level) {
   return std::string(level * 2, ' ');
 }
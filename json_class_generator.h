@@ -5,7 +5,9 @@
 #ifndef JSON_CLASS_GENERATOR_H_
 #define JSON_CLASS_GENERATOR_H_
 
+#include <map>
 #include <nlohmann/json.hpp>
+#include <ostream>
 #include <set>
 #include <string>
 #include <vector>
@@ -15,6 +17,88 @@
 
 using json = nlohmann::json;
 
+// Parsers that generated classes can read from, in addition to nlohmann/json.
+enum class ParserBackend {
+  kNlohmann,
+  // simdjson On-Demand; the generated header includes <simdjson.h>.
+  kSimdjson,
+};
+
+// C++ types that a number field can be stored as.
+enum class NumberType {
+  kInt8,
+  kUInt8,
+  kInt16,
+  kUInt16,
+  kInt32,
+  kUInt32,
+  kInt64,
+  kUInt64,
+  kFloat,
+  kDouble,
+};
+
+// Reads a number type named "int8", "uint8", ..., "uint64", "float" or
+// "double" into |type|.
+// Returns: false if |name| is not one of them.
+bool ParseNumberType(const std::string& name, NumberType& type);
+
+// Options that select what the generator emits for a class.
+struct GeneratorOptions {
+  // Keep the JSON text and parse each field on its first access.
+  bool lazy_parsing = false;
+  // Make the const lazy getters safe to call from several threads at once.
+  // Only used together with |lazy_parsing|.
+  bool thread_safe = false;
+  // Store strings and containers in std::pmr types and add allocator-aware
+  // constructors, so that a caller can choose the memory resource. Only used
+  // without |lazy_parsing|.
+  bool pmr = false;
+  // Also generate FromJson(simdjson::ondemand::value) and ParseFrom for
+  // every class. Only used without |lazy_parsing|.
+  ParserBackend backend = ParserBackend::kNlohmann;
+  // Store strings as std::string_view into the retained source of a lazy
+  // class. Only used together with |lazy_parsing|.
+  bool string_views = false;
+  // String fields stored as generated enums, with the values of each enum.
+  // Fields are named by their path, such as "status", "meta.region" or
+  // "items[].kind" for a field of the elements of an array.
+  std::map<std::string, std::vector<std::string>> enums;
+  // Keep strings that are not values of their enum as kOther together with
+  // their text, instead of rejecting them.
+  bool open_enums = false;
+  // Store strings as json2class::InternedString handles into a shared
+  // json2class::InternPool, so that a value repeated across records is
+  // stored once. Only used without |lazy_parsing| and |pmr|.
+  bool intern_strings = false;
+  // Declare the members of every class hot fields first and then by
+  // alignment, so that they need as little padding as possible, and store
+  // the numbers of |number_types| in their narrower types. Only used without
+  // |lazy_parsing|.
+  bool compact_layout = false;
+  // Types of number fields and of the elements of number arrays, by path
+  // like |enums|. Other numbers keep the type of their sample value. Only
+  // used together with |compact_layout|.
+  std::map<std::string, NumberType> number_types;
+  // Fields declared before all others, by path like |enums|. Only used
+  // together with |compact_layout|.
+  std::set<std::string> hot_fields;
+  // Also generate the static ParseNdjson of the root class, which parses
+  // newline-delimited records on several threads.
+  bool ndjson = false;
+  // Also generate the MessagePack and CBOR codecs of every class. Only used
+  // without |lazy_parsing|.
+  bool binary = false;
+  // Also generate WriteFlat and the View class of every class, and Build for
+  // the root class, for zero-copy flat snapshots.
+  bool flat = false;
+  // Also generate the <class>_columns companion of the root class.
+  bool columns = false;
+  // Also generate FromFile, and with |ndjson| ParseNdjsonFile, which read the
+  // root class from a memory-mapped file.
+  bool mapped_files = false;
+};
+
 // Generates C++ classes from JSON objects with support for serialization
 // and deserialization.
 class JsonClassGenerator {
@@ -25,50 +109,349 @@ class JsonClassGenerator {
   // Generates a C++ class definition from a JSON object.
   // |class_name|: The name of the class to generate.
   // |j|: The JSON object to generate the class from.
-  // |lazy_parsing|: If true, the class will use lazy parsing for JSON
-  // objects.
+  // |options|: Selects the parsing mode and the optional features of the
+  // generated class.
   // Returns: A string containing the C++ class definition.
   std::string GenerateClass(const std::string& class_name,
                             const json& j,
-                            bool lazy_parsing = false);
+                            const GeneratorOptions& options = {});
+
+  // Writes the size, alignment and padding of every class generated by the
+  // last GenerateClass call in compact_layout mode, as laid out on a 64-bit
+  // target with libstdc++.
+  void ReportLayout(std::ostream& out) const;
 
  private:
   // Generates the content of a class (member variables and nested classes).
   std::string GenerateClassContent(const std::string& class_name,
                                    const json& j,
-                                   int indent_level = 0,
-                                   bool lazy_parsing = false);
+                                   int indent_level = 0);
+
+  // Generates a nested class for an object field or, if |element| is set, the
+  // element class of an array of objects.
+  std::string GenerateNestedClass(const std::string& nested_class_name,
+                                  const json& value,
+                                  bool element,
+                                  int indent_level = 0);
+
+  // Generates the default, copy and move constructors, assignments and the
+  // destructor of a class.
+  std::string GenerateSpecialMembers(const std::string& class_name,
+                                     int indent_level = 0);
+
+  // How the body of a generated FromJson reads the fields of |j|.
+  enum class ReadMode {
+    kAssign,   // Fields are assigned in place, reusing their memory.
+    kMasked,   // As kAssign, for the fields in the FieldMask |mask| only.
+    kMoved,    // Strings and containers are moved out of |j|.
+    kReparse,  // As kAssign, and fields missing from |j| are reset.
+  };
 
   // Generates the implementation of the FromJson method.
   std::string GenerateFromJsonMethod(const std::string& class_name,
                                      const json& j,
                                      int indent_level = 0,
-                                     bool lazy_parsing = false);
+                                     ReadMode mode = ReadMode::kAssign);
+
+  // Generates Clear, which resets every field to its default value without
+  // releasing the memory of strings and containers.
+  std::string GenerateClearMethod(const json& j, int indent_level);
+
+  // Returns the statement that resets the field |key| with the sample value
+  // |value| to its default.
+  std::string GenerateFieldReset(const std::string& key, const json& value);
 
   // Generates the implementation of the ToJson method.
   std::string GenerateToJsonMethod(const std::string& class_name,
                                    const json& j,
-                                   int indent_level = 0,
-                                   bool lazy_parsing = false);
+                                   int indent_level = 0);
+
+  // Generates WriteJson and the ToJsonString overloads, which write JSON text
+  // directly into a string or a caller-provided buffer.
+  std::string GenerateToJsonStringMethods(const json& j, int indent_level = 0);
+
+  // Returns the sinks and value writers used by the generated WriteJson.
+  std::string GenerateJsonWriterSupport();
+
+  // Generates the static FieldIndex function, which maps an object key to the
+  // index of its field through a perfect hash computed at generation time.
+  std::string GenerateFieldIndexMethod(const json& j, int indent_level = 0);
+
+  // Returns the hash functions shared by all generated FieldIndex tables.
+  std::string GenerateKeyHashSupport();
+
+  // Generates the Field enum and FieldMask type of a root class, and the
+  // FromJson and FromJsonString overloads that parse only the masked fields.
+  std::string GenerateFieldMaskMethods(const json& j, int indent_level = 0);
+
+  // Generates the perfect hash tables |names| and |values| over |keys|, and
+  // the statements that compute the slot of |key_name| in them.
+  std::string GenerateKeyTable(const std::vector<std::string>& keys,
+                               const std::string& names,
+                               const std::string& values,
+                               const std::string& key_name,
+                               int indent_level);
+
+  // Generates the enum of the field |key| with the values |values|, and its
+  // ToString, FromString and json conversions.
+  std::string GenerateEnum(const std::string& key,
+                           const std::vector<std::string>& values,
+                           int indent_level);
+
+  // Returns the enum support: json2class::OpenEnum and the readers of enum
+  // fields.
+  std::string GenerateEnumSupport();
+
+  // Returns json2class::InternedString, the sharded json2class::InternPool
+  // and the scope that selects the pool of a thread.
+  std::string GenerateInternSupport();
+
+  // Generates the overloads of a root class that intern its strings into a
+  // given pool.
+  std::string GenerateInternMethods(const std::string& class_name,
+                                    int indent_level = 0);
+
+  // Returns the structural JSON scanner and the FieldMask template.
+  std::string GenerateJsonScanSupport();
+
+  // Generates the FromJsonString/FromJsonStream entry points and the SaxMember
+  // dispatcher that let a class be filled straight from JSON text.
+  std::string GenerateSaxMethods(const std::string& class_name,
+                                 const json& j,
+                                 int indent_level = 0);
+
+  // Returns the readers behind the simdjson On-Demand methods.
+  std::string GenerateSimdjsonSupport();
+
+  // Generates FromJson(simdjson::ondemand::value) and ParseFrom, which read
+  // a document through simdjson On-Demand and return a
+  // json2class::ParseStatus like TryFromJson.
+  std::string GenerateSimdjsonMethods(const json& j, int indent_level);
+
+  // Returns the support code shared by all generated SAX parsers.
+  std::string GenerateSaxSupport();
+
+  // Returns the readers that assign a json value into an existing member for
+  // FromJson(const json&), and the ones that move strings and containers out
+  // of it for FromJson(json&&).
+  std::string GenerateReaderSupport();
+
+  // Generates TryFromJson and TryFromJsonString, which check the type of
+  // every value before converting it and report the first mismatch in a
+  // json2class::ParseStatus instead of throwing.
+  std::string GenerateTryMethods(const json& j, int indent_level = 0);
+
+  // Returns the exception macros, json2class::ParseStatus and the checked
+  // readers used by TryFromJson.
+  std::string GenerateStatusSupport();
+
+  // Generates a Stream<Field> pair for every array field of a root class,
+  // which parse the document and hand the array elements to a callback one
+  // at a time instead of storing them.
+  std::string GenerateStreamMethods(const json& j, int indent_level = 0);
+
+  // Generates the MessagePack and CBOR codecs of a class, which encode and
+  // decode the members directly without a json value in between.
+  std::string GenerateBinaryMethods(const json& j, int indent_level = 0);
+
+  // Returns the readers, writers and value codecs shared by the generated
+  // MessagePack and CBOR methods.
+  std::string GenerateBinarySupport();
+
+  // Generates the static ParseNdjson function of a root class, which parses
+  // newline-delimited records on several threads.
+  std::string GenerateNdjsonMethod(const std::string& class_name,
+                                   int indent_level = 0);
+
+  // Returns the chunking and thread pool code of the NDJSON batch readers.
+  std::string GenerateNdjsonSupport();
+
+  // Generates FromFile and ParseNdjsonFile, which read a root class from a
+  // memory-mapped file.
+  std::string GenerateFileMethods(const std::string& class_name,
+                                  int indent_level = 0);
+
+  // Returns the read-only file mapping used by the generated file readers.
+  std::string GenerateMappedFileSupport();
+
+  // Generates WriteFlat, which writes a class into a flat snapshot, and for a
+  // root class the schema fingerprint and Build.
+  std::string GenerateFlatMethods(const json& j,
+                                  bool root,
+                                  int indent_level = 0);
+
+  // Generates the View class, which reads the fields of a class in place from
+  // a flat snapshot. Root views are opened with View::Open.
+  std::string GenerateFlatView(const json& j, bool root, int indent_level = 0);
+
+  // Returns the builder, views and layout traits of flat snapshots.
+  std::string GenerateFlatSupport();
+
+  // A column of the companion columns class: one leaf field of the root
+  // object, with nested objects flattened into their fields.
+  struct ColumnField {
+    std::string name;         // Column name, e.g. "scores_Math".
+    std::string type;         // C++ type of the column values.
+    std::string member_type;  // C++ type of the field; differs from |type|
+                              // for arrays of string views.
+    std::string parent;       // Getter path of the enclosing object, e.g.
+                              // "scores().".
+    std::string key;          // Key of the field in the enclosing object.
+    bool is_string;
+  };
+
+  // Appends the columns of the fields of |j| to |fields|. |scope| qualifies
+  // the names of the element classes declared in |j|.
+  void CollectColumnFields(const json& j,
+                           const std::string& prefix,
+                           const std::string& parent,
+                           const std::string& scope,
+                           std::vector<ColumnField>& fields);
+
+  // Generates the <class_name>_columns class, which stores many records of a
+  // root class as one column per leaf field.
+  std::string GenerateColumnsClass(const std::string& class_name,
+                                   const json& j);
+
+  // Returns the column containers used by the generated columns classes.
+  std::string GenerateColumnsSupport();
+
+  // Generates the text entry points of a lazy class. They keep the source
+  // buffer and record where each field's value is, without parsing it.
+  std::string GenerateLazyIndexMethods(int indent_level = 0);
+
+  // Generates the block that parses a lazy field from the retained source
+  // the first time it is accessed.
+  std::string GenerateLazyMaterialize(const std::string& key,
+                                      const json& value,
+                                      int field_index,
+                                      int indent_level = 0);
+
+  // Returns the structural scanner shared by all generated lazy classes.
+  std::string GenerateLazyIndexSupport();
+
+  // Returns the atomic bitmask and lock pool used by thread-safe lazy getters.
+  std::string GenerateLazySyncSupport();
+
+  // Generates the allocator-aware constructors and FromJson overload of a
+  // class with std::pmr members.
+  std::string GeneratePmrMethods(const std::string& class_name,
+                                 const json& j,
+                                 int indent_level = 0);
+
+  // Returns the readers and SAX bindings for std::pmr members.
+  std::string GeneratePmrSupport();
 
   // Generates getter and setter methods for class members.
   std::string GenerateGettersSetters(const std::string& class_name,
                                      const json& j,
-                                     int indent_level = 0,
-                                     bool lazy_parsing = false);
+                                     int indent_level = 0);
+
+  // Returns the C++ type corresponding to a JSON value. Objects inside
+  // arrays become |element_class|, or a string map if it is empty. Strings
+  // are std::string_view in string_views mode and json2class::InternedString
+  // in intern_strings mode unless |owned| is set.
+  std::string GetTypeForValue(const json& value,
+                              const std::string& element_class = "",
+                              bool owned = false);
+
+  // Returns the values of the enum of the field |key| of the class being
+  // generated, or nothing if the field is not an enum. The sample value is
+  // always one of them.
+  std::vector<std::string> GetEnumValues(const std::string& key,
+                                         const json& value);
 
-  // Returns the C++ type corresponding to a JSON value.
-  std::string GetTypeForValue(const json& value);
+  // Returns the C++ type of the field |key|: its enum, or the type of
+  // |value|. |scope| qualifies the names of the classes and enums declared
+  // for it.
+  std::string GetFieldType(const std::string& key,
+                           const json& value,
+                           const std::string& scope = "",
+                           bool owned = false);
+
+  // Returns the default value of the field |key|.
+  std::string GetFieldDefault(const std::string& key, const json& value);
+
+  // Returns the name of the element class of an array of objects.
+  std::string ElementClassName(const std::string& key);
+
+  // Returns the name of the enum of a string field.
+  std::string EnumClassName(const std::string& key);
+
+  // Returns the alignment in bytes of the C++ type of a JSON value on a 64-bit
+  // target. Used to order members so that they need no padding.
+  int GetTypeAlignment(const json& value);
+
+  // Size and alignment in bytes of a member on a 64-bit target with
+  // libstdc++, and for a class the padding between and after its members.
+  struct MemberLayout {
+    std::size_t size = 0;
+    std::size_t alignment = 1;
+    std::size_t padding = 0;
+    std::string gaps;  // Where the padding is, e.g. "3 after active_".
+  };
+
+  // Returns the layout of the member for the field |key|.
+  MemberLayout GetFieldLayout(const std::string& key, const json& value);
+
+  // Returns the layout of a class with the fields of |j|, declared in the
+  // order of GetMemberOrder.
+  MemberLayout GetClassLayout(const json& j);
+
+  // Returns the keys of |j| in the order in which their members are
+  // declared: the order of the sample, or in compact_layout mode hot fields
+  // first and then by decreasing alignment.
+  std::vector<std::string> GetMemberOrder(const json& j);
+
+  // Appends the layout of the class being generated, with the fields of |j|,
+  // to the layout report.
+  void AddLayoutReport(const json& j);
+
+  // Reads the type of the number field |key| from number_types into |type|.
+  // Returns: false if the field is not a number or an array of numbers, or
+  // has no type in number_types.
+  bool GetNumberType(const std::string& key,
+                     const json& value,
+                     NumberType& type);
+
+  // Returns the width in bytes of the slot of the field |key| in a flat
+  // snapshot table.
+  int GetFlatSlotSize(const std::string& key, const json& value);
+
+  // Returns the layout code of the non-class member |key| in a flat snapshot.
+  // std and std::pmr members share one layout.
+  std::string GetFlatTypeCode(const std::string& key, const json& value);
+
+  // Returns a description of the flat snapshot layout of |j|. Its hash is the
+  // schema fingerprint of a root class.
+  std::string GetFlatSchema(const json& j);
 
   // Returns a string representation of the default value for a JSON value.
   std::string GetDefaultValueString(const json& value);
 
+  // Returns |text| as a C++ string literal, including the quotes.
+  std::string CppStringLiteral(const std::string& text);
+
   // Returns a string with the specified number of spaces for indentation.
   std::string Indent(int level);
 
   // Checks if a string is a valid C++ identifier.
   std::string SanitizeIdentifier(const std::string& identifier);
 
+  // Options of the class that is currently being generated.
+  GeneratorOptions options_;
+
+  // Path of the object whose fields are being generated, such as "meta." or
+  // "items[].". Empty for the root class.
+  std::string field_path_;
+
+  // Qualified name of the class being generated, such as
+  // "person::scores_type".
+  std::string class_scope_;
+
+  // Layout of the generated classes in compact_layout mode.
+  std::string layout_report_;
+
   // Set of class names that have already been generated.
   std::set<std::string> generated_classes_;
 };
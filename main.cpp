@@ -2,14 +2,20 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 #include "json_class_generator.h"
+#include "mapped_file.h"
+#include "schema_inference.h"
 
 using json = nlohmann::json;
 
@@ -19,6 +25,184 @@ void printUsage(const char* programName) {
             << std::endl;
   std::cout << "Options:" << std::endl;
   std::cout << "  --lazy-parsing    启用延迟解析模式" << std::endl;
+  std::cout << "  --thread-safe     生成可被多线程并发读取的延迟解析类"
+               "（隐含 --lazy-parsing）"
+            << std::endl;
+  std::cout << "  --string-view     字符串字段使用指向保留输入缓冲区的 "
+               "std::string_view（隐含 --lazy-parsing）"
+            << std::endl;
+  std::cout << "  --pmr             生成使用 std::pmr 容器和分配器的类"
+               "（不能与 --lazy-parsing 同时使用）"
+            << std::endl;
+  std::cout << "  --intern          字符串字段使用共享字符串池中的 "
+               "json2class::InternedString（不能与 --lazy-parsing 或 --pmr "
+               "同时使用）"
+            << std::endl;
+  std::cout << "  --corpus <name>   从 NDJSON 文件或目录中的全部样本推断类型，"
+               "生成名为 <name> 的类"
+            << std::endl;
+  std::cout << "  --backend=simdjson  额外生成基于 simdjson On-Demand 的解析方法"
+               "（不能与 --lazy-parsing 同时使用）"
+            << std::endl;
+  std::cout << "  --enums[=N]       将语料中取值不超过 N 种（默认 16）的字符串字段"
+               "生成为枚举（需要 --corpus）"
+            << std::endl;
+  std::cout << "  --enum <path>=v1,v2,...  将指定字段生成为枚举，例如 "
+               "meta.region=eu,us 或 items[].kind=a,b"
+            << std::endl;
+  std::cout << "  --enum-unknown=reject|other  枚举之外的字符串：报错（默认），"
+               "或保存为 kOther 并保留原文"
+            << std::endl;
+  std::cout << "  --compact-layout  按对齐方式（热点字段优先）排列成员以减少填充，"
+               "并输出每个类的大小和填充（不能与 --lazy-parsing 同时使用）"
+            << std::endl;
+  std::cout << "  --type <path>=<type>  指定数字字段的类型：int8、uint8、int16、"
+               "uint16、int32、uint32、int64、uint64、float 或 double"
+               "（需要 --compact-layout）"
+            << std::endl;
+  std::cout << "  --hot <path>,...  最先声明的热点字段（需要 --compact-layout）"
+            << std::endl;
+  std::cout << "  --ndjson          生成多线程解析 NDJSON 的 ParseNdjson"
+            << std::endl;
+  std::cout << "  --binary          生成 MessagePack 和 CBOR 编解码方法"
+               "（不能与 --lazy-parsing 同时使用）"
+            << std::endl;
+  std::cout << "  --flat            生成零拷贝平面快照的 Build、WriteFlat 和 View"
+            << std::endl;
+  std::cout << "  --columns         生成列式存储的 <class>_columns 伴随类"
+            << std::endl;
+  std::cout << "  --mmap            生成通过内存映射读取文件的 FromFile"
+               "（与 --ndjson 一起时还有 ParseNdjsonFile）"
+            << std::endl;
+}
+
+// Adds the number type given as "<path>=<type>" to |options|.
+bool ParseTypeOption(const std::string& spec, GeneratorOptions& options) {
+  const std::size_t equals = spec.find('=');
+  NumberType type;
+  if (equals == std::string::npos || equals == 0 ||
+      !ParseNumberType(spec.substr(equals + 1), type)) {
+    std::cerr << "Invalid type, expected <path>=int8|uint8|int16|uint16|"
+                 "int32|uint32|int64|uint64|float|double: "
+              << spec << std::endl;
+    return false;
+  }
+  options.number_types[spec.substr(0, equals)] = type;
+  return true;
+}
+
+// Adds the enum given as "<path>=v1,v2,..." to |options|.
+bool ParseEnumOption(const std::string& spec, GeneratorOptions& options) {
+  const std::size_t equals = spec.find('=');
+  if (equals == std::string::npos || equals == 0) {
+    std::cerr << "Invalid enum, expected <path>=v1,v2,...: " << spec
+              << std::endl;
+    return false;
+  }
+  std::vector<std::string>& values = options.enums[spec.substr(0, equals)];
+  std::size_t begin = equals + 1;
+  std::size_t comma;
+  while ((comma = spec.find(',', begin)) != std::string::npos) {
+    values.push_back(spec.substr(begin, comma - begin));
+    begin = comma + 1;
+  }
+  values.push_back(spec.substr(begin));
+  return true;
+}
+
+// Adds the fields given as "<path>,<path>,..." to the hot fields of
+// |options|.
+void ParseHotOption(const std::string& spec, GeneratorOptions& options) {
+  std::size_t begin = 0;
+  std::size_t comma;
+  while ((comma = spec.find(',', begin)) != std::string::npos) {
+    options.hot_fields.insert(spec.substr(begin, comma - begin));
+    begin = comma + 1;
+  }
+  options.hot_fields.insert(spec.substr(begin));
+}
+
+// Reads the sample file: the class name on the first line (format:
+// #className), followed by the JSON content.
+bool ReadSample(const std::string& file_path,
+                std::string& class_name,
+                json& j) {
+  // The sample is parsed straight from the mapped file
+  json2class::MappedFile file;
+  if (!file.Open(file_path)) {
+    std::cerr << "Unable to open file: " << file_path << std::endl;
+    return false;
+  }
+
+  std::string_view json_content = file.data();
+
+  // Read the first line to get the class name (format: #className)
+  const std::size_t line_end =
+      std::min(json_content.find('\n'), json_content.size());
+  std::string_view line = json_content.substr(0, line_end);
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  if (line.size() > 1 && line[0] == '#') {
+    class_name = std::string(line.substr(1));
+  }
+
+  // The remaining text is the JSON content
+  json_content.remove_prefix(std::min(line_end + 1, json_content.size()));
+
+  if (class_name.empty()) {
+    std::cerr << "Class name not found. Please ensure the JSON file's first "
+                 "line contains a class name in the format #className"
+              << std::endl;
+    return false;
+  }
+
+  j = json::parse(json_content.begin(), json_content.end());
+  return true;
+}
+
+// Merges the types of every document of the corpus at |corpus_path|. String
+// fields with at most |max_enum_values| values become enums of |options|,
+// unless |max_enum_values| is 0. In compact_layout mode, number fields get
+// the narrowest type that holds all their values.
+bool InferSample(const std::string& corpus_path,
+                 std::size_t max_enum_values,
+                 GeneratorOptions& options,
+                 json& j) {
+  SchemaInference schema;
+  if (!InferCorpus(corpus_path, std::thread::hardware_concurrency(),
+                   schema)) {
+    std::cerr << "Unable to read corpus: " << corpus_path << std::endl;
+    return false;
+  }
+  std::cout << "Inferred schema from " << schema.documents()
+            << " documents (" << schema.malformed()
+            << " malformed skipped):" << std::endl;
+  schema.Report(std::cout);
+  j = schema.Sample();
+  if (max_enum_values != 0) {
+    for (auto& inferred : schema.Enums(max_enum_values)) {
+      std::cout << "  enum " << inferred.first << ":";
+      for (const std::string& value : inferred.second) {
+        std::cout << " " << json(value).dump();
+      }
+      std::cout << std::endl;
+      // Enums given on the command line win
+      options.enums.insert(std::move(inferred));
+    }
+  }
+  if (options.compact_layout) {
+    for (const auto& inferred : schema.NumberTypes()) {
+      std::cout << "  type " << inferred.first << ": " << inferred.second
+                << std::endl;
+      // Types given on the command line win
+      NumberType type;
+      if (ParseNumberType(inferred.second, type)) {
+        options.number_types.insert({inferred.first, type});
+      }
+    }
+  }
+  return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -28,55 +212,136 @@ int main(int argc, char* argv[]) {
   }
 
   std::string file_path = argv[1];
-  bool lazy_parsing = false;
+  std::string class_name;
+  bool corpus = false;
+  std::string backend = "nlohmann";
+  std::size_t max_enum_values = 0;
+  std::string enum_unknown = "reject";
+  GeneratorOptions options;
 
   // Parse command-line arguments
   for (int i = 2; i < argc; ++i) {
     std::string arg = argv[i];
     if (arg == "--lazy-parsing" || arg == "-l") {
-      lazy_parsing = true;
+      options.lazy_parsing = true;
+    } else if (arg == "--thread-safe" || arg == "-t") {
+      options.lazy_parsing = true;
+      options.thread_safe = true;
+    } else if (arg == "--string-view" || arg == "-s") {
+      options.lazy_parsing = true;
+      options.string_views = true;
+    } else if (arg == "--pmr" || arg == "-p") {
+      options.pmr = true;
+    } else if (arg == "--intern" || arg == "-i") {
+      options.intern_strings = true;
+    } else if ((arg == "--corpus" || arg == "-c") && i + 1 < argc) {
+      corpus = true;
+      class_name = argv[++i];
+    } else if (arg == "--backend" && i + 1 < argc) {
+      backend = argv[++i];
+    } else if (arg.rfind("--backend=", 0) == 0) {
+      backend = arg.substr(10);
+    } else if (arg == "--enums") {
+      max_enum_values = 16;
+    } else if (arg.rfind("--enums=", 0) == 0) {
+      max_enum_values = std::strtoul(arg.c_str() + 8, nullptr, 10);
+    } else if (arg == "--enum" && i + 1 < argc) {
+      if (!ParseEnumOption(argv[++i], options)) {
+        return 1;
+      }
+    } else if (arg.rfind("--enum-unknown=", 0) == 0) {
+      enum_unknown = arg.substr(15);
+    } else if (arg == "--compact-layout") {
+      options.compact_layout = true;
+    } else if (arg == "--type" && i + 1 < argc) {
+      if (!ParseTypeOption(argv[++i], options)) {
+        return 1;
+      }
+    } else if (arg == "--hot" && i + 1 < argc) {
+      ParseHotOption(argv[++i], options);
+    } else if (arg == "--ndjson") {
+      options.ndjson = true;
+    } else if (arg == "--binary") {
+      options.binary = true;
+    } else if (arg == "--flat") {
+      options.flat = true;
+    } else if (arg == "--columns") {
+      options.columns = true;
+    } else if (arg == "--mmap") {
+      options.mapped_files = true;
     }
   }
 
-  std::ifstream file(file_path);
-
-  if (!file.is_open()) {
-    std::cerr << "Unable to open file: " << file_path << std::endl;
+  if (enum_unknown == "other") {
+    options.open_enums = true;
+  } else if (enum_unknown != "reject") {
+    std::cerr << "Unknown --enum-unknown policy: " << enum_unknown
+              << std::endl;
     return 1;
   }
-
-  std::string json_content;
-  std::string line;
-  std::string class_name;
-
-  // Read the first line to get the class name (format: #className)
-  if (std::getline(file, line)) {
-    if (line.size() > 1 && line[0] == '#') {
-      class_name = line.substr(1);
-    }
+  if (max_enum_values != 0 && !corpus) {
+    std::cerr << "--enums requires --corpus" << std::endl;
+    return 1;
   }
 
-  // Read the remaining JSON content
-  while (std::getline(file, line)) {
-    json_content += line;
+  if (backend == "simdjson") {
+    options.backend = ParserBackend::kSimdjson;
+  } else if (backend != "nlohmann") {
+    std::cerr << "Unknown backend: " << backend << std::endl;
+    return 1;
   }
 
-  if (class_name.empty()) {
-    std::cerr << "Class name not found. Please ensure the JSON file's first "
-                 "line contains a class name in the format #className"
+  if (options.pmr && options.lazy_parsing) {
+    std::cerr << "--pmr cannot be combined with --lazy-parsing" << std::endl;
+    return 1;
+  }
+  if (options.intern_strings && (options.lazy_parsing || options.pmr)) {
+    std::cerr << "--intern cannot be combined with --lazy-parsing or --pmr"
+              << std::endl;
+    return 1;
+  }
+  if (options.compact_layout && options.lazy_parsing) {
+    std::cerr << "--compact-layout cannot be combined with --lazy-parsing"
+              << std::endl;
+    return 1;
+  }
+  if (!options.compact_layout &&
+      (!options.number_types.empty() || !options.hot_fields.empty())) {
+    std::cerr << "--type and --hot require --compact-layout" << std::endl;
+    return 1;
+  }
+  if (options.binary && options.lazy_parsing) {
+    std::cerr << "--binary cannot be combined with --lazy-parsing" << std::endl;
+    return 1;
+  }
+  if (options.backend == ParserBackend::kSimdjson && options.lazy_parsing) {
+    std::cerr << "--backend=simdjson cannot be combined with --lazy-parsing"
               << std::endl;
     return 1;
   }
 
   try {
-    json j = json::parse(json_content);
+    json j;
+    if (corpus ? !InferSample(file_path, max_enum_values, options, j)
+               : !ReadSample(file_path, class_name, j)) {
+      return 1;
+    }
     JsonClassGenerator generator;
-    std::string cpp_class =
-        generator.GenerateClass(class_name, j, lazy_parsing);
+    std::string cpp_class = generator.GenerateClass(class_name, j, options);
 
     std::cout << "Generation mode: "
-              << (lazy_parsing ? "Lazy parsing" : "Direct parsing")
+              << (options.lazy_parsing ? "Lazy parsing" : "Direct parsing")
+              << (options.thread_safe ? " (thread-safe)" : "")
+              << (options.string_views ? " (string_view)" : "")
+              << (options.pmr ? " (pmr)" : "")
+              << (options.intern_strings ? " (interned)" : "")
+              << (options.compact_layout ? " (compact layout)" : "")
+              << (options.backend == ParserBackend::kSimdjson ? " (simdjson)"
+                                                              : "")
               << std::endl;
+    if (options.compact_layout) {
+      generator.ReportLayout(std::cout);
+    }
 
     // Output the generated C++ class
     std::cout << cpp_class << std::endl;
@@ -0,0 +1,156 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The generated headers embed this file from the #ifndef below, so json2class
+// and the classes it generates share one implementation.
+
+#ifndef JSON2CLASS_MAPPED_FILE_
+#define JSON2CLASS_MAPPED_FILE_
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace json2class {
+
+// A read-only memory mapping of a whole file, so that it can be parsed
+// without copying it into a std::string first.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // Maps the file at |path|, replacing any previous mapping.
+  // Returns: false if the file cannot be opened or mapped; error() tells why.
+  bool Open(const std::string& path) {
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+      return Fail(GetLastError());
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+      const DWORD error = GetLastError();
+      CloseHandle(file);
+      return Fail(error);
+    }
+    if (size.QuadPart == 0) {
+      CloseHandle(file);
+      return true;
+    }
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const DWORD error = GetLastError();
+    CloseHandle(file);
+    if (mapping == nullptr) {
+      return Fail(error);
+    }
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+      const DWORD view_error = GetLastError();
+      CloseHandle(mapping);
+      return Fail(view_error);
+    }
+    mapping_ = mapping;
+    data_ = static_cast<const char*>(data);
+    size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return Fail(errno);
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+      const int error = errno;
+      close(fd);
+      return Fail(error);
+    }
+    if (!S_ISREG(status.st_mode)) {
+      close(fd);
+      return Fail(S_ISDIR(status.st_mode) ? EISDIR : EINVAL);
+    }
+    if (status.st_size == 0) {
+      close(fd);
+      return true;
+    }
+    const std::size_t size = static_cast<std::size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int error = errno;
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    if (data == MAP_FAILED) {
+      return Fail(error);
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(data);
+    size_ = size;
+#endif
+    return true;
+  }
+
+  // Unmaps the file.
+  void Close() {
+    if (data_ != nullptr) {
+#ifdef _WIN32
+      UnmapViewOfFile(data_);
+      CloseHandle(mapping_);
+      mapping_ = nullptr;
+#else
+      munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    error_.clear();
+  }
+
+  // Returns the contents of the file. Empty files have an empty view.
+  std::string_view data() const { return std::string_view(data_, size_); }
+
+  // Returns why the last Open failed.
+  std::error_code error() const { return error_; }
+
+ private:
+#ifdef _WIN32
+  bool Fail(DWORD error) {
+    error_.assign(static_cast<int>(error), std::system_category());
+    return false;
+  }
+#else
+  bool Fail(int error) {
+    error_.assign(error, std::generic_category());
+    return false;
+  }
+#endif
+
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::error_code error_;
+#ifdef _WIN32
+  HANDLE mapping_ = nullptr;
+#endif
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_MAPPED_FILE_
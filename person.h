@@ -5,41 +5,1364 @@
 #include <vector>
 #include <map>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 using json = nlohmann::json;
 
+#ifndef JSON2CLASS_STATUS_
+#define JSON2CLASS_STATUS_
+
+// Like nlohmann::json, errors abort instead of throwing when exceptions are
+// disabled or JSON_NOEXCEPTION is defined. TryFromJson never needs them.
+#if (defined(__cpp_exceptions) || defined(__EXCEPTIONS) || \
+     defined(_CPPUNWIND)) &&                                \
+    !defined(JSON_NOEXCEPTION)
+#define JSON2CLASS_EXCEPTIONS 1
+#define JSON2CLASS_THROW(exception) throw exception
+#else
+#define JSON2CLASS_EXCEPTIONS 0
+#define JSON2CLASS_THROW(exception) \
+  (static_cast<void>(exception), std::abort())
+#endif
+
+namespace json2class {
+
+// Reports a value that cannot be stored in its member with the
+// json::type_error that json::get throws for values of the wrong type, so
+// callers such as ParseNdjson treat it as bad input.
+[[noreturn]] inline void ThrowTypeError(const std::string& message) {
+  JSON2CLASS_THROW(json::type_error::create(302, message, nullptr));
+}
+
+enum class StatusCode : std::uint8_t {
+  kOk,
+  kSyntaxError,   // The text is not valid JSON.
+  kTypeError,     // A value cannot be stored in its member.
+  kUnknownValue,  // A string is not one of the values of its enum.
+};
+
+// Result of TryFromJson. |path| is the JSON pointer of the rejected value,
+// such as "/items/2/name", and stays empty on success and for syntax errors.
+struct ParseStatus {
+  StatusCode code = StatusCode::kOk;
+  std::string path;
+
+  bool ok() const { return code == StatusCode::kOk; }
+  explicit operator bool() const { return ok(); }
+};
+
+// Adds the key or index of an enclosing value in front of |status.path|.
+inline void PrependPath(ParseStatus& status, std::string_view token) {
+  std::string segment = "/";
+  for (char c : token) {
+    segment += c == '~' ? "~0" : c == '/' ? "~1" : std::string(1, c);
+  }
+  status.path.insert(0, segment);
+}
+
+inline bool TypeError(ParseStatus& status) {
+  status.code = StatusCode::kTypeError;
+  return false;
+}
+
+// Stores |number| in |value| if the type of |value| can hold it. Integer
+// members take integers inside their range and doubles without a fraction,
+// float members take doubles inside the float range.
+template <typename T, typename N>
+bool NarrowNumber(N number, T& value) {
+  using Limits = std::numeric_limits<T>;
+  if constexpr (std::is_floating_point_v<T>) {
+    if constexpr (std::is_floating_point_v<N> && sizeof(T) < sizeof(N)) {
+      if (number < -static_cast<N>(Limits::max()) ||
+          number > static_cast<N>(Limits::max())) {
+        return false;
+      }
+    }
+  } else if constexpr (std::is_floating_point_v<N>) {
+    // 2^digits is exact as a double, unlike the largest value of T
+    const N limit = static_cast<N>(Limits::max() / 2 + 1) * 2;
+    if (!(number >= static_cast<N>(Limits::min()) && number < limit) ||
+        static_cast<N>(static_cast<T>(number)) != number) {
+      return false;
+    }
+  } else if constexpr (std::is_signed_v<N>) {
+    if (number < 0 ? !std::is_signed_v<T> ||
+                         static_cast<std::intmax_t>(number) <
+                             static_cast<std::intmax_t>(Limits::min())
+                   : static_cast<std::uintmax_t>(number) >
+                         static_cast<std::uintmax_t>(Limits::max())) {
+      return false;
+    }
+  } else if (static_cast<std::uintmax_t>(number) >
+             static_cast<std::uintmax_t>(Limits::max())) {
+    return false;
+  }
+  value = static_cast<T>(number);
+  return true;
+}
+
+// Converts a number or boolean like json::get, but rejects numbers that do
+// not fit |value| instead of wrapping or truncating them.
+template <typename T>
+bool ConvertNumber(const json& j, T& value) {
+  if (j.is_boolean()) {
+    value = static_cast<T>(*j.get_ptr<const bool*>());
+    return true;
+  }
+  if constexpr (!std::is_same_v<T, bool>) {
+    if (j.is_number_unsigned()) {
+      return NarrowNumber(*j.get_ptr<const json::number_unsigned_t*>(), value);
+    }
+    if (j.is_number_integer()) {
+      return NarrowNumber(*j.get_ptr<const json::number_integer_t*>(), value);
+    }
+    if (j.is_number_float()) {
+      return NarrowNumber(*j.get_ptr<const json::number_float_t*>(), value);
+    }
+  }
+  return false;
+}
+
+// The throwing form of ConvertNumber behind FromJson.
+template <typename T>
+void ReadNumber(const json& j, T& value) {
+  if (std::is_same_v<T, bool> || (!j.is_number() && !j.is_boolean())) {
+    j.get_to(value);
+    return;
+  }
+  if (!ConvertNumber(j, value)) {
+    ThrowTypeError("json2class: " + j.dump() + " does not fit a " +
+                   (std::is_floating_point_v<T> ? "float"
+                    : std::is_signed_v<T>       ? "signed"
+                                                : "unsigned") +
+                   " member of " + std::to_string(sizeof(T) * 8) + " bits");
+  }
+}
+
+// Checked readers behind TryFromJson. Each accepts exactly the values that
+// FromJson accepts for its type, and reports the others in |status|
+// instead of throwing.
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> std::enable_if_t<std::is_arithmetic_v<T>, bool>;
+inline bool TryRead(const json& j, bool& value, ParseStatus& status);
+template <typename Allocator>
+bool TryRead(const json& j,
+             std::basic_string<char, std::char_traits<char>, Allocator>& value,
+             ParseStatus& status);
+template <typename T, typename Allocator>
+bool TryRead(const json& j,
+             std::vector<T, Allocator>& value,
+             ParseStatus& status);
+template <typename K, typename T, typename Compare, typename Allocator>
+bool TryRead(const json& j,
+             std::map<K, T, Compare, Allocator>& value,
+             ParseStatus& status);
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> decltype(value.TryFromJson(j), bool());
+
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> std::enable_if_t<std::is_arithmetic_v<T>, bool> {
+  if (!ConvertNumber(j, value)) {
+    return TypeError(status);
+  }
+  return true;
+}
+
+inline bool TryRead(const json& j, bool& value, ParseStatus& status) {
+  if (!j.is_boolean()) {
+    return TypeError(status);
+  }
+  value = *j.get_ptr<const bool*>();
+  return true;
+}
+
+template <typename Allocator>
+bool TryRead(const json& j,
+             std::basic_string<char, std::char_traits<char>, Allocator>& value,
+             ParseStatus& status) {
+  if (!j.is_string()) {
+    return TypeError(status);
+  }
+  value.assign(*j.get_ptr<const std::string*>());
+  return true;
+}
+
+template <typename T, typename Allocator>
+bool TryRead(const json& j,
+             std::vector<T, Allocator>& value,
+             ParseStatus& status) {
+  if (!j.is_array()) {
+    return TypeError(status);
+  }
+  value.clear();
+  value.reserve(j.size());
+  for (std::size_t i = 0; i < j.size(); ++i) {
+    bool read;
+    if constexpr (std::is_same_v<T, bool>) {
+      bool element = false;
+      read = TryRead(j[i], element, status);
+      value.push_back(element);
+    } else {
+      read = TryRead(j[i], value.emplace_back(), status);
+    }
+    if (!read) {
+      PrependPath(status, std::to_string(i));
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename K, typename T, typename Compare, typename Allocator>
+bool TryRead(const json& j,
+             std::map<K, T, Compare, Allocator>& value,
+             ParseStatus& status) {
+  if (!j.is_object()) {
+    return TypeError(status);
+  }
+  value.clear();
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    if (!TryRead(it.value(), value[K(it.key(), value.get_allocator())],
+                 status)) {
+      PrependPath(status, it.key());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Generated classes check their own fields.
+template <typename T>
+auto TryRead(const json& j, T& value, ParseStatus& status)
+    -> decltype(value.TryFromJson(j), bool()) {
+  ParseStatus nested = value.TryFromJson(j);
+  if (!nested.ok()) {
+    status = std::move(nested);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_STATUS_
+
+#ifndef JSON2CLASS_KEY_HASH_
+#define JSON2CLASS_KEY_HASH_
+
+namespace json2class {
+
+// FNV-1a hash of an object key, the first level of the generated perfect
+// hash tables.
+constexpr std::uint64_t HashKey(std::string_view key) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Maps a key hash and its bucket displacement to a table slot.
+constexpr std::size_t KeySlot(std::uint64_t hash,
+                              std::uint32_t displacement,
+                              std::size_t mask) {
+  hash ^= displacement;
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  return static_cast<std::size_t>(hash & mask);
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_KEY_HASH_
+
+#ifndef JSON2CLASS_JSON_SCAN_
+#define JSON2CLASS_JSON_SCAN_
+
+namespace json2class {
+
+// Reports malformed input the same way json::parse does.
+[[noreturn]] inline void ThrowParseError(const char* begin, const char* end) {
+  json parsed = json::parse(begin, end);
+  (void)parsed;
+  JSON2CLASS_THROW(std::invalid_argument("json2class: malformed JSON object"));
+}
+
+inline const char* SkipJsonSpace(const char* p, const char* end) {
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    ++p;
+  }
+  return p;
+}
+
+// Returns the position after the string that starts at |p|, or nullptr if it
+// is not terminated.
+inline const char* SkipJsonString(const char* p, const char* end) {
+  const char* const begin = p;
+  for (++p; p < end; ++p) {
+    p = static_cast<const char*>(
+        std::memchr(p, '"', static_cast<std::size_t>(end - p)));
+    if (p == nullptr) {
+      return nullptr;
+    }
+    const char* q = p;
+    while (q - 1 > begin && q[-1] == '\\') {
+      --q;
+    }
+    if ((p - q) % 2 == 0) {
+      return p + 1;
+    }
+  }
+  return nullptr;
+}
+
+inline bool IsJsonDelimiter(char c) {
+  return c == ',' || c == ':' || c == '}' || c == ']' || c == ' ' ||
+         c == '\t' || c == '\n' || c == '\r';
+}
+
+// Returns the position after the number, true, false or null that starts at
+// |p|, or nullptr if there is none.
+inline const char* SkipJsonScalar(const char* p, const char* end) {
+  const auto digits = [end](const char* q) -> const char* {
+    const char* const first = q;
+    while (q != end && *q >= '0' && *q <= '9') {
+      ++q;
+    }
+    return q == first ? nullptr : q;
+  };
+  if (*p == 't' || *p == 'f' || *p == 'n') {
+    const std::string_view literal =
+        *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+    if (static_cast<std::size_t>(end - p) < literal.size() ||
+        std::string_view(p, literal.size()) != literal) {
+      return nullptr;
+    }
+    p += literal.size();
+  } else {
+    if (*p == '-') {
+      ++p;
+    }
+    if (p != end && *p == '0') {
+      ++p;
+    } else if ((p = digits(p)) == nullptr) {
+      return nullptr;
+    }
+    if (p != end && *p == '.' && (p = digits(p + 1)) == nullptr) {
+      return nullptr;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+      ++p;
+      if (p != end && (*p == '+' || *p == '-')) {
+        ++p;
+      }
+      if ((p = digits(p)) == nullptr) {
+        return nullptr;
+      }
+    }
+  }
+  return p == end || IsJsonDelimiter(*p) ? p : nullptr;
+}
+
+// Returns the position after the value that starts at |p|, or nullptr if it
+// is malformed. Brackets, strings and the tokens of numbers and literals are
+// checked, so that skipped values are rejected like parsed ones; commas and
+// colons are not.
+inline const char* SkipJsonValue(const char* p, const char* end) {
+  if (p == end) {
+    return nullptr;
+  }
+  if (*p == '"') {
+    return SkipJsonString(p, end);
+  }
+  if (*p == '{' || *p == '[') {
+    int depth = 0;
+    while (p < end) {
+      if (*p == '"') {
+        p = SkipJsonString(p, end);
+        if (p == nullptr) {
+          return nullptr;
+        }
+        continue;
+      }
+      if (*p == '{' || *p == '[') {
+        ++depth;
+      } else if ((*p == '}' || *p == ']') && --depth == 0) {
+        return p + 1;
+      } else if (!IsJsonDelimiter(*p)) {
+        p = SkipJsonScalar(p, end);
+        if (p == nullptr) {
+          return nullptr;
+        }
+        continue;
+      }
+      ++p;
+    }
+    return nullptr;
+  }
+  return SkipJsonScalar(p, end);
+}
+
+// Scans the object in [begin, end) once and calls |member| with every key,
+// the text of its value and where the member starts, at the quote of its key.
+// Values are checked as SkipJsonValue does, never parsed. Returns false if the
+// text is a JSON value that is not an object; malformed text throws
+// json::parse_error.
+template <typename Member>
+bool ScanJsonObject(const char* begin, const char* end, Member&& member) {
+  const char* p = SkipJsonSpace(begin, end);
+  if (p == end || *p != '{') {
+    if (!json::accept(begin, end)) {
+      ThrowParseError(begin, end);
+    }
+    return false;
+  }
+  p = SkipJsonSpace(p + 1, end);
+  if (p != end && *p == '}') {
+    p = SkipJsonSpace(p + 1, end);
+  } else {
+    std::string unescaped;
+    while (true) {
+      if (p == end || *p != '"') {
+        ThrowParseError(begin, end);
+      }
+      const char* const member_begin = p;
+      const char* key_end = SkipJsonString(p, end);
+      if (key_end == nullptr) {
+        ThrowParseError(begin, end);
+      }
+      std::string_view key(p + 1, static_cast<std::size_t>(key_end - p - 2));
+      if (key.find('\\') != std::string_view::npos) {
+        unescaped = json::parse(p, key_end).get<std::string>();
+        key = unescaped;
+      }
+      p = SkipJsonSpace(key_end, end);
+      if (p == end || *p != ':') {
+        ThrowParseError(begin, end);
+      }
+      p = SkipJsonSpace(p + 1, end);
+      const char* value_end = SkipJsonValue(p, end);
+      if (value_end == nullptr) {
+        ThrowParseError(begin, end);
+      }
+      member(key, p, value_end, member_begin);
+      p = SkipJsonSpace(value_end, end);
+      if (p != end && *p == ',') {
+        p = SkipJsonSpace(p + 1, end);
+      } else if (p != end && *p == '}') {
+        p = SkipJsonSpace(p + 1, end);
+        break;
+      } else {
+        ThrowParseError(begin, end);
+      }
+    }
+  }
+  if (p != end) {
+    ThrowParseError(begin, end);
+  }
+  return true;
+}
+
+// Scans the array in [begin, end) once and calls |element| with the text of
+// every element, like ScanJsonObject. Returns false if the text is a JSON
+// value that is not an array; malformed text throws json::parse_error.
+template <typename Element>
+bool ScanJsonArray(const char* begin, const char* end, Element&& element) {
+  const char* p = SkipJsonSpace(begin, end);
+  if (p == end || *p != '[') {
+    if (!json::accept(begin, end)) {
+      ThrowParseError(begin, end);
+    }
+    return false;
+  }
+  p = SkipJsonSpace(p + 1, end);
+  if (p != end && *p == ']') {
+    p = SkipJsonSpace(p + 1, end);
+  } else {
+    while (true) {
+      const char* value_end = SkipJsonValue(p, end);
+      if (value_end == nullptr) {
+        ThrowParseError(begin, end);
+      }
+      element(p, value_end);
+      p = SkipJsonSpace(value_end, end);
+      if (p != end && *p == ',') {
+        p = SkipJsonSpace(p + 1, end);
+      } else if (p != end && *p == ']') {
+        p = SkipJsonSpace(p + 1, end);
+        break;
+      } else {
+        ThrowParseError(begin, end);
+      }
+    }
+  }
+  if (p != end) {
+    ThrowParseError(begin, end);
+  }
+  return true;
+}
+
+// A set of fields of a generated class, named by its Field enum. Parsing
+// with a mask reads only the fields in it.
+template <typename Field, std::size_t N>
+class FieldMask {
+ public:
+  constexpr FieldMask() = default;
+  constexpr FieldMask(std::initializer_list<Field> fields) {
+    for (Field field : fields) {
+      set(field);
+    }
+  }
+
+  constexpr FieldMask& set(Field field) {
+    const auto index = static_cast<std::size_t>(field);
+    words_[index / 64] |= std::uint64_t{1} << (index % 64);
+    return *this;
+  }
+  constexpr bool test(Field field) const {
+    return test(static_cast<int>(field));
+  }
+  // Takes the index returned by FieldIndex; -1 is never set.
+  constexpr bool test(int index) const {
+    return index >= 0 && static_cast<std::size_t>(index) < N &&
+           ((words_[index / 64] >> (index % 64)) & 1) != 0;
+  }
+
+ private:
+  std::uint64_t words_[N == 0 ? 1 : (N + 63) / 64] = {};
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_JSON_SCAN_
+
+#ifndef JSON2CLASS_SAX_READER_
+#define JSON2CLASS_SAX_READER_
+
+namespace json2class {
+
+struct SaxOps;
+
+// A value that SAX events are written into. An empty slot skips the value.
+struct SaxSlot {
+  void* target = nullptr;
+  const SaxOps* ops = nullptr;
+};
+
+// Applies SAX events to a value of one C++ type. A null callback means the
+// type does not accept that kind of JSON value.
+struct SaxOps {
+  void (*value)(void* target, const json& value);
+  void (*string)(void* target, std::string& value);
+  SaxSlot (*member)(void* target, std::string_view key);
+  // Returns the slot of element |index| of the array. Elements left from an
+  // earlier parse are reused.
+  SaxSlot (*element)(void* target, std::size_t index);
+  // Called when an element of the array is complete. Returning false stops
+  // the parse.
+  bool (*end_element)(void* target);
+  // Called with the number of elements when the array ends, to drop the
+  // elements that were not reused.
+  void (*end_array)(void* target, std::size_t size);
+};
+
+template <typename T, typename = void>
+struct HasClear : std::false_type {};
+
+template <typename T>
+struct HasClear<T, std::void_t<decltype(std::declval<T&>().Clear())>>
+    : std::true_type {};
+
+// Resets a reused array element before it is parsed again. Generated classes
+// and containers keep the memory they already own.
+template <typename T>
+void ClearValue(T& value) {
+  if constexpr (HasClear<T>::value) {
+    value.Clear();
+  } else if constexpr (std::is_class_v<T>) {
+    value.clear();
+  }
+}
+
+// Scalars convert like the DOM based FromJson, so they accept and reject
+// exactly the same values.
+template <typename T, typename = void>
+struct SaxBinding {
+  static void Value(void* target, const json& value) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      ReadNumber(value, *static_cast<T*>(target));
+    } else {
+      value.get_to(*static_cast<T*>(target));
+    }
+  }
+  static void String(void* target, std::string& value) {
+    Value(target, json(std::move(value)));
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+template <typename T>
+SaxSlot MakeSaxSlot(T& target) {
+  return {&target, &SaxBinding<T>::kOps};
+}
+
+template <>
+struct SaxBinding<std::string> {
+  static void Value(void* target, const json& value) {
+    value.get_to(*static_cast<std::string*>(target));
+  }
+  static void String(void* target, std::string& value) {
+    // Copied rather than moved, so both the member and the lexer keep their
+    // buffers for the next value
+    static_cast<std::string*>(target)->assign(value);
+  }
+  static constexpr SaxOps kOps = {&Value, &String, nullptr,
+                                  nullptr, nullptr, nullptr};
+};
+
+template <typename T>
+struct SaxBinding<std::vector<T>> {
+  static SaxSlot Element(void* target, std::size_t index) {
+    auto& value = *static_cast<std::vector<T>*>(target);
+    if (index < value.size()) {
+      ClearValue(value[index]);
+      return MakeSaxSlot(value[index]);
+    }
+    return MakeSaxSlot(value.emplace_back());
+  }
+  static void EndArray(void* target, std::size_t size) {
+    auto& value = *static_cast<std::vector<T>*>(target);
+    if (size < value.size()) {
+      value.erase(value.begin() + size, value.end());
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr, nullptr,
+                                  &Element, nullptr, &EndArray};
+};
+
+// std::vector<bool> has no addressable elements, so values are appended.
+template <>
+struct SaxBinding<std::vector<bool>> {
+  static void Append(void* target, const json& value) {
+    static_cast<std::vector<bool>*>(target)->push_back(value.get<bool>());
+  }
+  static void AppendString(void* target, std::string& value) {
+    Append(target, json(std::move(value)));
+  }
+  static constexpr SaxOps kElementOps = {&Append, &AppendString, nullptr,
+                                         nullptr, nullptr, nullptr};
+  static SaxSlot Element(void* target, std::size_t index) {
+    if (index == 0) {
+      static_cast<std::vector<bool>*>(target)->clear();
+    }
+    return {target, &kElementOps};
+  }
+  static void EndArray(void* target, std::size_t size) {
+    if (size == 0) {
+      static_cast<std::vector<bool>*>(target)->clear();
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr, nullptr,
+                                  &Element, nullptr, &EndArray};
+};
+
+template <typename T>
+struct SaxBinding<std::map<std::string, T>> {
+  static SaxSlot Member(void* target, std::string_view key) {
+    return MakeSaxSlot(
+        (*static_cast<std::map<std::string, T>*>(target))[std::string(key)]);
+  }
+  static constexpr SaxOps kOps = {nullptr, nullptr, &Member,
+                                  nullptr, nullptr, nullptr};
+};
+
+// Generated classes dispatch keys through their SaxMember function.
+template <typename T>
+struct SaxBinding<T, std::void_t<decltype(&T::SaxMember)>> {
+  static constexpr SaxOps kOps = {nullptr, nullptr, &T::SaxMember,
+                                  nullptr, nullptr, nullptr};
+};
+
+// Hands the elements of an array to a callback one at a time instead of
+// storing them, so only one element is in memory at once. The callback
+// takes a T&& or const T& and may return false to stop the parse.
+template <typename T, typename Callback>
+class SaxStream {
+ public:
+  explicit SaxStream(Callback& callback) : callback_(callback) {}
+
+  SaxSlot slot() { return {this, &kOps}; }
+
+ private:
+  static SaxSlot Element(void* target, std::size_t) {
+    // One element object is reused, so its buffers are allocated only once
+    auto* self = static_cast<SaxStream*>(target);
+    ClearValue(self->element_);
+    return MakeSaxSlot(self->element_);
+  }
+  static bool EndElement(void* target) {
+    auto* self = static_cast<SaxStream*>(target);
+    if constexpr (std::is_same_v<std::invoke_result_t<Callback&, T&&>,
+                                 bool>) {
+      return self->callback_(std::move(self->element_));
+    } else {
+      self->callback_(std::move(self->element_));
+      return true;
+    }
+  }
+  static constexpr SaxOps kOps = {nullptr,  nullptr,     nullptr,
+                                  &Element, &EndElement, nullptr};
+
+  Callback& callback_;
+  T element_;
+};
+
+// SAX handler that writes a JSON document straight into a generated class
+// without building a DOM. Unknown keys and mismatched containers are skipped
+// like FromJson does; scalar type errors throw json::type_error.
+class SaxReader final : public nlohmann::json_sax<json> {
+ public:
+  explicit SaxReader(SaxSlot root) : root_(root) { stack_.reserve(16); }
+
+  // Writes the value of |key| in the root object into |stream| instead of
+  // the member of the root class.
+  SaxReader(SaxSlot root, std::string key, SaxSlot stream)
+      : root_(root), stream_key_(std::move(key)), stream_(stream) {
+    stack_.reserve(16);
+  }
+
+  bool null() override { return Scalar(json()); }
+  bool boolean(bool val) override { return Scalar(json(val)); }
+  bool number_integer(number_integer_t val) override {
+    return Scalar(json(val));
+  }
+  bool number_unsigned(number_unsigned_t val) override {
+    return Scalar(json(val));
+  }
+  bool number_float(number_float_t val, const string_t&) override {
+    return Scalar(json(val));
+  }
+
+  bool string(string_t& val) override {
+    SaxSlot slot = Next();
+    if (slot.ops && slot.ops->string) {
+      slot.ops->string(slot.target, val);
+    }
+    return EndValue();
+  }
+
+  bool binary(binary_t&) override {
+    Next();
+    return EndValue();
+  }
+
+  bool start_object(std::size_t) override {
+    SaxSlot slot = Next();
+    if (slot.ops && !slot.ops->member) {
+      Reject(slot, json::value_t::object);
+      slot = {};
+    }
+    stack_.push_back({slot, false, 0});
+    return true;
+  }
+
+  bool key(string_t& val) override {
+    const SaxSlot& object = stack_.back().slot;
+    if (stream_.ops && stack_.size() == 1 && val == stream_key_) {
+      member_ = stream_;
+      return true;
+    }
+    member_ = object.ops ? object.ops->member(object.target, val) : SaxSlot{};
+    return true;
+  }
+
+  bool end_object() override {
+    stack_.pop_back();
+    return EndValue();
+  }
+
+  bool start_array(std::size_t) override {
+    SaxSlot slot = Next();
+    if (slot.ops && !slot.ops->element) {
+      Reject(slot, json::value_t::array);
+      slot = {};
+    }
+    stack_.push_back({slot, true, 0});
+    return true;
+  }
+
+  bool end_array() override {
+    const Frame& top = stack_.back();
+    if (top.slot.ops && top.slot.ops->end_array) {
+      top.slot.ops->end_array(top.slot.target, top.size);
+    }
+    stack_.pop_back();
+    return EndValue();
+  }
+
+  bool parse_error(std::size_t,
+                   const std::string&,
+                   const nlohmann::detail::exception& ex) override {
+    // Rethrow the concrete type, as json::parse does
+    if (const auto* error = dynamic_cast<const json::parse_error*>(&ex)) {
+      JSON2CLASS_THROW(*error);
+    }
+    if (const auto* error = dynamic_cast<const json::out_of_range*>(&ex)) {
+      JSON2CLASS_THROW(*error);
+    }
+    JSON2CLASS_THROW(ex);
+  }
+
+ private:
+  struct Frame {
+    SaxSlot slot;
+    bool array;
+    std::size_t size;  // Elements started so far.
+  };
+
+  // Returns the slot for the value that starts with the current event.
+  SaxSlot Next() {
+    if (stack_.empty()) {
+      return std::exchange(root_, SaxSlot{});
+    }
+    Frame& top = stack_.back();
+    if (!top.array) {
+      return std::exchange(member_, SaxSlot{});
+    }
+    const std::size_t index = top.size++;
+    return top.slot.ops ? top.slot.ops->element(top.slot.target, index)
+                        : SaxSlot{};
+  }
+
+  bool Scalar(const json& value) {
+    SaxSlot slot = Next();
+    if (slot.ops && slot.ops->value) {
+      slot.ops->value(slot.target, value);
+    }
+    return EndValue();
+  }
+
+  // Reports a completed value to the array that contains it.
+  bool EndValue() {
+    if (stack_.empty() || !stack_.back().array) {
+      return true;
+    }
+    const SaxSlot& array = stack_.back().slot;
+    return !array.ops || !array.ops->end_element ||
+           array.ops->end_element(array.target);
+  }
+
+  // A container where a scalar is expected fails the same way json::get does.
+  static void Reject(const SaxSlot& slot, json::value_t type) {
+    if (slot.ops->value && !slot.ops->member && !slot.ops->element) {
+      slot.ops->value(slot.target, json(type));
+    }
+  }
+
+  SaxSlot root_;
+  SaxSlot member_;
+  std::string stream_key_;
+  SaxSlot stream_;
+  std::vector<Frame> stack_;
+};
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_SAX_READER_
+
+#ifndef JSON2CLASS_READERS_
+#define JSON2CLASS_READERS_
+
+namespace json2class {
+
+// Readers behind FromJson(const json&). They assign into the existing value,
+// so strings and vectors keep their capacity and array elements are reused;
+// values of the wrong type throw the same json::type_error as json::get.
+template <typename T>
+auto AssignJson(const json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>>;
+inline void AssignJson(const json& j, std::string& value);
+template <typename T>
+void AssignJson(const json& j, std::vector<T>& value);
+inline void AssignJson(const json& j, std::vector<bool>& value);
+template <typename T>
+void AssignJson(const json& j, std::map<std::string, T>& value);
+template <typename T>
+auto AssignJson(const json& j, T& value) -> decltype(value.Reparse(j));
+
+template <typename T>
+auto AssignJson(const json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>> {
+  ReadNumber(j, value);
+}
+
+inline void AssignJson(const json& j, std::string& value) {
+  if (!j.is_string()) {
+    j.get_to(value);
+    return;
+  }
+  value.assign(*j.get_ptr<const std::string*>());
+}
+
+template <typename T>
+void AssignJson(const json& j, std::vector<T>& value) {
+  if (!j.is_array()) {
+    j.get_to(value);
+    return;
+  }
+  value.resize(j.size());
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    AssignJson(j[i], value[i]);
+  }
+}
+
+inline void AssignJson(const json& j, std::vector<bool>& value) {
+  if (!j.is_array()) {
+    j.get_to(value);
+    return;
+  }
+  value.clear();
+  for (const json& element : j) {
+    value.push_back(element.get<bool>());
+  }
+}
+
+template <typename T>
+void AssignJson(const json& j, std::map<std::string, T>& value) {
+  j.get_to(value);
+}
+
+// An element of a class type becomes what a new element would have been.
+template <typename T>
+auto AssignJson(const json& j, T& value) -> decltype(value.Reparse(j)) {
+  value.Reparse(j);
+}
+
+// Readers behind FromJson(json&&). Strings and the elements of arrays and
+// objects are moved out of |j| instead of copied; values of the wrong type
+// throw the same json::type_error as json::get.
+template <typename T>
+auto MoveJson(json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>>;
+inline void MoveJson(json& j, std::string& value);
+template <typename T>
+void MoveJson(json& j, std::vector<T>& value);
+inline void MoveJson(json& j, std::vector<bool>& value);
+template <typename T>
+void MoveJson(json& j, std::map<std::string, T>& value);
+template <typename T>
+auto MoveJson(json& j, T& value) -> decltype(value.FromJson(std::move(j)));
+
+template <typename T>
+auto MoveJson(json& j, T& value)
+    -> std::enable_if_t<std::is_arithmetic_v<T>> {
+  ReadNumber(j, value);
+}
+
+inline void MoveJson(json& j, std::string& value) {
+  if (!j.is_string()) {
+    j.get_to(value);
+    return;
+  }
+  value = std::move(*j.get_ptr<std::string*>());
+}
+
+template <typename T>
+void MoveJson(json& j, std::vector<T>& value) {
+  if (!j.is_array()) {
+    j.get_to(value);
+    return;
+  }
+  value.clear();
+  value.reserve(j.size());
+  for (json& element : j) {
+    MoveJson(element, value.emplace_back());
+  }
+}
+
+inline void MoveJson(json& j, std::vector<bool>& value) {
+  j.get_to(value);
+}
+
+template <typename T>
+void MoveJson(json& j, std::map<std::string, T>& value) {
+  if (!j.is_object()) {
+    j.get_to(value);
+    return;
+  }
+  value.clear();
+  for (auto it = j.begin(); it != j.end(); ++it) {
+    MoveJson(it.value(), value[it.key()]);
+  }
+}
+
+template <typename T>
+auto MoveJson(json& j, T& value) -> decltype(value.FromJson(std::move(j))) {
+  value.FromJson(std::move(j));
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_READERS_
+
+#ifndef JSON2CLASS_JSON_WRITER_
+#define JSON2CLASS_JSON_WRITER_
+
+namespace json2class {
+
+// Appends JSON text to a std::string.
+class StringSink {
+ public:
+  explicit StringSink(std::string& out) : out_(out) {}
+
+  void Append(const char* data, std::size_t size) { out_.append(data, size); }
+  void Append(char c) { out_.push_back(c); }
+  template <std::size_t N>
+  void Append(const char (&text)[N]) {
+    Append(text, N - 1);
+  }
+
+ private:
+  std::string& out_;
+};
+
+// Writes JSON text into a caller-provided buffer without a terminating NUL.
+// size() keeps counting past the capacity, so a caller whose buffer was too
+// small learns how many bytes are needed.
+class BufferSink {
+ public:
+  BufferSink(char* buffer, std::size_t capacity)
+      : buffer_(buffer), capacity_(capacity) {}
+
+  void Append(const char* data, std::size_t size) {
+    if (size_ < capacity_) {
+      std::memcpy(buffer_ + size_, data, std::min(size, capacity_ - size_));
+    }
+    size_ += size;
+  }
+  void Append(char c) {
+    if (size_ < capacity_) {
+      buffer_[size_] = c;
+    }
+    ++size_;
+  }
+  template <std::size_t N>
+  void Append(const char (&text)[N]) {
+    Append(text, N - 1);
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  char* buffer_;
+  std::size_t capacity_;
+  std::size_t size_ = 0;
+};
+
+// Numbers are formatted with std::to_chars. Floating point values use the
+// shortest round-trip form of the double they convert to and keep a ".0"
+// suffix like json::dump; values that JSON cannot represent are written as
+// null.
+template <typename Sink, typename T>
+std::enable_if_t<std::is_arithmetic_v<T>> WriteJson(Sink& sink, T value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    if (value) {
+      sink.Append("true");
+    } else {
+      sink.Append("false");
+    }
+  } else if constexpr (std::is_integral_v<T>) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    sink.Append(buffer, static_cast<std::size_t>(result.ptr - buffer));
+  } else {
+    if (!std::isfinite(value)) {
+      sink.Append("null");
+      return;
+    }
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer) - 2,
+                                static_cast<double>(value));
+    std::size_t size = static_cast<std::size_t>(result.ptr - buffer);
+    if (std::find_if(buffer, result.ptr, [](char c) {
+          return c == '.' || c == 'e';
+        }) == result.ptr) {
+      buffer[size++] = '.';
+      buffer[size++] = '0';
+    }
+    sink.Append(buffer, size);
+  }
+}
+
+// Escapes a string in one pass, copying runs of plain characters at once.
+// The bytes are written as they are, without UTF-8 validation.
+template <typename Sink>
+void WriteJson(Sink& sink, std::string_view value) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  sink.Append('"');
+  std::size_t run = 0;
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    const unsigned char c = static_cast<unsigned char>(value[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    sink.Append(value.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':
+        sink.Append("\\\"");
+        break;
+      case '\\':
+        sink.Append("\\\\");
+        break;
+      case '\b':
+        sink.Append("\\b");
+        break;
+      case '\f':
+        sink.Append("\\f");
+        break;
+      case '\n':
+        sink.Append("\\n");
+        break;
+      case '\r':
+        sink.Append("\\r");
+        break;
+      case '\t':
+        sink.Append("\\t");
+        break;
+      default: {
+        const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+        sink.Append(escaped, sizeof(escaped));
+        break;
+      }
+    }
+  }
+  sink.Append(value.data() + run, value.size() - run);
+  sink.Append('"');
+}
+
+template <typename Sink>
+void WriteJson(Sink& sink, const std::string& value) {
+  WriteJson(sink, std::string_view(value));
+}
+
+template <typename Sink, typename T>
+auto WriteJson(Sink& sink, const T& value) -> decltype(value.WriteJson(sink)) {
+  value.WriteJson(sink);
+}
+
+template <typename Sink, typename T, typename Allocator>
+void WriteJson(Sink& sink, const std::vector<T, Allocator>& value) {
+  sink.Append('[');
+  for (std::size_t i = 0; i < value.size(); ++i) {
+    if (i != 0) {
+      sink.Append(',');
+    }
+    WriteJson(sink, static_cast<const T&>(value[i]));
+  }
+  sink.Append(']');
+}
+
+template <typename Sink,
+          typename Key,
+          typename T,
+          typename Compare,
+          typename Allocator>
+void WriteJson(Sink& sink,
+               const std::map<Key, T, Compare, Allocator>& value) {
+  sink.Append('{');
+  bool first = true;
+  for (const auto& item : value) {
+    if (!first) {
+      sink.Append(',');
+    }
+    first = false;
+    WriteJson(sink, std::string_view(item.first));
+    sink.Append(':');
+    WriteJson(sink, item.second);
+  }
+  sink.Append('}');
+}
+
+}  // namespace json2class
+
+#endif  // JSON2CLASS_JSON_WRITER_
+
 class person {
  public:
   person() = default;
   ~person() = default;
+  person(const person&) = default;
+  person(person&&) = default;
+  person& operator=(const person&) = default;
+  person& operator=(person&&) = default;
 
   person(const json& j) {
     FromJson(j);
   }
 
+  person(json&& j) {
+    FromJson(std::move(j));
+  }
+
   void FromJson(const json& j) {
-    if (j.contains("active")) {
-      active_ = j["active"].get<bool>();
+    if (!j.is_object()) {
+      return;
+    }
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      switch (FieldIndex(it.key())) {
+        case 0:
+          json2class::ReadNumber(it.value(), active_);
+          break;
+        case 1:
+          json2class::ReadNumber(it.value(), age_);
+          break;
+        case 2:
+          json2class::AssignJson(it.value(), name_);
+          break;
+        case 3:
+          json2class::ReadNumber(it.value(), salary_);
+          break;
+        case 4:
+          if (it.value().is_object()) {
+            scores_.FromJson(it.value());
+          }
+          break;
+        case 5:
+          if (it.value().is_array()) {
+            json2class::AssignJson(it.value(), skill_);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  void FromJson(json&& j) {
+    if (!j.is_object()) {
+      return;
+    }
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      switch (FieldIndex(it.key())) {
+        case 0:
+          json2class::ReadNumber(it.value(), active_);
+          break;
+        case 1:
+          json2class::ReadNumber(it.value(), age_);
+          break;
+        case 2:
+          json2class::MoveJson(it.value(), name_);
+          break;
+        case 3:
+          json2class::ReadNumber(it.value(), salary_);
+          break;
+        case 4:
+          if (it.value().is_object()) {
+            scores_.FromJson(std::move(it.value()));
+          }
+          break;
+        case 5:
+          if (it.value().is_array()) {
+            json2class::MoveJson(it.value(), skill_);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  void Reparse(const json& j) {
+    if (!j.is_object()) {
+      Clear();
+      return;
+    }
+    bool seen[6] = {};
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      switch (FieldIndex(it.key())) {
+        case 0:
+          json2class::ReadNumber(it.value(), active_);
+          seen[0] = true;
+          break;
+        case 1:
+          json2class::ReadNumber(it.value(), age_);
+          seen[1] = true;
+          break;
+        case 2:
+          json2class::AssignJson(it.value(), name_);
+          seen[2] = true;
+          break;
+        case 3:
+          json2class::ReadNumber(it.value(), salary_);
+          seen[3] = true;
+          break;
+        case 4:
+          if (it.value().is_object()) {
+            scores_.Reparse(it.value());
+            seen[4] = true;
+          }
+          break;
+        case 5:
+          if (it.value().is_array()) {
+            json2class::AssignJson(it.value(), skill_);
+            seen[5] = true;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+    if (!seen[0]) {
+      active_ = true;
     }
-    if (j.contains("age")) {
-      age_ = j["age"].get<int>();
+    if (!seen[1]) {
+      age_ = 26;
     }
-    if (j.contains("name")) {
-      name_ = j["name"].get<std::string>();
+    if (!seen[2]) {
+      name_.assign("hello");
     }
-    if (j.contains("salary")) {
-      salary_ = j["salary"].get<double>();
+    if (!seen[3]) {
+      salary_ = 1500.500000;
     }
-    if (j.contains("scores") && j["scores"].is_object()) {
-      scores_.FromJson(j["scores"]);
+    if (!seen[4]) {
+      scores_.Clear();
     }
-    if (j.contains("skill") && j["skill"].is_array()) {
-      skill_ = j["skill"].get<std::vector<std::string>>();
+    if (!seen[5]) {
+      skill_.assign({"c++", "debug"});
     }
   }
 
+  void Clear() {
+    active_ = true;
+    age_ = 26;
+    name_.assign("hello");
+    salary_ = 1500.500000;
+    scores_.Clear();
+    skill_.assign({"c++", "debug"});
+  }
+
   json ToJson() const {
-    json j;
+    json j = json::object();
     j["active"] = active_;
     j["age"] = age_;
     j["name"] = name_;
@@ -49,32 +1372,366 @@ class person {
     return j;
   }
 
+  template <typename Sink>
+  void WriteJson(Sink& sink) const {
+    sink.Append("{\"active\":");
+    json2class::WriteJson(sink, active_);
+    sink.Append(",\"age\":");
+    json2class::WriteJson(sink, age_);
+    sink.Append(",\"name\":");
+    json2class::WriteJson(sink, name_);
+    sink.Append(",\"salary\":");
+    json2class::WriteJson(sink, salary_);
+    sink.Append(",\"scores\":");
+    json2class::WriteJson(sink, scores_);
+    sink.Append(",\"skill\":");
+    json2class::WriteJson(sink, skill_);
+    sink.Append('}');
+  }
+
+  void ToJsonString(std::string& out) const {
+    out.clear();
+    json2class::StringSink sink(out);
+    WriteJson(sink);
+  }
+
+  std::size_t ToJsonString(char* buffer, std::size_t capacity) const {
+    json2class::BufferSink sink(buffer, capacity);
+    WriteJson(sink);
+    return sink.size();
+  }
+
+  static int FieldIndex(std::string_view key) {
+    static constexpr std::uint32_t kDisplacements[] = {0, 0, 4, 1};
+    static constexpr std::string_view kKeys[] = {"scores", "name", "", "", "age", "active", "salary", "skill"};
+    static constexpr int kFields[] = {4, 2, -1, -1, 1, 0, 3, 5};
+    const std::uint64_t hash = json2class::HashKey(key);
+    const std::size_t slot = json2class::KeySlot(
+        hash, kDisplacements[(hash >> 32) & 3], 7);
+    return kKeys[slot] == key ? kFields[slot] : -1;
+  }
+
+  void FromJsonString(std::string_view text) {
+    json2class::SaxReader reader(json2class::MakeSaxSlot(*this));
+    json::sax_parse(text.data(), text.data() + text.size(), &reader);
+  }
+
+  void FromJsonStream(std::istream& in) {
+    json2class::SaxReader reader(json2class::MakeSaxSlot(*this));
+    json::sax_parse(in, &reader);
+  }
+
+  static json2class::SaxSlot SaxMember(void* target, std::string_view key) {
+    auto* self = static_cast<person*>(target);
+    switch (FieldIndex(key)) {
+      case 0:
+        return json2class::MakeSaxSlot(self->active_);
+      case 1:
+        return json2class::MakeSaxSlot(self->age_);
+      case 2:
+        return json2class::MakeSaxSlot(self->name_);
+      case 3:
+        return json2class::MakeSaxSlot(self->salary_);
+      case 4:
+        return json2class::MakeSaxSlot(self->scores_);
+      case 5:
+        return json2class::MakeSaxSlot(self->skill_);
+      default:
+        return {};
+    }
+  }
+
+  json2class::ParseStatus TryFromJson(const json& j) {
+    json2class::ParseStatus status;
+    if (!j.is_object()) {
+      return {json2class::StatusCode::kTypeError, {}};
+    }
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      bool read = true;
+      switch (FieldIndex(it.key())) {
+        case 0:
+          read = json2class::TryRead(it.value(), active_, status);
+          break;
+        case 1:
+          read = json2class::TryRead(it.value(), age_, status);
+          break;
+        case 2:
+          read = json2class::TryRead(it.value(), name_, status);
+          break;
+        case 3:
+          read = json2class::TryRead(it.value(), salary_, status);
+          break;
+        case 4:
+          read = !it.value().is_object() ||
+                 json2class::TryRead(it.value(), scores_, status);
+          break;
+        case 5:
+          read = !it.value().is_array() ||
+                 json2class::TryRead(it.value(), skill_, status);
+          break;
+        default:
+          break;
+      }
+      if (!read) {
+        json2class::PrependPath(status, it.key());
+        return status;
+      }
+    }
+    return status;
+  }
+
+  json2class::ParseStatus TryFromJsonString(std::string_view text) {
+    const json j = json::parse(text.begin(), text.end(), nullptr, false);
+    if (j.is_discarded()) {
+      return {json2class::StatusCode::kSyntaxError, {}};
+    }
+    return TryFromJson(j);
+  }
+
+  enum class Field { active, age, name, salary, scores, skill };
+  using FieldMask = json2class::FieldMask<Field, 6>;
+
+  void FromJson(const json& j, FieldMask mask) {
+    if (!j.is_object()) {
+      return;
+    }
+    for (auto it = j.begin(); it != j.end(); ++it) {
+      const int field = FieldIndex(it.key());
+      if (!mask.test(field)) {
+        continue;
+      }
+      switch (field) {
+        case 0:
+          json2class::ReadNumber(it.value(), active_);
+          break;
+        case 1:
+          json2class::ReadNumber(it.value(), age_);
+          break;
+        case 2:
+          json2class::AssignJson(it.value(), name_);
+          break;
+        case 3:
+          json2class::ReadNumber(it.value(), salary_);
+          break;
+        case 4:
+          if (it.value().is_object()) {
+            scores_.FromJson(it.value());
+          }
+          break;
+        case 5:
+          if (it.value().is_array()) {
+            json2class::AssignJson(it.value(), skill_);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  void FromJsonString(std::string_view text, FieldMask mask) {
+    json2class::ScanJsonObject(
+        text.data(), text.data() + text.size(),
+        [this, mask](std::string_view key, const char* begin,
+                     const char* end, const char*) {
+          if (mask.test(FieldIndex(key))) {
+            json2class::SaxReader reader(SaxMember(this, key));
+            json::sax_parse(begin, end, &reader);
+          }
+        });
+  }
+
+  template <typename Callback>
+  bool StreamSkill(std::string_view text, Callback&& callback) {
+    json2class::SaxStream<decltype(skill_)::value_type, Callback> stream(callback);
+    json2class::SaxReader reader(json2class::MakeSaxSlot(*this), "skill", stream.slot());
+    return json::sax_parse(text.data(), text.data() + text.size(), &reader);
+  }
+
+  template <typename Callback>
+  bool StreamSkill(std::istream& in, Callback&& callback) {
+    json2class::SaxStream<decltype(skill_)::value_type, Callback> stream(callback);
+    json2class::SaxReader reader(json2class::MakeSaxSlot(*this), "skill", stream.slot());
+    return json::sax_parse(in, &reader);
+  }
+
  private:
   bool active_{true};
   int age_{26};
   std::string name_{"hello"};
   double salary_{1500.500000};
+ public:
   class scores_type {
    public:
     scores_type() = default;
     ~scores_type() = default;
+    scores_type(const scores_type&) = default;
+    scores_type(scores_type&&) = default;
+    scores_type& operator=(const scores_type&) = default;
+    scores_type& operator=(scores_type&&) = default;
 
     void FromJson(const json& j) {
-      if (j.contains("English")) {
-        English_ = j["English"].get<int>();
+      if (!j.is_object()) {
+        return;
+      }
+      for (auto it = j.begin(); it != j.end(); ++it) {
+        switch (FieldIndex(it.key())) {
+          case 0:
+            json2class::ReadNumber(it.value(), English_);
+            break;
+          case 1:
+            json2class::ReadNumber(it.value(), Math_);
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
+    void FromJson(json&& j) {
+      if (!j.is_object()) {
+        return;
+      }
+      for (auto it = j.begin(); it != j.end(); ++it) {
+        switch (FieldIndex(it.key())) {
+          case 0:
+            json2class::ReadNumber(it.value(), English_);
+            break;
+          case 1:
+            json2class::ReadNumber(it.value(), Math_);
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
+    void Reparse(const json& j) {
+      if (!j.is_object()) {
+        Clear();
+        return;
+      }
+      bool seen[2] = {};
+      for (auto it = j.begin(); it != j.end(); ++it) {
+        switch (FieldIndex(it.key())) {
+          case 0:
+            json2class::ReadNumber(it.value(), English_);
+            seen[0] = true;
+            break;
+          case 1:
+            json2class::ReadNumber(it.value(), Math_);
+            seen[1] = true;
+            break;
+          default:
+            break;
+        }
       }
-      if (j.contains("Math")) {
-        Math_ = j["Math"].get<int>();
+      if (!seen[0]) {
+        English_ = 90;
       }
+      if (!seen[1]) {
+        Math_ = 95;
+      }
+    }
+
+    void Clear() {
+      English_ = 90;
+      Math_ = 95;
     }
 
     json ToJson() const {
-      json j;
+      json j = json::object();
       j["English"] = English_;
       j["Math"] = Math_;
       return j;
     }
 
+    template <typename Sink>
+    void WriteJson(Sink& sink) const {
+      sink.Append("{\"English\":");
+      json2class::WriteJson(sink, English_);
+      sink.Append(",\"Math\":");
+      json2class::WriteJson(sink, Math_);
+      sink.Append('}');
+    }
+
+    void ToJsonString(std::string& out) const {
+      out.clear();
+      json2class::StringSink sink(out);
+      WriteJson(sink);
+    }
+
+    std::size_t ToJsonString(char* buffer, std::size_t capacity) const {
+      json2class::BufferSink sink(buffer, capacity);
+      WriteJson(sink);
+      return sink.size();
+    }
+
+    static int FieldIndex(std::string_view key) {
+      static constexpr std::uint32_t kDisplacements[] = {8};
+      static constexpr std::string_view kKeys[] = {"Math", "English"};
+      static constexpr int kFields[] = {1, 0};
+      const std::uint64_t hash = json2class::HashKey(key);
+      const std::size_t slot = json2class::KeySlot(
+          hash, kDisplacements[(hash >> 32) & 0], 1);
+      return kKeys[slot] == key ? kFields[slot] : -1;
+    }
+
+    void FromJsonString(std::string_view text) {
+      json2class::SaxReader reader(json2class::MakeSaxSlot(*this));
+      json::sax_parse(text.data(), text.data() + text.size(), &reader);
+    }
+
+    void FromJsonStream(std::istream& in) {
+      json2class::SaxReader reader(json2class::MakeSaxSlot(*this));
+      json::sax_parse(in, &reader);
+    }
+
+    static json2class::SaxSlot SaxMember(void* target, std::string_view key) {
+      auto* self = static_cast<scores_type*>(target);
+      switch (FieldIndex(key)) {
+        case 0:
+          return json2class::MakeSaxSlot(self->English_);
+        case 1:
+          return json2class::MakeSaxSlot(self->Math_);
+        default:
+          return {};
+      }
+    }
+
+    json2class::ParseStatus TryFromJson(const json& j) {
+      json2class::ParseStatus status;
+      if (!j.is_object()) {
+        return {json2class::StatusCode::kTypeError, {}};
+      }
+      for (auto it = j.begin(); it != j.end(); ++it) {
+        bool read = true;
+        switch (FieldIndex(it.key())) {
+          case 0:
+            read = json2class::TryRead(it.value(), English_, status);
+            break;
+          case 1:
+            read = json2class::TryRead(it.value(), Math_, status);
+            break;
+          default:
+            break;
+        }
+        if (!read) {
+          json2class::PrependPath(status, it.key());
+          return status;
+        }
+      }
+      return status;
+    }
+
+    json2class::ParseStatus TryFromJsonString(std::string_view text) {
+      const json j = json::parse(text.begin(), text.end(), nullptr, false);
+      if (j.is_discarded()) {
+        return {json2class::StatusCode::kSyntaxError, {}};
+      }
+      return TryFromJson(j);
+    }
+
    private:
     int English_{90};
     int Math_{95};
@@ -105,6 +1762,7 @@ class person {
 
   };
 
+ private:
   scores_type scores_;
   std::vector<std::string> skill_{"c++", "debug"};
  public:
@@ -144,6 +1802,10 @@ class person {
     name_ = value;
   }
 
+  void set_name(std::string&& value) {
+    name_ = std::move(value);
+  }
+
   const double& salary() const {
     return salary_;
   }
@@ -168,6 +1830,10 @@ class person {
     scores_ = value;
   }
 
+  void set_scores(scores_type&& value) {
+    scores_ = std::move(value);
+  }
+
   const std::vector<std::string>& skill() const {
     return skill_;
   }
@@ -180,6 +1846,10 @@ class person {
     skill_ = value;
   }
 
+  void set_skill(std::vector<std::string>&& value) {
+    skill_ = std::move(value);
+  }
+
 };
 
 #endif  // person_H_
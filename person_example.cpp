@@ -7,13 +7,15 @@
 #include <nlohmann/json.hpp>
 #ifdef LAZY_PARSING
 #include "lazy_person.h"
+#elif defined(SIMDJSON_BACKEND)
+#include "simdjson_person.h"
 #else
 #include "person.h"
 #endif
 
 int main() {
   // Create a person object using default values
-  person p1;
+  const person p1;
 
   // Print default values
   std::cout << "Default person:" << std::endl;
@@ -80,26 +82,33 @@ int main() {
     }
   })";
 
+#ifdef SIMDJSON_BACKEND
+  person p3;
+  p3.ParseFrom(simdjson::padded_string(json_str));  // Using simdjson
+#else
   json j3 = json::parse(json_str);
   person p3(j3);  // Using constructor with JSON
+#endif
 
-  // Print deserialized values
+  // Print deserialized values. Reading through a const reference never
+  // marks a field of a lazy class as modified.
+  const person& printed = p3;
   std::cout << "\nDeserialized person:" << std::endl;
-  std::cout << "Name: " << p3.name() << std::endl;
-  std::cout << "Age: " << p3.age() << std::endl;
-  std::cout << "Salary: " << p3.salary() << std::endl;
-  std::cout << "Active: " << (p3.active() ? "Yes" : "No") << std::endl;
+  std::cout << "Name: " << printed.name() << std::endl;
+  std::cout << "Age: " << printed.age() << std::endl;
+  std::cout << "Salary: " << printed.salary() << std::endl;
+  std::cout << "Active: " << (printed.active() ? "Yes" : "No") << std::endl;
 
   // Print skills
   std::cout << "Skills: ";
-  for (const auto& skill : p3.skill()) {
+  for (const auto& skill : printed.skill()) {
     std::cout << skill << " ";
   }
   std::cout << std::endl;
 
   // Print scores
-  std::cout << "Math score: " << p3.scores().Math() << std::endl;
-  std::cout << "English score: " << p3.scores().English() << std::endl;
+  std::cout << "Math score: " << printed.scores().Math() << std::endl;
+  std::cout << "English score: " << printed.scores().English() << std::endl;
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,556 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "schema_inference.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <set>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace {
+
+// The kinds of value a field can hold, from which its C++ type is chosen.
+enum Kind {
+  kNull,
+  kBool,
+  kInt32,
+  kInt64,
+  kUInt64,
+  kDouble,
+  kString,
+  kArray,
+  kObject,
+  kKindCount
+};
+
+const char* const kKindNames[kKindCount] = {
+    "null", "bool",   "int",   "int64", "uint64",
+    "double", "string", "array", "object"};
+
+unsigned Bit(Kind kind) {
+  return 1u << kind;
+}
+
+Kind Classify(const json& value) {
+  switch (value.type()) {
+    case json::value_t::boolean:
+      return kBool;
+    case json::value_t::number_unsigned: {
+      const std::uint64_t number = value.get<std::uint64_t>();
+      if (number > static_cast<std::uint64_t>(
+                       std::numeric_limits<std::int64_t>::max())) {
+        return kUInt64;
+      }
+      return number > static_cast<std::uint64_t>(
+                          std::numeric_limits<int>::max())
+                 ? kInt64
+                 : kInt32;
+    }
+    case json::value_t::number_integer: {
+      const std::int64_t number = value.get<std::int64_t>();
+      return number < std::numeric_limits<int>::min() ||
+                     number > std::numeric_limits<int>::max()
+                 ? kInt64
+                 : kInt32;
+    }
+    case json::value_t::number_float:
+      return kDouble;
+    case json::value_t::string:
+      return kString;
+    case json::value_t::array:
+      return kArray;
+    case json::value_t::object:
+      return kObject;
+    default:
+      return kNull;
+  }
+}
+
+std::uint64_t Magnitude(const json& value) {
+  if (value.is_number_unsigned()) {
+    return value.get<std::uint64_t>();
+  }
+  const std::int64_t number = value.get<std::int64_t>();
+  return number < 0 ? static_cast<std::uint64_t>(-(number + 1)) + 1
+                    : static_cast<std::uint64_t>(number);
+}
+
+// Orders the candidate samples of one kind, so that the chosen sample does
+// not depend on the order of the documents: the value closest to zero or the
+// shortest string wins, and ties go to the larger value.
+bool Preferred(const json& a, const json& b) {
+  if (a.is_string()) {
+    const std::string& x = a.get_ref<const std::string&>();
+    const std::string& y = b.get_ref<const std::string&>();
+    return x.size() != y.size() ? x.size() < y.size() : x < y;
+  } else if (a.is_number_float()) {
+    const double x = std::fabs(a.get<double>());
+    const double y = std::fabs(b.get<double>());
+    return x != y ? x < y : a > b;
+  } else if (a.is_number()) {
+    const std::uint64_t x = Magnitude(a);
+    const std::uint64_t y = Magnitude(b);
+    return x != y ? x < y : a > b;
+  }
+  return a < b;
+}
+
+void UpdateSample(json& sample, const json& candidate) {
+  if (!candidate.is_null() &&
+      (sample.is_null() || Preferred(candidate, sample))) {
+    sample = candidate;
+  }
+}
+
+std::string KindNames(unsigned kinds) {
+  std::string names;
+  for (int kind = 0; kind < kKindCount; ++kind) {
+    if (kinds & Bit(static_cast<Kind>(kind))) {
+      names += names.empty() ? "" : "|";
+      names += kKindNames[kind];
+    }
+  }
+  return names;
+}
+
+// One unit of corpus work: a whole document, or the lines of an NDJSON file
+// that start within [begin, end).
+struct CorpusTask {
+  std::string path;
+  bool lines;
+  std::uint64_t begin;
+  std::uint64_t end;
+};
+
+// Splits an NDJSON file into a few chunks per thread.
+bool AddLineTasks(const std::filesystem::path& path,
+                  unsigned threads,
+                  std::vector<CorpusTask>& tasks) {
+  std::error_code error;
+  const std::uint64_t size = std::filesystem::file_size(path, error);
+  if (error) {
+    return false;
+  }
+  const std::uint64_t chunk_size = std::clamp<std::uint64_t>(
+      size / (std::max(threads, 1u) * 4ull), 1 << 20, 64 << 20);
+  for (std::uint64_t begin = 0; begin < size; begin += chunk_size) {
+    tasks.push_back(
+        {path.string(), true, begin, std::min(begin + chunk_size, size)});
+  }
+  return true;
+}
+
+void AddDocument(std::string_view text, SchemaInference& schema) {
+  json document = json::parse(text.begin(), text.end(), nullptr, false);
+  if (document.is_discarded()) {
+    schema.AddMalformed();
+  } else {
+    schema.Add(document);
+  }
+}
+
+bool RunTask(const CorpusTask& task, SchemaInference& schema) {
+  json2class::MappedFile file;
+  if (!file.Open(task.path)) {
+    return false;
+  }
+  const std::string_view data = file.data();
+  if (!task.lines) {
+    AddDocument(data, schema);
+    return true;
+  }
+
+  // A line belongs to the task in which it starts
+  std::size_t pos = 0;
+  if (task.begin > 0) {
+    pos = data.find('\n', task.begin - 1);
+    if (pos == std::string_view::npos) {
+      return true;
+    }
+    ++pos;
+  }
+  while (pos < task.end && pos < data.size()) {
+    const std::size_t line_end = std::min(data.find('\n', pos), data.size());
+    const std::string_view line = data.substr(pos, line_end - pos);
+    if (line.find_first_not_of(" \t\r") != std::string_view::npos) {
+      AddDocument(line, schema);
+    }
+    pos = line_end + 1;
+  }
+  return true;
+}
+
+}  // namespace
+
+struct SchemaInference::Node {
+  unsigned kinds = 0;
+  bool negative = false;
+  std::uint64_t present = 0;  // Values seen, including nulls.
+  std::uint64_t nulls = 0;
+  std::uint64_t objects = 0;  // Values that were objects.
+  json samples[kKindCount];   // Representative value per scalar kind.
+  std::uint64_t strings = 0;  // Values that were strings.
+  // Distinct strings, until there are more than kMaxEnumValues of them.
+  std::set<std::string> values;
+  bool many_values = false;
+  // Range of the integers; |max_integer| stays 0 if all are negative.
+  std::int64_t min_integer = std::numeric_limits<std::int64_t>::max();
+  std::uint64_t max_integer = 0;
+  bool wide_doubles = false;  // A double was not exactly a float.
+  std::map<std::string, std::unique_ptr<Node>> fields;
+  std::unique_ptr<Node> element;  // Merged elements of all arrays.
+};
+
+SchemaInference::SchemaInference() : root_(std::make_unique<Node>()) {}
+
+SchemaInference::~SchemaInference() {}
+
+void SchemaInference::Add(const json& document) {
+  if (!document.is_object()) {
+    AddMalformed();
+    return;
+  }
+  Add(*root_, document);
+}
+
+void SchemaInference::AddMalformed() {
+  ++malformed_;
+}
+
+void SchemaInference::Merge(const SchemaInference& other) {
+  Merge(*root_, *other.root_);
+  malformed_ += other.malformed_;
+}
+
+json SchemaInference::Sample() const {
+  return root_->objects == 0 ? json::object() : Sample(*root_);
+}
+
+void SchemaInference::Report(std::ostream& out) const {
+  Report(out, *root_, "", root_->objects);
+}
+
+std::uint64_t SchemaInference::documents() const {
+  return root_->objects;
+}
+
+void SchemaInference::Add(Node& node, const json& value) {
+  const Kind kind = Classify(value);
+  node.kinds |= Bit(kind);
+  ++node.present;
+  if (kind == kNull) {
+    ++node.nulls;
+  } else if (kind == kObject) {
+    ++node.objects;
+    for (auto it = value.begin(); it != value.end(); ++it) {
+      std::unique_ptr<Node>& field = node.fields[it.key()];
+      if (!field) {
+        field = std::make_unique<Node>();
+      }
+      Add(*field, it.value());
+    }
+  } else if (kind == kArray) {
+    for (const json& element : value) {
+      if (!node.element) {
+        node.element = std::make_unique<Node>();
+      }
+      Add(*node.element, element);
+    }
+  } else {
+    node.negative |= value.type() == json::value_t::number_integer &&
+                     value.get<std::int64_t>() < 0;
+    if (value.is_number_unsigned()) {
+      const std::uint64_t number = value.get<std::uint64_t>();
+      if (node.min_integer > 0 &&
+          number < static_cast<std::uint64_t>(node.min_integer)) {
+        node.min_integer = static_cast<std::int64_t>(number);
+      }
+      node.max_integer = std::max(node.max_integer, number);
+    } else if (value.is_number_integer()) {
+      const std::int64_t number = value.get<std::int64_t>();
+      node.min_integer = std::min(node.min_integer, number);
+      if (number > 0) {
+        node.max_integer =
+            std::max(node.max_integer, static_cast<std::uint64_t>(number));
+      }
+    } else if (value.is_number_float()) {
+      const double number = value.get<double>();
+      node.wide_doubles |=
+          !(std::fabs(number) <= std::numeric_limits<float>::max()) ||
+          static_cast<double>(static_cast<float>(number)) != number;
+    }
+    UpdateSample(node.samples[kind], value);
+    if (kind == kString) {
+      ++node.strings;
+      if (!node.many_values) {
+        node.values.insert(value.get_ref<const std::string&>());
+        LimitValues(node);
+      }
+    }
+  }
+}
+
+void SchemaInference::LimitValues(Node& node) {
+  if (node.values.size() > kMaxEnumValues) {
+    node.values.clear();
+    node.many_values = true;
+  }
+}
+
+void SchemaInference::Merge(Node& node, const Node& other) {
+  node.kinds |= other.kinds;
+  node.negative |= other.negative;
+  node.present += other.present;
+  node.nulls += other.nulls;
+  node.objects += other.objects;
+  node.strings += other.strings;
+  node.many_values |= other.many_values;
+  node.min_integer = std::min(node.min_integer, other.min_integer);
+  node.max_integer = std::max(node.max_integer, other.max_integer);
+  node.wide_doubles |= other.wide_doubles;
+  if (node.many_values) {
+    node.values.clear();
+  } else {
+    node.values.insert(other.values.begin(), other.values.end());
+    LimitValues(node);
+  }
+  for (int kind = 0; kind < kKindCount; ++kind) {
+    UpdateSample(node.samples[kind], other.samples[kind]);
+  }
+  for (const auto& field : other.fields) {
+    std::unique_ptr<Node>& merged = node.fields[field.first];
+    if (!merged) {
+      merged = std::make_unique<Node>();
+    }
+    Merge(*merged, *field.second);
+  }
+  if (other.element) {
+    if (!node.element) {
+      node.element = std::make_unique<Node>();
+    }
+    Merge(*node.element, *other.element);
+  }
+}
+
+json SchemaInference::Sample(const Node& node) {
+  // Containers win over scalars because the generated readers skip values
+  // of the wrong container type; strings win over numbers and numbers over
+  // booleans for the same reason
+  const unsigned kinds = node.kinds & ~Bit(kNull);
+  if (kinds & Bit(kObject)) {
+    json object = json::object();
+    for (const auto& field : node.fields) {
+      object[field.first] = Sample(*field.second);
+    }
+    return object;
+  } else if (kinds & Bit(kArray)) {
+    json array = json::array();
+    if (node.element && (node.element->kinds & ~Bit(kNull))) {
+      array.push_back(Sample(*node.element));
+    }
+    return array;
+  } else if (kinds & Bit(kString)) {
+    return node.samples[kString];
+  } else if ((kinds & Bit(kDouble)) ||
+             ((kinds & Bit(kUInt64)) && node.negative)) {
+    // No integer type holds both negative values and ones above INT64_MAX
+    return node.samples[kDouble].is_null() ? json(0.0)
+                                           : node.samples[kDouble];
+  }
+  for (Kind kind : {kUInt64, kInt64, kInt32, kBool}) {
+    if (kinds & Bit(kind)) {
+      return node.samples[kind];
+    }
+  }
+  return nullptr;
+}
+
+void SchemaInference::Report(std::ostream& out,
+                             const Node& node,
+                             const std::string& path,
+                             std::uint64_t parent_objects) {
+  for (const auto& field : node.fields) {
+    const Node& child = *field.second;
+    const std::string child_path =
+        path.empty() ? field.first : path + "." + field.first;
+    out << "  " << child_path << ": " << KindNames(child.kinds);
+    if (child.present < parent_objects) {
+      out << ", absent in " << parent_objects - child.present << " of "
+          << parent_objects;
+    }
+    if (child.nulls != 0) {
+      out << ", null in " << child.nulls;
+    }
+    out << "\n";
+    Report(out, child, child_path, child.objects);
+    if (child.element) {
+      Report(out, *child.element, child_path + "[]", child.element->objects);
+    }
+  }
+}
+
+std::map<std::string, std::vector<std::string>> SchemaInference::Enums(
+    std::size_t max_values) const {
+  std::map<std::string, std::vector<std::string>> enums;
+  Enums(*root_, "", max_values, enums);
+  return enums;
+}
+
+void SchemaInference::Enums(
+    const Node& node,
+    const std::string& path,
+    std::size_t max_values,
+    std::map<std::string, std::vector<std::string>>& enums) {
+  for (const auto& field : node.fields) {
+    const Node& child = *field.second;
+    const std::string child_path = path + field.first;
+    if ((child.kinds & ~Bit(kNull)) == Bit(kString) && !child.many_values &&
+        child.values.size() <= max_values &&
+        child.strings >= 2 * child.values.size()) {
+      enums[child_path].assign(child.values.begin(), child.values.end());
+    }
+    Enums(child, child_path + ".", max_values, enums);
+    std::string element_path = child_path;
+    for (const Node* element = child.element.get(); element != nullptr;
+         element = element->element.get()) {
+      element_path += "[]";
+      Enums(*element, element_path + ".", max_values, enums);
+    }
+  }
+}
+
+std::map<std::string, std::string> SchemaInference::NumberTypes() const {
+  std::map<std::string, std::string> types;
+  NumberTypes(*root_, "", types);
+  return types;
+}
+
+void SchemaInference::NumberTypes(const Node& node,
+                                  const std::string& path,
+                                  std::map<std::string, std::string>& types) {
+  for (const auto& field : node.fields) {
+    const Node& child = *field.second;
+    const std::string child_path = path + field.first;
+    NumberTypes(child, child_path + ".", types);
+    std::string element_path = child_path;
+    for (const Node* element = child.element.get(); element != nullptr;
+         element = element->element.get()) {
+      element_path += "[]";
+      NumberTypes(*element, element_path + ".", types);
+    }
+
+    // Arrays of numbers are typed by their innermost elements, as Sample
+    // picks containers over scalars
+    const Node* leaf = &child;
+    while ((leaf->kinds & Bit(kArray)) && !(leaf->kinds & Bit(kObject)) &&
+           leaf->element) {
+      leaf = leaf->element.get();
+    }
+    const unsigned kinds = leaf->kinds & ~Bit(kNull);
+    const unsigned numbers =
+        Bit(kBool) | Bit(kInt32) | Bit(kInt64) | Bit(kUInt64) | Bit(kDouble);
+    if (kinds == 0 || (kinds & ~numbers) || kinds == Bit(kBool)) {
+      continue;
+    }
+    if ((kinds & Bit(kDouble)) || ((kinds & Bit(kUInt64)) && leaf->negative)) {
+      // Floats hold every integer up to 2^24 exactly
+      constexpr std::int64_t kFloatIntegers = std::int64_t{1} << 24;
+      if (!leaf->wide_doubles && leaf->min_integer >= -kFloatIntegers &&
+          leaf->max_integer <= static_cast<std::uint64_t>(kFloatIntegers)) {
+        types[child_path] = "float";
+      }
+      continue;
+    }
+    // Types narrower than the int64 or uint64 of a wide sample; int32 is the
+    // type of narrow samples already
+    const std::int64_t min = std::min<std::int64_t>(leaf->min_integer, 0);
+    const std::uint64_t max = leaf->max_integer;
+    if (min >= std::numeric_limits<std::int8_t>::min() &&
+        max <= std::numeric_limits<std::int8_t>::max()) {
+      types[child_path] = "int8";
+    } else if (min == 0 && max <= std::numeric_limits<std::uint8_t>::max()) {
+      types[child_path] = "uint8";
+    } else if (min >= std::numeric_limits<std::int16_t>::min() &&
+               max <= std::numeric_limits<std::int16_t>::max()) {
+      types[child_path] = "int16";
+    } else if (min == 0 && max <= std::numeric_limits<std::uint16_t>::max()) {
+      types[child_path] = "uint16";
+    } else if (min == 0 && max <= std::numeric_limits<std::uint32_t>::max() &&
+               max > static_cast<std::uint64_t>(
+                         std::numeric_limits<std::int32_t>::max())) {
+      types[child_path] = "uint32";
+    }
+  }
+}
+
+bool InferCorpus(const std::string& path,
+                 unsigned threads,
+                 SchemaInference& schema) {
+  namespace fs = std::filesystem;
+  std::vector<CorpusTask> tasks;
+  std::error_code error;
+  if (fs::is_directory(path, error)) {
+    for (fs::recursive_directory_iterator it(path, error), end;
+         !error && it != end; it.increment(error)) {
+      if (!it->is_regular_file(error)) {
+        continue;
+      }
+      const fs::path& file = it->path();
+      const fs::path extension = file.extension();
+      if (extension == ".json") {
+        tasks.push_back({file.string(), false, 0, 0});
+      } else if ((extension == ".ndjson" || extension == ".jsonl") &&
+                 !AddLineTasks(file, threads, tasks)) {
+        return false;
+      }
+    }
+  } else if (!AddLineTasks(path, threads, tasks)) {
+    return false;
+  }
+  if (error) {
+    return false;
+  }
+
+  // Every thread merges into its own schema; the schemas are combined at the
+  // end, so memory does not grow with the size of the corpus
+  threads = static_cast<unsigned>(
+      std::max<std::size_t>(1, std::min<std::size_t>(threads, tasks.size())));
+  std::vector<SchemaInference> partial(threads);
+  std::atomic<std::size_t> next_task{0};
+  std::atomic<bool> failed{false};
+  auto work = [&tasks, &next_task, &failed](SchemaInference& result) {
+    for (std::size_t i = next_task++; i < tasks.size() && !failed;
+         i = next_task++) {
+      if (!RunTask(tasks[i], result)) {
+        failed = true;
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < threads; ++i) {
+    try {
+      workers.emplace_back(work, std::ref(partial[i]));
+    } catch (const std::system_error&) {
+      break;
+    }
+  }
+  work(partial[0]);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  for (const SchemaInference& result : partial) {
+    schema.Merge(result);
+  }
+  return !failed;
+}
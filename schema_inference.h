@@ -0,0 +1,96 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SCHEMA_INFERENCE_H_
+#define SCHEMA_INFERENCE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Merges the types of many sample documents into one sample for the
+// generator. Every field keeps the set of kinds seen for it, how often it
+// was present and null, and one representative value per kind, so the
+// memory used depends on the schema and not on the number of documents.
+class SchemaInference {
+ public:
+  SchemaInference();
+  ~SchemaInference();
+
+  // Adds one document. Documents that are not objects are counted as
+  // malformed.
+  void Add(const json& document);
+
+  // Counts a document that could not be parsed.
+  void AddMalformed();
+
+  // Merges the schema accumulated by |other| into this one. The result does
+  // not depend on the order in which documents were added or merged.
+  void Merge(const SchemaInference& other);
+
+  // Returns a sample document whose values have the merged types: integers
+  // widen from int to std::int64_t, std::uint64_t and double, array elements
+  // are merged across all arrays, and objects get the union of their keys.
+  json Sample() const;
+
+  // Writes the merged kinds of every field, and which fields were absent or
+  // null in some documents.
+  void Report(std::ostream& out) const;
+
+  // Returns the fields that only hold strings, with at most |max_values|
+  // distinct values that were each seen twice on average, and their sorted
+  // values. Fields are named by their path, such as "meta.region" or
+  // "items[].kind". At most kMaxEnumValues values are tracked per field.
+  std::map<std::string, std::vector<std::string>> Enums(
+      std::size_t max_values) const;
+
+  static constexpr std::size_t kMaxEnumValues = 256;
+
+  // Returns the number fields, and the number arrays, whose values all fit
+  // in a narrower type than the one of their sample, with the name of that
+  // type: "int8", "uint8", "int16", "uint16", "uint32" or "float". Doubles
+  // become floats only if every value is exactly a float.
+  std::map<std::string, std::string> NumberTypes() const;
+
+  std::uint64_t documents() const;
+  std::uint64_t malformed() const { return malformed_; }
+
+ private:
+  struct Node;
+
+  static void Add(Node& node, const json& value);
+  static void Merge(Node& node, const Node& other);
+  static void LimitValues(Node& node);
+  static json Sample(const Node& node);
+  static void Report(std::ostream& out,
+                     const Node& node,
+                     const std::string& path,
+                     std::uint64_t parent_objects);
+  static void Enums(const Node& node,
+                    const std::string& path,
+                    std::size_t max_values,
+                    std::map<std::string, std::vector<std::string>>& enums);
+  static void NumberTypes(const Node& node,
+                          const std::string& path,
+                          std::map<std::string, std::string>& types);
+
+  std::unique_ptr<Node> root_;
+  std::uint64_t malformed_ = 0;
+};
+
+// Infers the schema of a corpus with |threads| threads. |path| is either an
+// NDJSON file or a directory, in which every .json file is one document and
+// every .ndjson and .jsonl file holds one document per line.
+// Returns: false if a file of the corpus cannot be read.
+bool InferCorpus(const std::string& path,
+                 unsigned threads,
+                 SchemaInference& schema);
+
+#endif  // SCHEMA_INFERENCE_H_
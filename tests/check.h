@@ -0,0 +1,37 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef JSON2CLASS_TESTS_CHECK_H_
+#define JSON2CLASS_TESTS_CHECK_H_
+
+#include <iostream>
+
+// The tests report every failed check and return their number from main.
+inline int check_failures = 0;
+
+#define CHECK(condition)                                                  \
+  do {                                                                    \
+    if (!(condition)) {                                                   \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition   \
+                << ") failed" << std::endl;                               \
+      ++check_failures;                                                   \
+    }                                                                     \
+  } while (0)
+
+#define CHECK_THROWS(statement, exception)                                \
+  do {                                                                    \
+    bool thrown = false;                                                  \
+    try {                                                                 \
+      statement;                                                          \
+    } catch (const exception&) {                                          \
+      thrown = true;                                                      \
+    }                                                                     \
+    if (!thrown) {                                                        \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": " #statement         \
+                << " did not throw " #exception << std::endl;             \
+      ++check_failures;                                                   \
+    }                                                                     \
+  } while (0)
+
+#endif  // JSON2CLASS_TESTS_CHECK_H_
@@ -0,0 +1,100 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// String interning. record.h is generated with --intern --ndjson.
+
+#include <string>
+#include <string_view>
+
+#include "check.h"
+#include "empty_record.h"
+#include "record.h"
+
+namespace {
+
+const char kDocument[] =
+    R"({"name":"bob","tags":["eu","bob"],"meta":{"host":"eu"},)"
+    R"("items":[{"kind":"bob"}]})";
+
+void TestWithoutPool() {
+  static_assert(sizeof(json2class::InternedString) ==
+                sizeof(std::string_view));
+  // Outside of any scope each string owns a copy, which its copies share
+  record r;
+  CHECK(r.name() == "ann");
+  r.FromJsonString(kDocument);
+  CHECK(r.name() == "bob" && r.tags()[1] == "bob");
+  CHECK(r.name().data() != r.tags()[1].data());
+  const record copy = r;
+  CHECK(copy.name().data() == r.name().data());
+  r.set_name("al");
+  CHECK(r.name() == "al" && copy.name() == "bob");
+  r.Clear();
+  CHECK(copy.ToJson() == record(json::parse(kDocument)).ToJson());
+
+  const json2class::NdjsonBatch<record> batch =
+      record::ParseNdjson(R"({"name":"bob"})" "\n" R"({"name":"eu"})" "\n", 2);
+  CHECK(batch.records.size() == 2 && batch.errors.empty());
+  CHECK(batch.records[0].name() == "bob" && batch.records[1].name() == "eu");
+}
+
+void TestSharedStrings() {
+  json2class::InternPool pool;
+  record a;
+  record b;
+  a.FromJsonString(kDocument, pool);
+  b.FromJson(json::parse(kDocument), pool);
+  CHECK(a.ToJson() == b.ToJson());
+  CHECK(pool.size() == 2);
+  CHECK(a.name().data() == b.name().data());
+  CHECK(a.name().data() == a.tags()[1].data());
+  CHECK(a.meta().host().data() == b.tags()[0].data());
+  CHECK(a.items()[0].kind() == a.name());
+
+  {
+    json2class::InternScope scope(pool);
+    a.set_name("eu");
+    CHECK(a.name().data() == b.meta().host().data());
+    CHECK(pool.size() == 2);
+  }
+
+  std::string text;
+  a.ToJsonString(text);
+  CHECK(json::parse(text)["name"] == "eu");
+  CHECK(json::parse(text)["tags"] == json::parse(kDocument)["tags"]);
+}
+
+void TestNdjsonPool() {
+  json2class::InternPool pool;
+  std::string buffer;
+  for (int i = 0; i < 200; ++i) {
+    buffer += R"({"name":"n)" + std::to_string(i % 3) + R"("})" "\n";
+  }
+  const json2class::NdjsonBatch<record> batch =
+      record::ParseNdjson(buffer, 4, pool);
+  CHECK(batch.records.size() == 200 && batch.errors.empty());
+  CHECK(pool.size() == 3);
+  CHECK(batch.records[0].name().data() == batch.records[150].name().data());
+
+  json2class::InternScope scope(pool);
+  const json2class::NdjsonBatch<record> again = record::ParseNdjson(buffer, 2);
+  CHECK(again.records.size() == 200 && pool.size() == 3);
+}
+
+void TestEmptyClass() {
+  empty_record e;
+  e.FromJsonString(R"({"name":"x"})");
+  CHECK(e.TryFromJson(json::array()).code ==
+        json2class::StatusCode::kTypeError);
+}
+
+}  // namespace
+
+int main() {
+  TestWithoutPool();
+  TestSharedStrings();
+  TestNdjsonPool();
+  TestEmptyClass();
+  return check_failures == 0 ? 0 : 1;
+}
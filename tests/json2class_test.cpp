@@ -0,0 +1,536 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Round trips and error paths of eager classes. record.h is generated with
+// --enum region=eu,us --ndjson --mmap --binary --flat --columns and a compact
+// layout with an int8 level; corpus_record.h is inferred from corpus.ndjson
+// with --enums --compact-layout.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "check.h"
+#include "corpus_record.h"
+#include "empty_record.h"
+#include "record.h"
+
+// Counts the allocations of the test, to check that recycled objects do not
+// allocate.
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size != 0 ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+// GCC sees the std::free of an inlined operator delete as freeing memory from
+// operator new.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+
+const char kDocument[] =
+    R"({"name":"bob","region":"us","age":41,"level":-7,"ratio":0.25,)"
+    R"("active":false,"tags":["x","y\"z"],"meta":{"host":"h2","port":8080},)"
+    R"("items":[{"kind":"a","count":2},{"kind":"b","count":3}]})";
+
+void WriteFile(const std::string& path, const std::string& text) {
+  std::ofstream out(path, std::ios::binary);
+  out << text;
+}
+
+void TestSaxRoundTrip() {
+  record r;
+  r.FromJsonString(R"({"unknown":{"a":[1,2]},)" + std::string(kDocument + 1));
+  CHECK(r.name() == "bob");
+  CHECK(r.region() == record::region_enum::kUs);
+  CHECK(r.age() == 41);
+  CHECK(r.level() == -7);
+  CHECK(r.tags().size() == 2 && r.tags()[1] == "y\"z");
+  CHECK(r.meta().port() == 8080);
+  CHECK(r.items().size() == 2 && r.items()[1].kind() == "b");
+  CHECK(r.ToJson() == json::parse(kDocument));
+
+  record from_stream;
+  std::istringstream in(kDocument);
+  from_stream.FromJsonStream(in);
+  CHECK(from_stream.ToJson() == r.ToJson());
+
+  record copy(json::parse(kDocument));
+  CHECK(copy.ToJson() == r.ToJson());
+}
+
+void TestFieldIndex() {
+  CHECK(record::FieldIndex("name") == static_cast<int>(record::Field::name));
+  CHECK(record::FieldIndex("tags") == static_cast<int>(record::Field::tags));
+  CHECK(record::FieldIndex("nam") == -1);
+  CHECK(record::FieldIndex("") == -1);
+
+  // Keys that hash to no field or to another field are skipped
+  record r;
+  r.FromJson(json::parse(R"({"nam":"x","names":"y","age":5})"));
+  CHECK(r.name() == "ann" && r.age() == 5);
+}
+
+void TestFieldMask() {
+  const record::FieldMask mask({record::Field::age, record::Field::meta});
+  record r;
+  r.FromJsonString(kDocument, mask);
+  CHECK(r.age() == 41 && r.meta().port() == 8080);
+  CHECK(r.name() == "ann" && r.tags() == record().tags());
+
+  record from_json;
+  from_json.FromJson(json::parse(kDocument), mask);
+  CHECK(from_json.ToJson() == r.ToJson());
+
+  // Unrequested fields are not type-checked
+  r.FromJsonString(R"({"name":5,"age":7})", mask);
+  CHECK(r.age() == 7);
+  CHECK_THROWS(r.FromJsonString(R"({"age":"x"})", mask), json::type_error);
+  CHECK_THROWS(r.FromJsonString(R"({"name":"a","age":)", mask),
+               json::parse_error);
+
+  // Skipped values are still checked token by token
+  r.FromJsonString(
+      R"({"x":[-0.5e+3,true,false,null,{"y":"z"}],"name":1E2,"age":8})", mask);
+  CHECK(r.age() == 8);
+  CHECK_THROWS(r.FromJsonString(R"({"x":tru,"age":1})", mask),
+               json::parse_error);
+  CHECK_THROWS(r.FromJsonString(R"({"name":[1,nul],"age":1})", mask),
+               json::parse_error);
+  CHECK_THROWS(r.FromJsonString(R"({"name":01,"age":1})", mask),
+               json::parse_error);
+  CHECK_THROWS(r.FromJsonString(R"({"name":1.,"age":1})", mask),
+               json::parse_error);
+}
+
+void TestMoves() {
+  const std::string kLong(64, 'n');
+  json j = json::parse(kDocument);
+  j["name"] = kLong;
+  j["tags"][0] = kLong;
+  const char* name = j["name"].get_ref<const std::string&>().data();
+  const char* tag = j["tags"][0].get_ref<const std::string&>().data();
+
+  // Strings are moved out of the json value instead of being copied
+  record r;
+  r.FromJson(std::move(j));
+  CHECK(r.name() == kLong && r.name().data() == name);
+  CHECK(r.tags()[0].data() == tag);
+  CHECK(r.items().size() == 2 && r.items()[1].kind() == "b");
+
+  json k = json::parse(kDocument);
+  k["name"] = kLong;
+  name = k["name"].get_ref<const std::string&>().data();
+  const record constructed(std::move(k));
+  CHECK(constructed.name().data() == name);
+
+  std::string value(kLong);
+  name = value.data();
+  r.set_name(std::move(value));
+  CHECK(r.name().data() == name);
+  std::vector<std::string> tags = {"p", "q"};
+  const std::string* tags_data = tags.data();
+  r.set_tags(std::move(tags));
+  CHECK(r.tags().data() == tags_data);
+
+  // A rejected value throws like FromJson(const json&)
+  CHECK_THROWS(r.FromJson(json::parse(R"({"age":"x"})")), json::type_error);
+}
+
+void TestReuse() {
+  const json document = json::parse(kDocument);
+  record r;
+  r.FromJson(document);
+  r.set_name(std::string(64, 'n'));
+  const char* name = r.name().data();
+
+  // Reparse gives the same result as a new object
+  const json partial = json::parse(R"({"name":"al","tags":["t"]})");
+  r.Reparse(partial);
+  CHECK(r.ToJson() == record(partial).ToJson());
+  CHECK(r.name().data() == name);
+
+  // A recycled object parses a document of the same shape without allocating
+  r.Reparse(document);
+  std::size_t before = allocations;
+  r.Reparse(document);
+  r.FromJson(document);
+  CHECK(allocations == before);
+  CHECK(r.ToJson() == document);
+
+  // Clear keeps the memory too
+  before = allocations;
+  r.Clear();
+  CHECK(allocations == before);
+  CHECK(r.ToJson() == record().ToJson());
+  CHECK(r.name().data() == name);
+  r.Reparse(json::array());
+  CHECK(r.ToJson() == record().ToJson());
+}
+
+void TestTryStatus() {
+  record r;
+  CHECK(r.TryFromJsonString(kDocument).ok());
+  CHECK(r.name() == "bob");
+
+  json2class::ParseStatus status = r.TryFromJsonString(R"({"name":)");
+  CHECK(status.code == json2class::StatusCode::kSyntaxError);
+
+  status = r.TryFromJson(json::array({1, 2}));
+  CHECK(status.code == json2class::StatusCode::kTypeError);
+  CHECK(status.path.empty());
+
+  status = r.TryFromJsonString(R"({"meta":{"port":"80"}})");
+  CHECK(status.code == json2class::StatusCode::kTypeError);
+  CHECK(status.path == "/meta/port");
+
+  status = r.TryFromJsonString(R"({"items":[{},{"count":1.5}]})");
+  CHECK(status.code == json2class::StatusCode::kTypeError);
+  CHECK(status.path == "/items/1/count");
+
+  status = r.TryFromJsonString(R"({"age":1e300})");
+  CHECK(status.code == json2class::StatusCode::kTypeError);
+  CHECK(status.path == "/age");
+
+  status = r.TryFromJsonString(R"({"level":200})");
+  CHECK(status.code == json2class::StatusCode::kTypeError);
+  CHECK(status.path == "/level");
+
+  status = r.TryFromJsonString(R"({"region":"mars"})");
+  CHECK(status.code == json2class::StatusCode::kUnknownValue);
+  CHECK(status.path == "/region");
+}
+
+void TestThrowingReaders() {
+  record r;
+  CHECK_THROWS(r.FromJsonString(R"({"age":2.5})"), json::type_error);
+  CHECK_THROWS(r.FromJson(json::parse(R"({"age":3000000000})")),
+               json::type_error);
+  CHECK_THROWS(r.FromJsonString(R"({"level":-129})"), json::type_error);
+  CHECK_THROWS(r.FromJson(json::parse(R"({"level":128})")), json::type_error);
+  CHECK_THROWS(r.FromJsonString(R"({"name":)"), json::parse_error);
+  CHECK_THROWS(r.FromJsonString(R"({"region":"mars"})"), json::type_error);
+  CHECK_THROWS(r.FromJson(json::parse(R"({"region":"mars"})")),
+               json::type_error);
+}
+
+void TestWriter() {
+  record r;
+  r.FromJsonString(kDocument);
+  std::string text;
+  r.ToJsonString(text);
+  CHECK(json::parse(text) == json::parse(kDocument));
+
+  char buffer[512];
+  const std::size_t size = r.ToJsonString(buffer, sizeof(buffer));
+  CHECK(std::string(buffer, size) == text);
+  // A buffer that is too small gets a prefix and the full size
+  char small[8];
+  CHECK(r.ToJsonString(small, sizeof(small)) == text.size());
+  CHECK(std::string(small, sizeof(small)) == text.substr(0, sizeof(small)));
+
+  r.set_name("\x01\u00e9\n");
+  r.set_ratio(1e-7);
+  r.ToJsonString(text);
+  CHECK(json::parse(text) == r.ToJson());
+}
+
+void TestElementClasses() {
+  static_assert(std::is_same_v<decltype(record().items()),
+                               std::vector<record::items_item_type>&>);
+  record r;
+  r.FromJsonString(kDocument);
+  CHECK(r.items().size() == 2);
+  CHECK(r.items()[0].kind() == "a" && r.items()[0].count() == 2);
+
+  // Elements are parsed in place, and each one on its own
+  r.FromJson(json::parse(R"({"items":[{"count":5},{"kind":"c"}]})"));
+  CHECK(r.items().size() == 2);
+  CHECK(r.items()[0].count() == 5 && r.items()[0].kind() == "x");
+  CHECK(r.items()[1].kind() == "c" && r.items()[1].count() == 1);
+
+  record::items_item_type item(json::parse(R"({"kind":"d","count":4})"));
+  r.set_items({item});
+  CHECK(r.ToJson()["items"] == json::parse(R"([{"kind":"d","count":4}])"));
+}
+
+void TestStream() {
+  record r;
+  std::vector<std::string> kinds;
+  CHECK(r.StreamItems(kDocument, [&kinds](record::items_item_type&& item) {
+    kinds.push_back(item.kind());
+  }));
+  CHECK(kinds == std::vector<std::string>({"a", "b"}));
+  // The other fields are filled, the streamed one is not stored
+  CHECK(r.name() == "bob" && r.meta().port() == 8080);
+  CHECK(r.items().empty());
+
+  std::istringstream in(kDocument);
+  std::vector<std::string> tags;
+  CHECK(!r.StreamTags(in, [&tags](std::string&& tag) {
+    tags.push_back(std::move(tag));
+    return false;
+  }));
+  CHECK(tags == std::vector<std::string>({"x"}));
+
+  CHECK_THROWS(r.StreamTags(R"({"tags":[1]})", [](std::string&&) {}),
+               json::type_error);
+}
+
+void TestNdjson() {
+  std::string buffer;
+  for (int i = 0; i < 100; ++i) {
+    buffer += R"({"age":)" + std::to_string(i) + "}\n";
+    if (i == 10) {
+      buffer += R"({"region":"mars"})" "\n";
+    }
+    if (i == 20) {
+      buffer += "\n{\"age\":\n";
+    }
+    // Values other than objects are errors, not default records
+    if (i == 30) {
+      buffer += "5\n";
+    }
+    if (i == 40) {
+      buffer += " [1]\n";
+    }
+  }
+  for (unsigned threads : {1u, 4u}) {
+    const json2class::NdjsonBatch<record> batch =
+        record::ParseNdjson(buffer, threads);
+    CHECK(batch.records.size() == 100);
+    for (std::size_t i = 0; i < batch.records.size(); ++i) {
+      CHECK(batch.records[i].age() == static_cast<int>(i));
+    }
+    CHECK(batch.errors.size() == 4);
+    if (batch.errors.size() == 4) {
+      CHECK(batch.errors[0].line == 12);
+      CHECK(batch.errors[1].line == 24);
+      CHECK(batch.errors[2].line == 35);
+      CHECK(batch.errors[3].line == 46);
+      CHECK(batch.errors[3].message.find("array") != std::string::npos);
+    }
+  }
+}
+
+void TestFiles() {
+  WriteFile("json2class_test.json", kDocument);
+  record r;
+  r.FromFile("json2class_test.json");
+  CHECK(r.ToJson() == json::parse(kDocument));
+  CHECK_THROWS(r.FromFile("json2class_test_missing.json"), std::system_error);
+
+  WriteFile("json2class_test.ndjson",
+            std::string(kDocument) + "\n" + kDocument + "\n");
+  const json2class::NdjsonBatch<record> batch =
+      record::ParseNdjsonFile("json2class_test.ndjson", 2);
+  CHECK(batch.records.size() == 2 && batch.errors.empty());
+
+  // Empty files map to an empty view
+  WriteFile("json2class_test.ndjson", "");
+  CHECK(record::ParseNdjsonFile("json2class_test.ndjson", 2).records.empty());
+  std::remove("json2class_test.json");
+  std::remove("json2class_test.ndjson");
+}
+
+void TestBinary() {
+  record r;
+  r.FromJsonString(kDocument);
+
+  std::vector<std::uint8_t> msgpack;
+  r.ToMsgPack(msgpack);
+  CHECK(msgpack == json::to_msgpack(json::parse(kDocument)));
+  record from_msgpack;
+  from_msgpack.FromMsgPack(msgpack.data(), msgpack.size());
+  CHECK(from_msgpack.ToJson() == r.ToJson());
+
+  std::vector<std::uint8_t> cbor;
+  r.ToCbor(cbor);
+  CHECK(cbor == json::to_cbor(json::parse(kDocument)));
+  record from_cbor;
+  from_cbor.FromCbor(cbor.data(), cbor.size());
+  CHECK(from_cbor.ToJson() == r.ToJson());
+
+  const std::vector<std::uint8_t> wrong =
+      json::to_msgpack(json::parse(R"({"age":"x"})"));
+  CHECK_THROWS(from_msgpack.FromMsgPack(wrong.data(), wrong.size()),
+               json::type_error);
+  // Numbers that do not fit the narrowed member are rejected
+  const std::vector<std::uint8_t> wide =
+      json::to_msgpack(json::parse(R"({"level":300})"));
+  CHECK_THROWS(from_msgpack.FromMsgPack(wide.data(), wide.size()),
+               json::type_error);
+  const std::vector<std::uint8_t> unknown =
+      json::to_cbor(json::parse(R"({"region":"mars"})"));
+  CHECK_THROWS(from_cbor.FromCbor(unknown.data(), unknown.size()),
+               json::type_error);
+  cbor.pop_back();
+  CHECK_THROWS(from_cbor.FromCbor(cbor.data(), cbor.size()),
+               json::parse_error);
+}
+
+void TestFlat() {
+  record r;
+  r.FromJsonString(kDocument);
+  std::string snapshot;
+  r.Build(snapshot);
+
+  const record::View view = record::View::Open(snapshot);
+  CHECK(view.name() == "bob");
+  CHECK(view.region() == "us");
+  CHECK(view.level() == -7);
+  CHECK(view.ratio() == 0.25);
+  CHECK(!view.active());
+  CHECK(view.tags().size() == 2 && view.tags()[1] == "y\"z");
+  CHECK(view.meta().port() == 8080);
+  CHECK(view.items().size() == 2 && view.items()[1].count() == 3);
+
+  snapshot[8] = static_cast<char>(snapshot[8] ^ 1);
+  CHECK_THROWS(record::View::Open(snapshot), std::runtime_error);
+  CHECK_THROWS(record::View::Open(snapshot.substr(0, 4)), std::runtime_error);
+}
+
+void TestColumns() {
+  record_columns columns;
+  columns.append(json::parse(kDocument));
+  record r;
+  columns.append(r);
+  CHECK(columns.size() == 2);
+  CHECK(columns.age()[0] == 41 && columns.age()[1] == 30);
+  CHECK(columns.meta_port()[0] == 8080);
+  CHECK(columns.region()[1] == record::region_enum::kEu);
+  CHECK(!columns.active()[0] && columns.active()[1]);
+
+  int total = 0;
+  for (int age : columns.age().span()) {
+    total += age;
+  }
+  CHECK(total == 71);
+  CHECK(columns.row(0).ToJson() == json::parse(kDocument));
+  CHECK(columns.row(1).ToJson() == r.ToJson());
+}
+
+void TestEnums() {
+  static_assert(sizeof(record::region_enum) == 1);
+  CHECK(ToString(record::region_enum::kEu) == "eu");
+  record::region_enum region;
+  CHECK(FromString("us", region) && region == record::region_enum::kUs);
+  CHECK(!FromString("mars", region));
+  CHECK(!FromString("", region));
+
+  record r;
+  r.set_region(record::region_enum::kUs);
+  CHECK(r.ToJson()["region"] == "us");
+  std::string text;
+  r.ToJsonString(text);
+  CHECK(json::parse(text)["region"] == "us");
+}
+
+void TestCompactLayout() {
+  static_assert(std::is_same_v<decltype(record().level()), std::int8_t&>);
+  static_assert(std::is_same_v<decltype(record().age()), int&>);
+
+  record r;
+  r.set_level(-128);
+  std::string text;
+  r.ToJsonString(text);
+  CHECK(json::parse(text)["level"] == -128);
+  CHECK(record(json::parse(text)).level() == -128);
+}
+
+void TestCorpusInference() {
+  // Fields and values are merged from every valid line of the corpus, and
+  // numbers take the smallest type that holds every value seen
+  static_assert(std::is_same_v<decltype(corpus_record().id()), std::uint8_t&>);
+  static_assert(std::is_same_v<decltype(corpus_record().price()), float&>);
+  static_assert(std::is_same_v<decltype(corpus_record().note()),
+                               std::string&>);
+  static_assert(std::is_same_v<decltype(corpus_record().kind()),
+                               corpus_record::kind_enum&>);
+  static_assert(
+      std::is_same_v<decltype(corpus_record().seller().rating()),
+                     std::int8_t&>);
+
+  corpus_record r;
+  r.FromJsonString(
+      R"({"id":255,"kind":"pen","price":3.5,"tags":["a"],)"
+      R"("seller":{"name":"cy","rating":-1}})");
+  CHECK(r.id() == 255);
+  CHECK(r.kind() == corpus_record::kind_enum::kPen);
+  CHECK(r.price() == 3.5f);
+  CHECK(r.tags().size() == 1 && r.seller().rating() == -1);
+  // Kinds outside the corpus are rejected
+  CHECK(r.TryFromJsonString(R"({"kind":"cup"})").code ==
+        json2class::StatusCode::kUnknownValue);
+  CHECK(r.TryFromJsonString(R"({"id":256})").path == "/id");
+}
+
+void TestEmptyClass() {
+  empty_record e;
+  e.FromJsonString(R"({"unknown":[1,2]})");
+  e.FromJson(json::parse("{}"));
+  CHECK(e.ToJson() == json::object());
+  std::string text;
+  e.ToJsonString(text);
+  CHECK(text == "{}");
+
+  std::vector<std::uint8_t> msgpack;
+  e.ToMsgPack(msgpack);
+  CHECK(json::from_msgpack(msgpack) == json::object());
+  e.FromMsgPack(msgpack.data(), msgpack.size());
+  std::string snapshot;
+  e.Build(snapshot);
+  empty_record::View::Open(snapshot);
+
+  empty_record_columns columns;
+  columns.reserve(2);
+  columns.append(e);
+  CHECK(columns.size() == 1 && columns.row(0).ToJson() == json::object());
+}
+
+}  // namespace
+
+int main() {
+  TestSaxRoundTrip();
+  TestFieldIndex();
+  TestFieldMask();
+  TestMoves();
+  TestReuse();
+  TestTryStatus();
+  TestThrowingReaders();
+  TestWriter();
+  TestElementClasses();
+  TestStream();
+  TestNdjson();
+  TestFiles();
+  TestBinary();
+  TestFlat();
+  TestColumns();
+  TestEnums();
+  TestCompactLayout();
+  TestCorpusInference();
+  TestEmptyClass();
+  return check_failures == 0 ? 0 : 1;
+}
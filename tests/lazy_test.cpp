@@ -0,0 +1,295 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Indexing, passthrough and modification tracking of lazy classes. record.h
+// is generated with --lazy-parsing --ndjson --flat --columns, or with
+// --thread-safe --string-view --ndjson when THREAD_SAFE is defined.
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "empty_record.h"
+#include "record.h"
+
+namespace {
+
+const char kDocument[] =
+    R"({"name":"bob","extra":{"deep":[1,{"x":null}]},"age":41,)"
+    R"("meta":{"host":"hé2","port":8080,"zone":"b"},)"
+    R"("items":[{"kind":"a","count":2,"weight":1.5}],"tags":["x","y\"z"]})";
+
+json Written(const record& r) {
+  std::string text;
+  r.ToJsonString(text);
+  return json::parse(text);
+}
+
+// Fields missing from kDocument come out with their defaults.
+json Expected() {
+  json expected = json::parse(kDocument);
+  const json defaults = record().ToJson();
+  for (auto it = defaults.begin(); it != defaults.end(); ++it) {
+    if (!expected.contains(it.key())) {
+      expected[it.key()] = it.value();
+    }
+  }
+  return expected;
+}
+
+void TestIndexing() {
+  record r;
+  r.FromJsonString(kDocument);
+  const record& view = r;
+  CHECK(view.name() == "bob" && view.age() == 41);
+  CHECK(view.meta().host() == "h\xc3\xa9" "2");
+  CHECK(view.items().size() == 1 && view.items()[0].count() == 2);
+  CHECK(view.tags().size() == 2 && view.tags()[1] == "y\"z");
+  CHECK(view.level() == 3);
+  CHECK(r.ToJson() == Expected());
+  CHECK(Written(r) == Expected());
+
+  // The object keeps its own reference to a shared buffer
+  auto source = std::make_shared<const std::string>(R"({"age":7})");
+  record shared;
+  shared.FromJsonBuffer(source);
+  source.reset();
+  const record& shared_view = shared;
+  CHECK(shared_view.age() == 7 && shared_view.name() == "ann");
+
+  // Parsing again replaces every field, read or not
+  r.FromJsonString(R"({"name":"al"})");
+  CHECK(view.name() == "al" && view.age() == 30);
+  CHECK(view.tags() == static_cast<const record&>(record()).tags());
+
+  // Copies keep the source
+  r.FromJsonString(kDocument);
+  const record copy = r;
+  r.FromJsonString("{}");
+  CHECK(copy.name() == "bob" && copy.meta().port() == 8080);
+
+  r.Clear();
+  CHECK(r.ToJson() == record().ToJson());
+
+  CHECK_THROWS(r.FromJsonString(R"({"name":)"), json::parse_error);
+}
+
+void TestMalformedReparse() {
+  record r;
+  r.FromJsonString(kDocument);
+  const record& view = r;
+  CHECK(view.name() == "bob");
+  r.set_age(5);
+  json expected = Expected();
+  expected["age"] = 5;
+
+  // A malformed document leaves the previous state intact, including the
+  // fields that were not read yet. This one is longer than kDocument, so
+  // that its offsets would point past the old source.
+  const std::string malformed = R"({"extra":")" + std::string(300, 'x') +
+                                R"(","name":"al","tags":["t"],"age":)";
+  CHECK_THROWS(r.FromJsonString(malformed), json::parse_error);
+  CHECK(view.name() == "bob" && view.age() == 5);
+  CHECK(view.tags().size() == 2 && view.tags()[1] == "y\"z");
+  CHECK(view.meta().port() == 8080 && view.items()[0].kind() == "a");
+  CHECK(Written(r) == expected);
+  CHECK(r.ToJson() == expected);
+}
+
+void TestModification() {
+  record r;
+  r.FromJsonString(kDocument);
+  json expected = Expected();
+  CHECK(Written(r) == expected);
+  CHECK(r.ToJson() == expected);
+
+  // Reading does not modify anything, nor does the non-const getter of a
+  // nested object
+  const record& view = r;
+  CHECK(view.name() == "bob" && view.age() == 41);
+  const record::meta_type& meta = r.meta();
+  CHECK(meta.host() == "h\xc3\xa9" "2");
+  CHECK(view.items().size() == 1 && view.items()[0].count() == 2);
+  CHECK(Written(r) == expected);
+
+  // Unknown keys of a nested object survive its modification
+  r.meta().set_port(9);
+  expected["meta"]["port"] = 9;
+  CHECK(Written(r) == expected);
+  CHECK(r.ToJson() == expected);
+
+  r.set_name("al");
+  r.mutable_age() += 1;
+  r.mutable_items()[0].set_count(5);
+  expected["name"] = "al";
+  expected["age"] = 42;
+  expected["items"][0]["count"] = 5;
+  CHECK(Written(r) == expected);
+  CHECK(r.ToJson() == expected);
+
+  // Copies keep the source and what was modified
+  const record copy = r;
+  r.FromJsonString("{}");
+  CHECK(Written(copy) == expected);
+
+  // Parsing again forgets the modifications
+  r.FromJsonString(kDocument);
+  CHECK(Written(r) == Expected());
+}
+
+// The deprecated non-const getters still mark their field modified.
+void TestDeprecatedGetters() {
+  record r;
+  r.FromJsonString(R"({"ratio":1.50})");
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#elif defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4996)
+#endif
+  CHECK(r.ratio() == 1.5);
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#elif defined(_MSC_VER)
+#pragma warning(pop)
+#endif
+  std::string text;
+  r.ToJsonString(text);
+  CHECK(text.find(R"("ratio":1.50)") == std::string::npos);
+  CHECK(json::parse(text)["ratio"] == 1.5);
+}
+
+void TestVerbatimFields() {
+  const char kText[] =
+      R"({"ratio":1.50,"meta":{"host":"h","zone":"b","port":8},"age":41})";
+  record r;
+  r.FromJsonString(kText);
+  const record& view = r;
+  CHECK(view.ratio() == 1.5);
+  std::string text;
+  r.ToJsonString(text);
+  CHECK(text.find(R"("ratio":1.50)") != std::string::npos);
+  CHECK(text.find(R"("meta":{"host":"h","zone":"b","port":8})") !=
+        std::string::npos);
+
+  // A nested object that was read writes itself, unknown keys included
+  CHECK(view.meta().port() == 8);
+  r.ToJsonString(text);
+  CHECK(json::parse(text)["meta"] == json::parse(kText)["meta"]);
+
+  r.set_ratio(2);
+  r.ToJsonString(text);
+  CHECK(text.find(R"("ratio":1.50)") == std::string::npos);
+  CHECK(json::parse(text)["ratio"] == 2.0);
+}
+
+void TestNdjson() {
+  std::string buffer;
+  for (int i = 0; i < 50; ++i) {
+    buffer += R"({"age":)" + std::to_string(i) + R"(,"other":)" +
+              std::to_string(i) + "}\n";
+  }
+  buffer += "{\"age\":\n\"text\"\n";
+  const json2class::NdjsonBatch<record> batch = record::ParseNdjson(buffer, 4);
+  CHECK(batch.records.size() == 50);
+  for (std::size_t i = 0; i < batch.records.size(); ++i) {
+    CHECK(batch.records[i].age() == static_cast<int>(i));
+    CHECK(Written(batch.records[i])["other"] == i);
+  }
+  CHECK(batch.errors.size() == 2);
+  CHECK(batch.errors[0].line == 51 && batch.errors.back().line == 52);
+}
+
+void TestEmptyClass() {
+  const char kUnknown[] = R"({"a":[1,2],"b":{"c":"d"}})";
+  empty_record e;
+  e.FromJsonString(kUnknown);
+  std::string text;
+  e.ToJsonString(text);
+  CHECK(json::parse(text) == json::parse(kUnknown));
+  CHECK(e.ToJson() == json::parse(kUnknown));
+  e.Clear();
+  e.ToJsonString(text);
+  CHECK(text == "{}");
+}
+
+#ifndef THREAD_SAFE
+void TestFlatAndColumns() {
+  record r;
+  r.FromJsonString(kDocument);
+  std::string snapshot;
+  r.Build(snapshot);
+  const record::View view = record::View::Open(snapshot);
+  CHECK(view.name() == "bob" && view.meta().port() == 8080);
+
+  record_columns columns;
+  columns.append(r);
+  CHECK(columns.size() == 1 && columns.meta_port()[0] == 8080);
+  CHECK(Written(r) == Expected());
+}
+#endif
+
+#ifdef THREAD_SAFE
+void TestConcurrentReads() {
+  auto source = std::make_shared<const std::string>(kDocument);
+  for (int round = 0; round < 20; ++round) {
+    record r;
+    r.FromJsonBuffer(source);
+    const record& shared = r;
+    std::vector<std::thread> readers;
+    std::vector<int> results(8);
+    for (int i = 0; i < 8; ++i) {
+      readers.emplace_back([&shared, &results, i] {
+        results[i] = shared.age() + static_cast<int>(shared.name().size()) +
+                     shared.meta().port() + shared.items()[0].count();
+      });
+    }
+    for (std::thread& reader : readers) {
+      reader.join();
+    }
+    for (int result : results) {
+      CHECK(result == 41 + 3 + 8080 + 2);
+    }
+  }
+}
+
+void TestStringViews() {
+  record r;
+  r.FromJsonString(kDocument);
+  const record copy = r;
+  // Setting a field again releases its previous strings
+  for (int i = 0; i < 100; ++i) {
+    r.set_name(std::string(64, 'n') + std::to_string(i));
+  }
+  r.set_name(r.name().substr(1));
+  CHECK(r.name() == std::string(63, 'n') + "99");
+  r.set_tags(r.tags());
+  CHECK(r.tags().size() == 2 && r.tags()[1] == "y\"z");
+  // Copies keep the strings they share
+  CHECK(copy.name() == "bob" && copy.tags()[1] == "y\"z");
+  CHECK(Written(copy) == Expected());
+}
+#endif
+
+}  // namespace
+
+int main() {
+  TestIndexing();
+  TestMalformedReparse();
+  TestModification();
+  TestDeprecatedGetters();
+  TestVerbatimFields();
+  TestNdjson();
+  TestEmptyClass();
+#ifdef THREAD_SAFE
+  TestConcurrentReads();
+  TestStringViews();
+#else
+  TestFlatAndColumns();
+#endif
+  return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Allocator-aware classes. record.h is generated with --pmr.
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+#include "check.h"
+#include "empty_record.h"
+#include "record.h"
+
+namespace {
+
+const char kDocument[] =
+    R"({"name":"a name that does not fit in the small string buffer",)"
+    R"("age":41,"tags":["x","y"],"meta":{"host":"h2","port":8080},)"
+    R"("items":[{"kind":"a","count":2},{"kind":"b","count":3}]})";
+
+// Counts the bytes allocated from it and passes the calls on.
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  std::size_t allocated = 0;
+
+ private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    allocated += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+void TestAllocator() {
+  CountingResource resource;
+  record r(json::parse(kDocument), &resource);
+  CHECK(r.name().get_allocator().resource() == &resource);
+  CHECK(r.items()[1].kind().get_allocator().resource() == &resource);
+  CHECK(r.meta().host().get_allocator().resource() == &resource);
+  CHECK(resource.allocated != 0);
+  CHECK(r.ToJson()["items"] == json::parse(kDocument)["items"]);
+
+  CountingResource other;
+  const record copy(r, &other);
+  CHECK(copy.name().get_allocator().resource() == &other);
+  CHECK(copy.ToJson() == r.ToJson());
+}
+
+void TestFromJsonResource() {
+  std::pmr::monotonic_buffer_resource arena;
+  record r;
+  r.set_level(9);
+  r.FromJson(json::parse(kDocument), &arena);
+  CHECK(r.age() == 41 && r.tags().size() == 2);
+  // Members the document does not contain are kept
+  CHECK(r.level() == 9);
+
+  // A rejected document leaves the object unchanged
+  const json before = r.ToJson();
+  CHECK_THROWS(r.FromJson(json::parse(R"({"age":"x"})"), &arena),
+               json::type_error);
+  CHECK(r.ToJson() == before);
+}
+
+void TestVectorElements() {
+  CountingResource resource;
+  std::pmr::vector<record> records(&resource);
+  records.emplace_back(json::parse(kDocument));
+  records.emplace_back();
+  CHECK(records[0].name().get_allocator().resource() == &resource);
+  CHECK(records[1].name().get_allocator().resource() == &resource);
+  CHECK(records[0].age() == 41 && records[1].age() == 30);
+}
+
+void TestEmptyClass() {
+  std::pmr::monotonic_buffer_resource arena;
+  empty_record e(&arena);
+  e.FromJson(json::parse(R"({"a":1})"), &arena);
+  CHECK(e.ToJson() == json::object());
+}
+
+}  // namespace
+
+int main() {
+  TestAllocator();
+  TestFromJsonResource();
+  TestVectorElements();
+  TestEmptyClass();
+  return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Copyright 2025 0CCH. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The simdjson On-Demand readers. record.h is generated with
+// --backend=simdjson.
+
+#include <string>
+
+#include "check.h"
+#include "empty_record.h"
+#include "record.h"
+
+namespace {
+
+const char kDocument[] =
+    R"({"name":"bob","region":"us","age":41,"level":-7,"ratio":0.25,)"
+    R"("active":false,"tags":["x","y\"z"],"meta":{"host":"h2","port":8080},)"
+    R"("items":[{"kind":"a","count":2},{"kind":"b","count":3}]})";
+
+// Reads |text| with simdjson and expects the status that TryFromJsonString
+// returns for it.
+json2class::ParseStatus Parse(record& r, const std::string& text) {
+  const simdjson::padded_string padded(text);
+  json2class::ParseStatus status = r.ParseFrom(padded);
+  record expected;
+  const json2class::ParseStatus nlohmann = expected.TryFromJsonString(text);
+  CHECK(status.code == nlohmann.code && status.path == nlohmann.path);
+  return status;
+}
+
+void TestRoundTrip() {
+  record r;
+  CHECK(Parse(r, R"({"unknown":{"a":[1,2]},)" + std::string(kDocument + 1))
+            .ok());
+  CHECK(r.ToJson() == json::parse(kDocument));
+
+  // Values of unknown keys are skipped without being validated
+  const simdjson::padded_string unknown(std::string(R"({"x":[tru],"age":6})"));
+  CHECK(r.ParseFrom(unknown).ok() && r.age() == 6);
+
+  simdjson::ondemand::parser parser;
+  const simdjson::padded_string padded(std::string(R"({"age":5})"));
+  record other;
+  CHECK(other.ParseFrom(padded, parser).ok());
+  CHECK(other.age() == 5 && other.name() == "ann");
+
+  simdjson::ondemand::document document;
+  CHECK(!parser.iterate(padded).get(document));
+  simdjson::ondemand::value value;
+  CHECK(!document.get_value().get(value));
+  CHECK(other.FromJson(value).ok());
+}
+
+void TestErrors() {
+  record r;
+  CHECK(Parse(r, R"({"name":)").code == json2class::StatusCode::kSyntaxError);
+  CHECK(Parse(r, R"({"meta":{"port":"80"}})").path == "/meta/port");
+  CHECK(Parse(r, R"({"items":[{},{"count":1.5}]})").path == "/items/1/count");
+  CHECK(Parse(r, R"({"age":3000000000})").path == "/age");
+  CHECK(Parse(r, R"({"tags":["a",1]})").path == "/tags/1");
+
+  // Documents that are not objects are rejected without a path
+  CHECK(Parse(r, "5").code == json2class::StatusCode::kTypeError);
+  CHECK(Parse(r, "[1]").code == json2class::StatusCode::kTypeError);
+  simdjson::ondemand::parser parser;
+  const simdjson::padded_string padded(std::string("[1]"));
+  simdjson::ondemand::document document;
+  simdjson::ondemand::value value;
+  CHECK(!parser.iterate(padded).get(document));
+  CHECK(!document.get_value().get(value));
+  const json2class::ParseStatus status = r.FromJson(value);
+  CHECK(status.code == json2class::StatusCode::kTypeError);
+  CHECK(status.path.empty());
+}
+
+void TestEmptyClass() {
+  empty_record e;
+  const simdjson::padded_string padded(std::string(R"({"a":[1,2]})"));
+  CHECK(e.ParseFrom(padded).ok());
+}
+
+}  // namespace
+
+int main() {
+  TestRoundTrip();
+  TestErrors();
+  TestEmptyClass();
+  return check_failures == 0 ? 0 : 1;
+}